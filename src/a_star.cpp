@@ -1,9 +1,14 @@
-// a_star.cpp (updated: respect oneway & drivable ways; nearest-node helper)
+// a_star.cpp (updated: per-profile access & oneway; nearest-node helper; dense CSR graph)
 
 #include "a_star.hpp"
+#include "road_graph.hpp"
+#include "search.hpp"
+#include "customizable_ch.hpp"
+#include "travel_profiles.hpp"
+#include "facilities.hpp"
+#include "segment_index.hpp"
 #include <iostream>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <queue>
 #include <cmath>
@@ -17,83 +22,36 @@
 #include <sstream>
 #include <algorithm>
 #include <string>
+#include <memory>
+#include <cstdlib>
 
-struct Node {
-    double lat, lon;
-};
-struct Edge {
-    int64_t to;
-    double weight;
-};
-
-static std::unordered_map<int64_t, Node> nodes;
-static std::unordered_set<int64_t> valid_road_nodes;
-static std::unordered_map<int64_t, std::vector<Edge>> adj;
+static RoadGraph graph;
+static std::vector<Facility> facilities;
 static bool mapLoaded = false;
 
-constexpr double PI_CONST = 3.14159265358979323846;
-inline double deg2rad(double deg) { return deg * PI_CONST / 180.0; }
-
-double haversine(double lat1, double lon1, double lat2, double lon2) {
-    // Returns distance in meters
-    const double R = 6371000.0; // mean Earth radius in meters
-    double dLat = deg2rad(lat2 - lat1);
-    double dLon = deg2rad(lon2 - lon1);
-    double a = std::sin(dLat / 2.0) * std::sin(dLat / 2.0) +
-               std::cos(deg2rad(lat1)) * std::cos(deg2rad(lat2)) *
-               std::sin(dLon / 2.0) * std::sin(dLon / 2.0);
-    double c = 2.0 * std::atan2(std::sqrt(a), std::sqrt(1.0 - a));
-    return R * c;
-}
-
-double computePathLength(const std::vector<int64_t>& path) {
-    if (path.size() < 2) return 0.0;
-
-    double d = 0.0;
-    for (size_t i = 1; i < path.size(); i++) {
-        int64_t u = path[i - 1];
-        int64_t v = path[i];
+const RoadGraph& getRoadGraph() { return graph; }
+const std::vector<Facility>& getLoadedFacilities() { return facilities; }
 
-        bool found = false;
-        for (auto& e : adj[u]) {
-            if (e.to == v) {
-                d += e.weight; 
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            // Should not happen if A* returns valid edges.
-            std::cerr << "Warning: Missing edge " << u << " -> " << v << " while computing length.\n";
-        }
+// Some edge out of v may be used by profile
+static bool hasOutEdges(uint32_t v, Profile profile) {
+    for (uint32_t e = graph.firstOut[v]; e < graph.firstOut[v + 1]; ++e) {
+        if (graph.edgeAccess[e] & profileBit(profile)) return true;
     }
-    return d;
+    return false;
 }
 
-// Helper: find nearest node id for a lat/lon (linear search - slow for full map, but fine for testing)
-int64_t findNearestNode(double lat, double lon) {
+// Helper: find nearest road node id for a lat/lon (linear scan over the dense coordinate array)
+int64_t findNearestNode(double lat, double lon, bool largestComponentOnly, Profile profile) {
     double bestDist = std::numeric_limits<double>::infinity();
     int64_t bestId = 0;
-    
-    // Only search nodes that are part of the road network
-    if (!valid_road_nodes.empty()) {
-        for (int64_t id : valid_road_nodes) {
-            if (!nodes.count(id)) continue;
-            const auto& node = nodes[id];
-            double d = haversine(lat, lon, node.lat, node.lon);
-            if (d < bestDist) {
-                bestDist = d;
-                bestId = id;
-            }
-        }
-    } else {
-        // Fallback if set is empty (shouldn't happen if map loaded)
-        for (const auto &p : nodes) {
-            double d = haversine(lat, lon, p.second.lat, p.second.lon);
-            if (d < bestDist) {
-                bestDist = d;
-                bestId = p.first;
-            }
+
+    for (size_t i = 0; i < graph.nodeCount(); i++) {
+        if (largestComponentOnly && !graph.inLargestComponent(static_cast<uint32_t>(i), profile)) continue;
+        const auto& node = graph.coords[i];
+        double d = haversine(lat, lon, node.latDeg(), node.lonDeg());
+        if (d < bestDist && hasOutEdges(static_cast<uint32_t>(i), profile)) {
+            bestDist = d;
+            bestId = graph.osmIds[i];
         }
     }
     return bestId;
@@ -101,84 +59,99 @@ int64_t findNearestNode(double lat, double lon) {
 
 void loadKarachiMap(const std::string& filename) {
     struct MapHandler : public osmium::handler::Handler {
-        // set of highway tags that are appropriate for motor vehicle routing
-        const std::unordered_set<std::string> drivables = {
-            "motorway","trunk","primary","secondary","tertiary",
-            "unclassified","residential","service","living_street",
-            "motorway_link","primary_link","secondary_link","tertiary_link"
-        };
-
-        // disallow these (pedestrian/cycle) types explicitly
-        const std::unordered_set<std::string> nondrivable = {
-            "footway","path","cycleway","steps","pedestrian","track","bridleway","corridor"
-        };
+        std::unordered_map<int64_t, Node> nodes;
+        std::vector<RawEdge> edges;
+        std::vector<WayInfo> ways;
+        std::vector<int64_t> wayNodeIds; // OSM node ids of each way, see WayInfo::firstNode
+        std::vector<Facility> facilities; // hospitals, fuel stations... tagged on nodes or areas
+        std::vector<std::string> names{""};
+        std::unordered_map<std::string, uint32_t> nameIds{{"", 0}};
+
+        // way names are interned so that later stages compare integers, not strings
+        uint32_t internName(const char* name) {
+            if (!name) return 0;
+            auto it = nameIds.find(name);
+            if (it != nameIds.end()) return it->second;
+            uint32_t id = static_cast<uint32_t>(names.size());
+            names.emplace_back(name);
+            nameIds.emplace(names.back(), id);
+            return id;
+        }
 
         void node(const osmium::Node& node) {
             if (node.location().valid()) {
-                nodes[node.id()] = {node.location().lat(), node.location().lon()};
+                nodes[node.id()] = {node.location().y(), node.location().x()};
+
+                const osmium::TagList& tags = node.tags();
+                FacilityKind kind;
+                if (facilityKindFromTags([&](const char* key) { return tags[key]; }, kind)) {
+                    const char* name = tags["name"];
+                    facilities.push_back({node.id(), kind, name ? name : "",
+                                          node.location().lat(), node.location().lon()});
+                }
             }
         }
 
-        void way(const osmium::Way& way) {
-            const char* highway_tag = way.tags()["highway"];
-            if (!highway_tag) return; // not a highway/road-type way
-
-            std::string hw = highway_tag;
-            if (nondrivable.count(hw)) return; // skip pedestrian / cycle / steps etc.
+        // A facility mapped as an area stands at the mean of its outline
+        void addAreaFacility(const osmium::Way& way, FacilityKind kind) {
+            double lat = 0.0, lon = 0.0;
+            size_t count = 0;
+            for (const auto& nr : way.nodes()) {
+                auto it = nodes.find(nr.ref());
+                if (it == nodes.end()) continue;
+                lat += it->second.latDeg();
+                lon += it->second.lonDeg();
+                count++;
+            }
+            if (count == 0) return;
+            const char* name = way.tags()["name"];
+            facilities.push_back({way.id(), kind, name ? name : "", lat / count, lon / count});
+        }
 
-            // allow ways that are in drivables set; if not present, skip to be conservative
-            if (!drivables.count(hw)) {
-                // there are some ambiguous 'road' ways; to be conservative, skip unknown kinds
+        void way(const osmium::Way& way) {
+            FacilityKind kind;
+            if (facilityKindFromTags([&](const char* key) { return way.tags()[key]; }, kind)) {
+                addAreaFacility(way, kind);
                 return;
             }
 
-            // check simple access restrictions
-            const char* access_tag = way.tags()["access"];
-            const char* motor_tag = way.tags()["motor_vehicle"];
-            if ((access_tag && std::string(access_tag) == "no") ||
-                (motor_tag && std::string(motor_tag) == "no")) {
-                return; // not allowed for motor vehicles
-            }
+            // every profile's access, direction and speed rules in one pass
+            const osmium::TagList& tags = way.tags();
+            const WayAccess access = evaluateWay([&](const char* key) { return tags[key]; });
+            if (!access.forward && !access.backward) return; // nobody routes here
 
-            // determine one-way behavior
-            bool oneway = false;
-            bool oneway_reverse = false;
-            const char* oneway_tag = way.tags()["oneway"];
-            const char* junction_tag = way.tags()["junction"];
-            if (junction_tag && std::string(junction_tag) == "roundabout") {
-                oneway = true;
-            }
-            if (oneway_tag) {
-                std::string ow(oneway_tag);
-                if (ow == "yes" || ow == "true" || ow == "1") oneway = true;
-                else if (ow == "-1") oneway_reverse = true;
-            }
+            const char* junction_tag = tags["junction"];
+            const uint32_t wayIndex = static_cast<uint32_t>(ways.size());
+            ways.push_back({way.id(), internName(tags["name"]), roadClassFromTag(tags["highway"]),
+                            junction_tag && std::string(junction_tag) == "roundabout"});
+            std::copy(std::begin(access.speed), std::end(access.speed), ways.back().speed);
+            const char* toll_tag = tags["toll"];
+            ways.back().toll = toll_tag && std::string(toll_tag) != "no";
 
             const osmium::WayNodeList& wnl = way.nodes();
-            // add edges according to the directionality indicated by tags
+            ways.back().firstNode = static_cast<uint32_t>(wayNodeIds.size());
+            for (const auto& nr : wnl) {
+                if (nodes.count(nr.ref())) wayNodeIds.push_back(nr.ref());
+            }
+            ways.back().nodeCount = static_cast<uint32_t>(wayNodeIds.size()) - ways.back().firstNode;
+
+            // Graph durations are the car's; ways closed to cars carry their fastest profile's
+            const float* speed = access.speed;
+            const float base = speed[0] > 0.0f ? speed[0] : *std::max_element(speed, speed + PROFILE_COUNT);
+
+            // one edge per direction that any profile may use, tagged with who may
             for (auto it = wnl.begin(); std::next(it) != wnl.end(); ++it) {
                 int64_t id1 = it->ref();
                 int64_t id2 = std::next(it)->ref();
                 if (!nodes.count(id1) || !nodes.count(id2)) continue; // skip if coordinates unknown
 
-                double d = haversine(nodes[id1].lat, nodes[id1].lon,
-                                     nodes[id2].lat, nodes[id2].lon);
-
-                // Add nodes to valid set
-                valid_road_nodes.insert(id1);
-                valid_road_nodes.insert(id2);
-
-                if (oneway_reverse) {
-                    // edge only from id2 -> id1
-                    adj[id2].push_back({id1, d});
-                } else if (oneway) {
-                    // edge only from id1 -> id2 (way node order)
-                    adj[id1].push_back({id2, d});
-                } else {
-                    // bidirectional (normal two-way street)
-                    adj[id1].push_back({id2, d});
-                    adj[id2].push_back({id1, d});
-                }
+                const Node& n1 = nodes[id1];
+                const Node& n2 = nodes[id2];
+                double d = haversine(n1.latDeg(), n1.lonDeg(), n2.latDeg(), n2.lonDeg());
+                float t = static_cast<float>(d / base);
+
+                if (access.forward) edges.push_back({id1, id2, d, t, wayIndex, access.forward});
+                if (access.backward) edges.push_back({id2, id1, d, t, wayIndex, access.backward});
             }
         }
     };
@@ -188,72 +161,139 @@ void loadKarachiMap(const std::string& filename) {
         MapHandler handler;
         osmium::apply(reader, handler);
         reader.close();
-        // Map loaded successfully
+
+        // Renumber road nodes along a Hilbert curve and pack the adjacency
+        graph = buildRoadGraph(handler.nodes, handler.edges);
+        graph.ways = std::move(handler.ways);
+
+        // Way geometry in dense ids; nodes that did not end up in the graph are dropped
+        for (auto& w : graph.ways) {
+            uint32_t first = static_cast<uint32_t>(graph.wayNodes.size());
+            for (uint32_t k = 0; k < w.nodeCount; k++) {
+                uint32_t v = graph.toDense(handler.wayNodeIds[w.firstNode + k]);
+                if (v != INVALID_NODE) graph.wayNodes.push_back(v);
+            }
+            w.firstNode = first;
+            w.nodeCount = static_cast<uint32_t>(graph.wayNodes.size()) - first;
+        }
+        graph.names = std::move(handler.names);
+        facilities = std::move(handler.facilities);
+        std::cout << "Road graph: " << graph.nodeCount() << " nodes, "
+                  << graph.edgeCount() << " edges\n";
+        for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+            const uint8_t bit = profileBit(static_cast<Profile>(p));
+            size_t usable = static_cast<size_t>(std::count_if(graph.edgeAccess.begin(), graph.edgeAccess.end(),
+                                                              [&](uint8_t a) { return (a & bit) != 0; }));
+            std::cout << "  " << profileName(static_cast<Profile>(p)) << ": " << usable << " edges, "
+                      << graph.componentCount[p] << " strongly connected components\n";
+        }
+        std::cout << "  " << facilities.size() << " facilities\n";
     } catch (const std::exception& e) {
         std::cerr << "Error reading Karachi map: " << e.what() << "\n";
     }
 }
 
-static std::vector<int64_t> astar(int64_t start, int64_t goal) {
-    std::unordered_map<int64_t, double> gScore;
-    std::unordered_map<int64_t, double> fScore;
-    std::unordered_map<int64_t, int64_t> parent;
-
-    gScore[start] = 0.0;
-    fScore[start] = haversine(nodes[start].lat, nodes[start].lon,
-                              nodes[goal].lat, nodes[goal].lon);
-
-    auto cmp = [](const std::pair<int64_t, double>& a, const std::pair<int64_t, double>& b) {
-        return a.second > b.second;
-    };
-    std::priority_queue<std::pair<int64_t, double>,
-                       std::vector<std::pair<int64_t, double>>,
-                       decltype(cmp)> openSet(cmp);
-
-    openSet.push({start, fScore[start]});
-
-    int nodes_explored = 0;
-
-    while (!openSet.empty()) {
-        auto current_pair = openSet.top();
-        openSet.pop();
-        int64_t current = current_pair.first;
-        double current_fscore_in_queue = current_pair.second;
-
-        if (fScore.count(current) && current_fscore_in_queue > fScore[current] + 1e-9) {
-            continue; // stale entry
-        }
+// One search object per thread and variant, reused across queries
+template <typename SearchT>
+static SearchT& searchInstance() {
+    thread_local SearchT search(graph);
+    return search;
+}
 
-        nodes_explored++;
+// Run the search on a snapshot of the live costs and return the edges of the
+// path; false if goal is unreachable
+template <typename SearchT>
+static bool runSearch(uint32_t start, uint32_t goal, const EdgeCostsPtr& costs, std::vector<uint32_t>& edges) {
+    SearchT& search = searchInstance<SearchT>();
+    search.useCosts(costs);
+    bool found = search.run(start, goal) == goal;
+    if (found) edges = search.edgePath(goal);
+    search.useCosts(nullptr); // do not keep an old snapshot alive between queries
+    return found;
+}
 
-        if (current == goal) {
-            std::vector<int64_t> path;
-            for (int64_t at = goal; at != start; at = parent[at]) {
-                path.push_back(at);
-            }
-            path.push_back(start);
-            std::reverse(path.begin(), path.end());
-            return path;
-        }
+// epsilon > 1 runs weighted A*: a path at most epsilon times the optimum,
+// settling far fewer nodes on long routes
+template <typename SearchT>
+static bool runWeighted(uint32_t start, uint32_t goal, const EdgeCostsPtr& costs, double epsilon,
+                        std::vector<uint32_t>& edges) {
+    searchInstance<SearchT>().heuristic().epsilon = epsilon;
+    return runSearch<SearchT>(start, goal, costs, edges);
+}
 
-        if (!adj.count(current)) continue;
+// A* with the mask's edges closed, skipped in the relaxation loop itself
+template <typename SearchT>
+static bool runMasked(uint32_t start, uint32_t goal, const EdgeCostsPtr& costs, const EdgeMask& mask,
+                      std::vector<uint32_t>& edges) {
+    searchInstance<SearchT>().metric().mask = &mask;
+    bool found = runSearch<SearchT>(start, goal, costs, edges);
+    searchInstance<SearchT>().metric().mask = nullptr;
+    return found;
+}
 
-        for (const auto& edge : adj[current]) {
-            double tentative_gScore = gScore[current] + edge.weight;
+static bool astar(uint32_t start, uint32_t goal, RouteMetric metric, const EdgeCostsPtr& costs,
+                  std::vector<uint32_t>& edges, double epsilon = 1.0) {
+    if (epsilon > 1.0) {
+        if (metric == RouteMetric::TravelTime) return runWeighted<WeightedTravelTimeAStar>(start, goal, costs, epsilon, edges);
+        return runWeighted<WeightedDistanceAStar>(start, goal, costs, epsilon, edges);
+    }
+    switch (metric) {
+        case RouteMetric::TravelTime: return runSearch<TravelTimeAStar>(start, goal, costs, edges);
+        case RouteMetric::Distance:
+        default:                      return runSearch<DistanceAStar>(start, goal, costs, edges);
+    }
+}
 
-            if (!gScore.count(edge.to) || tentative_gScore < gScore[edge.to]) {
-                parent[edge.to] = current;
-                gScore[edge.to] = tentative_gScore;
-                fScore[edge.to] = tentative_gScore +
-                    haversine(nodes[edge.to].lat, nodes[edge.to].lon,
-                              nodes[goal].lat, nodes[goal].lon);
+// Hierarchy query when it is customized for these costs, A* until it is
+// and for profiles other than the car's. The hierarchy is exact and faster
+// than weighted A*, so it is used whatever bound is allowed; bound is the
+// factor allowed on the way in and the one guaranteed on the way out.
+static bool route(uint32_t start, uint32_t goal, RouteMetric metric, const EdgeCostsPtr& costs,
+                  std::vector<uint32_t>& edges, double& bound) {
+    auto live = customizedFor(costs);
+    if (!live) return astar(start, goal, metric, costs, edges, bound);
+
+    bound = 1.0;
+    thread_local std::unique_ptr<CchQuery> query;
+    if (!query) query = std::make_unique<CchQuery>(*live->hierarchy);
+    const CchMetric& cm = metric == RouteMetric::TravelTime ? live->travelTime : live->distance;
+    if (query->run(cm, start, goal) == std::numeric_limits<double>::infinity()) return false;
+    edges = query->edgePath();
+    return true;
+}
 
-                openSet.push({edge.to, fScore[edge.to]});
-            }
-        }
+// Assemble node ids, totals and per-edge segments from the search's parent edges in one pass
+static void fillPathResult(PathResult& result, uint32_t start, const EdgeCosts& costs,
+                           const std::vector<uint32_t>& edges) {
+    result.nodeIds.clear();
+    result.segments.clear();
+    result.nodeIds.reserve(edges.size() + 1);
+    result.segments.reserve(edges.size());
+    result.nodeIds.push_back(graph.osmIds[start]);
+    result.profile = costs.profile;
+
+    double distance = 0.0, duration = 0.0;
+    for (uint32_t e : edges) {
+        const WayInfo& way = graph.ways[graph.edgeWay[e]];
+
+        PathSegment seg;
+        seg.fromNode = result.nodeIds.back();
+        seg.toNode = graph.osmIds[graph.head[e]];
+        seg.wayId = way.osmId;
+        seg.way = graph.edgeWay[e];
+        seg.distance = static_cast<float>(graph.weight[e]);
+        seg.duration = costs.duration[e];
+        seg.roadName = graph.names[way.name];
+        seg.highway = roadClassName(way.roadClass);
+
+        distance += graph.weight[e];
+        duration += costs.duration[e];
+        result.nodeIds.push_back(seg.toNode);
+        result.segments.push_back(std::move(seg));
     }
 
-    return {};
+    result.distance = static_cast<float>(distance);
+    result.duration = static_cast<float>(duration);
 }
 
 // Public API functions
@@ -262,38 +302,51 @@ void initAStar(const std::string& mapFile) {
     if (!mapLoaded) {
         loadKarachiMap(mapFile);
         mapLoaded = true;
+        // Queries use A* until the hierarchy is ready
+        startCustomization();
     }
 }
 
-PathResult aStarWithNodes(int64_t startNode, int64_t endNode) {
+PathResult aStarWithNodes(int64_t startNode, int64_t endNode, RouteMetric metric, Profile profile, double epsilon) {
     PathResult result;
     result.found = false;
     result.distance = 0.0f;
+    result.duration = 0.0f;
     result.straightPathDist = 0.0f;
 
-    if (!nodes.count(startNode) || !nodes.count(endNode)) {
+    uint32_t start = graph.toDense(startNode);
+    uint32_t goal = graph.toDense(endNode);
+    if (start == INVALID_NODE || goal == INVALID_NODE) {
         std::cerr << "Invalid node IDs.\n";
         return result;
     }
 
     // Straight-line distance
-    auto& A = nodes[startNode];
-    auto& B = nodes[endNode];
-    result.straightPathDist = haversine(A.lat, A.lon, B.lat, B.lon);
-
-    if (!adj.count(startNode))
-        std::cerr << "Warning: Start node " << startNode << " has no outgoing edges.\n";
-    if (!adj.count(endNode))
-        std::cerr << "Warning: End node " << endNode << " has no outgoing edges.\n";
-
-    std::vector<int64_t> path = astar(startNode, endNode);
-    if (!path.empty()) {
-        result.nodeIds = path;
-        result.distance = computePathLength(path);
+    const auto& A = graph.coords[start];
+    const auto& B = graph.coords[goal];
+    result.straightPathDist = haversine(A.latDeg(), A.lonDeg(), B.latDeg(), B.lonDeg());
+
+    if (!hasOutEdges(start, profile))
+        std::cerr << "Warning: Start node " << startNode << " has no outgoing " << profileName(profile) << " edges.\n";
+    if (!hasOutEdges(goal, profile))
+        std::cerr << "Warning: End node " << endNode << " has no outgoing " << profileName(profile) << " edges.\n";
+
+    // No path can exist: skip exhausting the reachable set
+    if (!graph.mayReach(start, goal, profile)) {
+        std::cerr << "Path not found: the end node cannot be reached from the start node.\n";
+        return result;
+    }
+
+    std::vector<uint32_t> edges;
+    EdgeCostsPtr costs = getLiveCosts().snapshot(profile);
+    double bound = std::max(1.0, epsilon);
+    if (route(start, goal, metric, costs, edges, bound)) {
+        fillPathResult(result, start, *costs, edges);
+        result.bound = bound;
         result.found = true;
     } else {
-        if (!adj.count(startNode) || !adj.count(endNode))
-            std::cerr << "Path not found: nodes not in drivable network.\n";
+        if (!hasOutEdges(start, profile) || !hasOutEdges(goal, profile))
+            std::cerr << "Path not found: nodes not in the " << profileName(profile) << " network.\n";
         else
             std::cerr << "Path not found: disconnected network.\n";
     }
@@ -304,35 +357,36 @@ PathResult aStarWithNodes(int64_t startNode, int64_t endNode) {
 
 
 PathResult aStarWithCoords(double startLat, double startLon,
-                           double endLat,   double endLon) {
+                           double endLat,   double endLon, RouteMetric metric, Profile profile) {
     PathResult result;
     result.found = false;
     result.distance = 0.0f;
+    result.duration = 0.0f;
     result.straightPathDist = haversine(startLat, startLon, endLat, endLon);
 
-    int64_t start = findNearestNode(startLat, startLon);
-    int64_t goal  = findNearestNode(endLat, endLon);
+    uint32_t start = graph.toDense(findNearestNode(startLat, startLon, true, profile));
+    uint32_t goal  = graph.toDense(findNearestNode(endLat, endLon, true, profile));
 
-    if (!nodes.count(start) || !nodes.count(goal)) {
+    if (start == INVALID_NODE || goal == INVALID_NODE) {
         std::cerr << "Could not find valid nodes near given coordinates.\n";
         return result;
     }
 
-    if (!adj.count(start))
-        std::cerr << "Warning: nearest start node " << start 
-                  << " has no outgoing edges.\n";
-    if (!adj.count(goal))
-        std::cerr << "Warning: nearest end node " << goal
-                  << " has no outgoing edges.\n";
-
-    std::vector<int64_t> path = astar(start, goal);
-    if (!path.empty()) {
-        result.nodeIds = path;
-        result.distance = computePathLength(path);
+
+    if (!graph.mayReach(start, goal, profile)) {
+        std::cerr << "Path not found: the nearest end node cannot be reached from the nearest start node.\n";
+        return result;
+    }
+
+    std::vector<uint32_t> edges;
+    EdgeCostsPtr costs = getLiveCosts().snapshot(profile);
+    double bound = 1.0;
+    if (route(start, goal, metric, costs, edges, bound)) {
+        fillPathResult(result, start, *costs, edges);
         result.found = true;
     } else {
-        if (!adj.count(start) || !adj.count(goal))
-            std::cerr << "Path not found: non-drivable nearest nodes.\n";
+        if (!hasOutEdges(start, profile) || !hasOutEdges(goal, profile))
+            std::cerr << "Path not found: nearest nodes not in the " << profileName(profile) << " network.\n";
         else
             std::cerr << "Path not found: disconnected roads.\n";
     }
@@ -340,12 +394,112 @@ PathResult aStarWithCoords(double startLat, double startLon,
     return result;
 }
 
+PathResult aStarDepartingAt(int64_t startNode, int64_t endNode, double departure) {
+    PathResult result;
+    result.found = false;
+    result.distance = result.duration = result.straightPathDist = 0.0f;
+    result.departure = result.arrival = departure;
+
+    uint32_t start = graph.toDense(startNode);
+    uint32_t goal = graph.toDense(endNode);
+    if (start == INVALID_NODE || goal == INVALID_NODE) {
+        std::cerr << "Invalid node IDs.\n";
+        return result;
+    }
+    const auto& A = graph.coords[start];
+    const auto& B = graph.coords[goal];
+    result.straightPathDist = haversine(A.latDeg(), A.lonDeg(), B.latDeg(), B.lonDeg());
+    if (!graph.mayReach(start, goal, Profile::Car)) {
+        std::cerr << "Path not found: the end node cannot be reached from the start node.\n";
+        return result;
+    }
+
+    EdgeCostsPtr costs = getLiveCosts().snapshot();
+    TimeDependentAStar& search = searchInstance<TimeDependentAStar>();
+    search.useCosts(costs);
+    bool found = search.run({{start, departure}}, goal) == goal;
+    std::vector<uint32_t> edges;
+    if (found) edges = search.edgePath(goal);
+    search.useCosts(nullptr);
+    if (!found) {
+        std::cerr << "Path not found: disconnected network.\n";
+        return result;
+    }
+
+    // Replay the clock along the path for per-segment times
+    fillPathResult(result, start, *costs, edges);
+    const SpeedProfiles& profiles = getSpeedProfiles();
+    double clock = departure;
+    for (size_t k = 0; k < edges.size(); ++k) {
+        double t = profiles.travelTime(edges[k], costs->duration[edges[k]], clock);
+        result.segments[k].duration = static_cast<float>(t);
+        clock += t;
+    }
+    result.arrival = clock;
+    result.duration = static_cast<float>(clock - departure);
+    result.found = true;
+    return result;
+}
+
+PathResult aStarAvoiding(int64_t startNode, int64_t endNode, const RouteRestrictions& restrictions,
+                         RouteMetric metric, Profile profile) {
+    return aStarAvoiding(startNode, endNode, buildEdgeMask(graph, getSegmentIndex(), restrictions), metric, profile);
+}
+
+PathResult aStarAvoiding(int64_t startNode, int64_t endNode, const EdgeMaskPtr& mask, RouteMetric metric,
+                         Profile profile) {
+    if (!mask) return aStarWithNodes(startNode, endNode, metric, profile);
+
+    PathResult result;
+    result.found = false;
+    result.distance = result.duration = result.straightPathDist = 0.0f;
+
+    uint32_t start = graph.toDense(startNode);
+    uint32_t goal = graph.toDense(endNode);
+    if (start == INVALID_NODE || goal == INVALID_NODE) {
+        std::cerr << "Invalid node IDs.\n";
+        return result;
+    }
+    const auto& A = graph.coords[start];
+    const auto& B = graph.coords[goal];
+    result.straightPathDist = haversine(A.latDeg(), A.lonDeg(), B.latDeg(), B.lonDeg());
+    if (!graph.mayReach(start, goal, profile)) {
+        std::cerr << "Path not found: the end node cannot be reached from the start node.\n";
+        return result;
+    }
+
+    std::vector<uint32_t> edges;
+    EdgeCostsPtr costs = getLiveCosts().snapshot(profile);
+    bool found = metric == RouteMetric::TravelTime
+                     ? runMasked<MaskedTravelTimeAStar>(start, goal, costs, *mask, edges)
+                     : runMasked<MaskedDistanceAStar>(start, goal, costs, *mask, edges);
+    if (!found) {
+        std::cerr << "Path not found: every route crosses an avoided area or road.\n";
+        return result;
+    }
+    fillPathResult(result, start, *costs, edges);
+    result.found = true;
+    return result;
+}
+
+PathResult pathFromEdges(uint32_t start, const std::vector<uint32_t>& edges, const EdgeCosts& costs) {
+    PathResult result;
+    result.found = start < graph.nodeCount();
+    result.distance = result.duration = result.straightPathDist = 0.0f;
+    if (!result.found) return result;
+    fillPathResult(result, start, costs, edges);
+    const uint32_t end = edges.empty() ? start : graph.head[edges.back()];
+    const auto& A = graph.coords[start];
+    const auto& B = graph.coords[end];
+    result.straightPathDist = haversine(A.latDeg(), A.lonDeg(), B.latDeg(), B.lonDeg());
+    return result;
+}
 
 bool getNodeCoords(int64_t nodeId, double& lat, double& lon) {
-    auto it = nodes.find(nodeId);
-    if (it != nodes.end()) {
-        lat = it->second.lat;
-        lon = it->second.lon;
+    uint32_t v = graph.toDense(nodeId);
+    if (v != INVALID_NODE) {
+        lat = graph.coords[v].latDeg();
+        lon = graph.coords[v].lonDeg();
         return true;
     }
     return false;
@@ -358,7 +512,7 @@ void convertPathToVertices(const std::vector<int64_t>& pathNodeIds,
     outVertices.clear();
     outIndices.clear();
 
-    if (pathNodeIds.empty() || nodes.empty()) {
+    if (pathNodeIds.empty() || graph.nodeCount() == 0) {
         return;
     }
 
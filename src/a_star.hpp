@@ -5,27 +5,84 @@
 #include <cstdint>
 #include <string>
 
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+#include "edge_mask.hpp"
+
+// One edge of a path, filled from the edge the search used to reach toNode
+struct PathSegment {
+    int64_t fromNode, toNode;       // OSM node IDs
+    int64_t wayId;                  // OSM way the edge belongs to
+    uint32_t way;                   // index into the loaded graph's way table
+    float distance;                 // meters
+    float duration;                 // seconds
+    std::string roadName;           // empty if the way is unnamed
+    std::string highway;            // OSM highway class
+};
+
 // Path result structure
 struct PathResult {
     std::vector<int64_t> nodeIds; 
     float distance, straightPathDist; // Path as sequence of node IDs
+    float duration;                 // Travel time along the path in seconds
+    std::vector<PathSegment> segments; // Per-edge metrics, nodeIds.size() - 1 entries
     bool found;                     // Whether a path was found
+    double departure = 0.0, arrival = 0.0; // Clock times in seconds, set by aStarDepartingAt
+    double bound = 1.0;             // cost is at most this factor above the optimum
+    Profile profile = Profile::Car; // travel mode the route was searched for
+};
+
+// Cost the search minimises
+enum class RouteMetric {
+    Distance,   // shortest route
+    TravelTime  // fastest route at free-flow speeds
 };
 
 // Initialize A* with map data (should be called once at startup)
 void initAStar(const std::string& mapFile);
 
-// Run A* pathfinding with node IDs
-PathResult aStarWithNodes(int64_t startNode, int64_t endNode);
+// Run A* pathfinding with node IDs over the roads profile may use. Once the
+// live contraction hierarchy is customized for the current costs, it answers
+// car queries instead of A*. epsilon > 1 accepts a route up to that factor
+// above the optimum (weighted A*) for a faster answer; result.bound tells
+// what was guaranteed.
+PathResult aStarWithNodes(int64_t startNode, int64_t endNode, RouteMetric metric = RouteMetric::Distance,
+                          Profile profile = Profile::Car, double epsilon = 1.0);
+
+// Run A* pathfinding with coordinates (finds nearest nodes the profile can use)
+PathResult aStarWithCoords(double startLat, double startLon, double endLat, double endLon,
+                           RouteMetric metric = RouteMetric::Distance, Profile profile = Profile::Car);
+
+// Fastest route leaving at departure (seconds after midnight; later days
+// repeat the daily pattern) under the historical speed profiles. Segment
+// durations are those at the time each edge is entered.
+PathResult aStarDepartingAt(int64_t startNode, int64_t endNode, double departure);
+
+// Route that stays off everything restrictions rule out. The mask is built
+// per call from the segment index; with nothing restricted this is exactly
+// aStarWithNodes. Masked routes always run A*, since the hierarchy is
+// customized for the unrestricted costs only.
+PathResult aStarAvoiding(int64_t startNode, int64_t endNode, const RouteRestrictions& restrictions,
+                         RouteMetric metric = RouteMetric::Distance, Profile profile = Profile::Car);
+
+// The same with a mask built beforehand, for callers that keep one across
+// queries; a null mask restricts nothing
+PathResult aStarAvoiding(int64_t startNode, int64_t endNode, const EdgeMaskPtr& mask,
+                         RouteMetric metric = RouteMetric::Distance, Profile profile = Profile::Car);
 
-// Run A* pathfinding with coordinates (finds nearest nodes)
-PathResult aStarWithCoords(double startLat, double startLon, double endLat, double endLon);
+// Path result for edges of the loaded graph leaving dense node start, e.g.
+// from a search run outside this module
+PathResult pathFromEdges(uint32_t start, const std::vector<uint32_t>& edges, const EdgeCosts& costs);
 
 // Get node coordinates for a node ID (for path conversion)
 bool getNodeCoords(int64_t nodeId, double& lat, double& lon);
 
-// Find nearest node ID for a lat/lon
-int64_t findNearestNode(double lat, double lon);
+// Find nearest node ID for a lat/lon with an edge the profile may leave by
+// By default only nodes of the largest strongly connected component of the
+// profile's edges are considered, so that snapped endpoints can always
+// reach each other
+int64_t findNearestNode(double lat, double lon, bool largestComponentOnly = true,
+                        Profile profile = Profile::Car);
 
 // Convert path node IDs to renderable vertices/indices
 // Uses the same coordinate transformation as the map (Web Mercator + normalization)
@@ -0,0 +1,235 @@
+#include "anytime_search.hpp"
+
+#include <algorithm>
+#include <limits>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+// How many expansions pass between two polls of the interrupt check
+constexpr size_t POLL_INTERVAL = 256;
+
+AnytimeSearch::AnytimeSearch(const RoadGraph& g)
+    : m_graph(g),
+      m_g(g.nodeCount()),
+      m_parentEdge(g.nodeCount()),
+      m_stamp(g.nodeCount(), 0),
+      m_closed(g.nodeCount(), 0),
+      m_inOpen(g.nodeCount(), 0),
+      m_inIncons(g.nodeCount(), 0)
+{
+}
+
+void AnytimeSearch::reset(uint32_t source, uint32_t target, RouteMetric metric, EdgeCostsPtr costs,
+                          double epsilon) {
+    m_source = source;
+    m_target = target;
+    m_epsilon = std::max(1.0, epsilon);
+    m_expanded = 0;
+    m_costs = costs ? std::move(costs) : freeFlowSnapshot(m_graph);
+    if (metric == RouteMetric::TravelTime) {
+        m_weight = nullptr;
+        m_duration = m_costs->duration.data();
+        // Same fields, scaled to seconds
+        TravelTimeHeuristic h;
+        h.setTarget(m_graph, target);
+        m_heuristic = h;
+    } else {
+        m_weight = m_costs->weight.data();
+        m_duration = nullptr;
+        m_heuristic.setTarget(m_graph, target);
+    }
+
+    // New round; on wrap-around really clear the stamps once
+    if (++m_round == 0) {
+        std::fill(m_stamp.begin(), m_stamp.end(), 0);
+        m_round = 1;
+    }
+    for (const Entry& en : m_open) m_inOpen[en.node] = 0;
+    for (uint32_t v : m_incons) m_inIncons[v] = 0;
+    m_open.clear();
+    m_incons.clear();
+    nextPass();
+
+    m_stamp[source] = m_round;
+    m_g[source] = 0.0;
+    m_parentEdge[source] = INVALID_EDGE;
+    pushOpen(source);
+}
+
+void AnytimeSearch::nextPass() {
+    if (++m_pass == 0) {
+        std::fill(m_closed.begin(), m_closed.end(), 0);
+        m_pass = 1;
+    }
+}
+
+void AnytimeSearch::pushOpen(uint32_t v) {
+    m_inOpen[v] = 1;
+    m_open.push_back({key(v), v});
+    std::push_heap(m_open.begin(), m_open.end(), std::greater<Entry>());
+}
+
+bool AnytimeSearch::improve(const std::function<bool()>& interrupted) {
+    if (m_source == INVALID_NODE) return false;
+    const auto greater = std::greater<Entry>();
+    size_t sincePoll = 0;
+
+    // Until no node left in OPEN could still lead to a cheaper target under this epsilon
+    while (!m_open.empty()) {
+        const Entry top = m_open.front();
+        if (!m_inOpen[top.node] || top.key != key(top.node)) {
+            std::pop_heap(m_open.begin(), m_open.end(), greater);
+            m_open.pop_back(); // stale
+            continue;
+        }
+        if (cost() <= top.key) break;
+        std::pop_heap(m_open.begin(), m_open.end(), greater);
+        m_open.pop_back();
+
+        const uint32_t u = top.node;
+        m_inOpen[u] = 0;
+        m_closed[u] = m_pass;
+        m_expanded++;
+        if (interrupted && ++sincePoll == POLL_INTERVAL) {
+            sincePoll = 0;
+            if (interrupted()) return false;
+        }
+
+        const double gu = m_g[u];
+        for (uint32_t e = m_graph.firstOut[u]; e < m_graph.firstOut[u + 1]; ++e) {
+            const double w = cost(e);
+            if (w == INF) continue; // closed
+            const uint32_t v = m_graph.head[e];
+            if (m_stamp[v] == m_round && !(gu + w < m_g[v])) continue;
+            m_stamp[v] = m_round;
+            m_g[v] = gu + w;
+            m_parentEdge[v] = e;
+            if (m_closed[v] != m_pass) {
+                pushOpen(v);
+            } else if (!m_inIncons[v]) {
+                // Already expanded under this epsilon; it goes back in with the next one
+                m_inIncons[v] = 1;
+                m_incons.push_back(v);
+            }
+        }
+    }
+    return cost() != INF;
+}
+
+void AnytimeSearch::setEpsilon(double epsilon) {
+    m_epsilon = std::max(1.0, epsilon);
+
+    // OPEN and INCONS together, keyed for the new epsilon
+    std::vector<Entry> open;
+    open.reserve(m_open.size() + m_incons.size());
+    for (const Entry& en : m_open) {
+        if (m_inOpen[en.node] == 1) {
+            m_inOpen[en.node] = 2; // taken, skip its duplicates
+            open.push_back({key(en.node), en.node});
+        }
+    }
+    for (uint32_t v : m_incons) {
+        m_inIncons[v] = 0;
+        if (m_inOpen[v] != 2) open.push_back({key(v), v});
+        m_inOpen[v] = 2;
+    }
+    for (const Entry& en : open) m_inOpen[en.node] = 1;
+    m_incons.clear();
+    m_open = std::move(open);
+    std::make_heap(m_open.begin(), m_open.end(), std::greater<Entry>());
+    nextPass();
+}
+
+double AnytimeSearch::cost() const {
+    if (m_target == INVALID_NODE || m_stamp[m_target] != m_round) return INF;
+    return m_g[m_target];
+}
+
+double AnytimeSearch::bound() const {
+    const double c = cost();
+    if (c == INF) return INF;
+    double lower = INF;
+    for (const Entry& en : m_open) {
+        if (m_inOpen[en.node]) lower = std::min(lower, m_g[en.node] + m_heuristic(en.node));
+    }
+    for (uint32_t v : m_incons) lower = std::min(lower, m_g[v] + m_heuristic(v));
+    if (lower >= c) return 1.0; // nothing left could undercut the path
+    return std::min(m_epsilon, c / lower);
+}
+
+std::vector<uint32_t> AnytimeSearch::edgePath() const {
+    std::vector<uint32_t> edges;
+    if (cost() == INF) return edges;
+    for (uint32_t at = m_target; at != m_source && edges.size() < m_graph.nodeCount();) {
+        const uint32_t e = m_parentEdge[at];
+        edges.push_back(e);
+        // Tail of e: the out-edge ranges are sorted by node
+        at = static_cast<uint32_t>(std::upper_bound(m_graph.firstOut.begin(), m_graph.firstOut.end(), e) -
+                                   m_graph.firstOut.begin() - 1);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+double AnytimeSearch::pathCost(const std::vector<uint32_t>& edges) const {
+    double sum = 0.0;
+    for (uint32_t e : edges) sum += cost(e);
+    return sum;
+}
+
+AnytimeRouter::AnytimeRouter(const RoadGraph& g)
+    : m_search(g)
+{
+}
+
+AnytimeRouter::~AnytimeRouter() {
+    cancel();
+}
+
+void AnytimeRouter::cancel() {
+    m_cancel = true;
+    if (m_worker.joinable()) m_worker.join();
+    m_cancel = false;
+}
+
+void AnytimeRouter::start(uint32_t source, uint32_t target, RouteMetric metric, EdgeCostsPtr costs,
+                          std::chrono::milliseconds deadline, Callback onSolution, double epsilon, double step) {
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(m_latestMutex);
+        m_latest = AnytimeSolution();
+        m_solutionCount = 0;
+    }
+    m_running = true;
+    const auto until = std::chrono::steady_clock::now() + deadline;
+    m_worker = std::thread([this, source, target, metric, costs, until, onSolution, epsilon, step] {
+        // The first route is always finished; the deadline only cuts refinement short
+        bool first = true;
+        auto interrupted = [&] { return m_cancel || (!first && std::chrono::steady_clock::now() >= until); };
+        m_search.reset(source, target, metric, costs, epsilon);
+        while (m_search.improve(interrupted)) {
+            AnytimeSolution s;
+            s.edges = m_search.edgePath();
+            s.cost = m_search.pathCost(s.edges);
+            s.bound = m_search.bound();
+            s.expanded = m_search.expandedCount();
+            {
+                std::lock_guard<std::mutex> lock(m_latestMutex);
+                m_latest = s;
+                m_solutionCount++;
+            }
+            if (onSolution) onSolution(s);
+            first = false;
+            if (s.bound <= 1.0 || interrupted()) break;
+            m_search.setEpsilon(std::min(m_search.epsilon() - step, s.bound));
+        }
+        m_search.release(); // do not keep the snapshot alive
+        m_running = false;
+    });
+}
+
+AnytimeSolution AnytimeRouter::latest(size_t* count) const {
+    std::lock_guard<std::mutex> lock(m_latestMutex);
+    if (count) *count = m_solutionCount;
+    return m_latest;
+}
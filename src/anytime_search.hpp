@@ -0,0 +1,134 @@
+#ifndef ANYTIME_SEARCH
+#define ANYTIME_SEARCH
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+#include "a_star.hpp"
+#include "search.hpp"
+
+// One answer of an anytime search
+struct AnytimeSolution {
+    std::vector<uint32_t> edges; // path from source to target
+    double cost = 0.0;           // meters or seconds
+    double bound = 0.0;          // cost <= bound * optimum; 1 once proven optimal
+    size_t expanded = 0;         // nodes expanded by the search so far
+};
+
+// ARA* (Likhachev, Gordon & Thrun): weighted A* run repeatedly with a
+// shrinking epsilon, each run reusing the previous one's search instead of
+// starting over. Nodes improved after being expanded in a run wait in INCONS
+// and rejoin OPEN, re-keyed, when epsilon is lowered. One instance per
+// thread; it holds per-node scratch.
+class AnytimeSearch {
+public:
+    explicit AnytimeSearch(const RoadGraph& g);
+
+    // New query; the first improve() runs at epsilon. costs == nullptr uses the car's free flow.
+    void reset(uint32_t source, uint32_t target, RouteMetric metric = RouteMetric::Distance,
+               EdgeCostsPtr costs = nullptr, double epsilon = 3.0);
+
+    // Search until the target's cost is within epsilon of the optimum.
+    // false if the target is unreachable or interrupted returned true; the
+    // latter is polled every few hundred expansions.
+    bool improve(const std::function<bool()>& interrupted = nullptr);
+
+    // Lower epsilon (not below 1) for the next improve()
+    void setEpsilon(double epsilon);
+
+    // Forget the query, letting go of its costs
+    void release() {
+        m_costs.reset();
+        m_source = m_target = INVALID_NODE;
+    }
+
+    double epsilon() const { return m_epsilon; }
+    // Cost the target was reached at, infinity until it is. Nodes on the way
+    // may have been improved since, so the path itself can be cheaper.
+    double cost() const;
+    // Proven factor between the current cost and the optimum:
+    // min(epsilon, cost / smallest unweighted f of a node still to expand)
+    double bound() const;
+    std::vector<uint32_t> edgePath() const;
+    double pathCost(const std::vector<uint32_t>& edges) const;
+    size_t expandedCount() const { return m_expanded; }
+
+private:
+    const RoadGraph& m_graph;
+    EdgeCostsPtr m_costs;
+    const double* m_weight = nullptr;  // set for RouteMetric::Distance
+    const float* m_duration = nullptr; // set for RouteMetric::TravelTime
+    EquirectangularHeuristic m_heuristic;
+
+    uint32_t m_source = INVALID_NODE, m_target = INVALID_NODE;
+    double m_epsilon = 1.0;
+    size_t m_expanded = 0;
+
+    // Per-node state is valid only where m_stamp == m_round
+    std::vector<double> m_g;
+    std::vector<uint32_t> m_parentEdge;
+    std::vector<uint32_t> m_stamp;
+    std::vector<uint32_t> m_closed;   // == m_pass once expanded in the current improve()
+    std::vector<uint8_t> m_inOpen, m_inIncons;
+    uint32_t m_round = 0, m_pass = 0;
+
+    // OPEN as a binary min-heap over a vector, so it can be scanned for the
+    // bound and rebuilt under a new epsilon; stale entries are skipped when popped
+    struct Entry {
+        double key;
+        uint32_t node;
+        bool operator>(const Entry& o) const { return key > o.key; }
+    };
+    std::vector<Entry> m_open;
+    std::vector<uint32_t> m_incons;
+
+    double cost(uint32_t e) const { return m_weight ? m_weight[e] : m_duration[e]; }
+    double key(uint32_t v) const { return m_g[v] + m_epsilon * m_heuristic(v); }
+    void pushOpen(uint32_t v);
+    void nextPass();
+};
+
+// Runs AnytimeSearch on a worker thread: a quick first route at a high
+// epsilon, then better ones with tighter bounds until the route is proven
+// optimal or the deadline passes. Each solution goes to the callback, on the
+// worker thread, and is kept as latest().
+class AnytimeRouter {
+public:
+    using Callback = std::function<void(const AnytimeSolution&)>;
+
+    explicit AnytimeRouter(const RoadGraph& g);
+    ~AnytimeRouter();
+
+    // Cancel any running query and start this one. Epsilon goes down by step
+    // after each solution, or straight to the bound already proven if lower.
+    void start(uint32_t source, uint32_t target, RouteMetric metric, EdgeCostsPtr costs,
+               std::chrono::milliseconds deadline, Callback onSolution = nullptr,
+               double epsilon = 3.0, double step = 0.5);
+
+    // Stop the worker and wait for it
+    void cancel();
+
+    bool running() const { return m_running; }
+    // Best solution of the current query so far and how many have come in
+    AnytimeSolution latest(size_t* count = nullptr) const;
+
+private:
+    AnytimeSearch m_search;
+    std::thread m_worker;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_running{false};
+    mutable std::mutex m_latestMutex;
+    AnytimeSolution m_latest;
+    size_t m_solutionCount = 0;
+};
+
+#endif
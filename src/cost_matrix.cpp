@@ -0,0 +1,52 @@
+#include "cost_matrix.hpp"
+#include "search.hpp"
+#include "customizable_ch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+template <typename SearchT>
+static void fillRows(const RoadGraph& g, const std::vector<uint32_t>& nodes, const EdgeCostsPtr& costs,
+                     std::atomic<size_t>& nextRow, CostMatrix& m) {
+    SearchT search(g);
+    search.useCosts(costs);
+    const size_t n = nodes.size();
+    for (size_t row = nextRow++; row < n; row = nextRow++) {
+        search.stopPolicy().setTargets(g.nodeCount(), nodes);
+        search.run(nodes[row], INVALID_NODE);
+        for (size_t col = 0; col < n; ++col) {
+            m.cost[row * n + col] = static_cast<double>(search.distance(nodes[col]));
+        }
+    }
+}
+
+CostMatrix computeCostMatrix(const RoadGraph& g, const std::vector<uint32_t>& nodes,
+                             RouteMetric metric, unsigned threads, EdgeCostsPtr costs) {
+    CostMatrix m;
+    m.size = nodes.size();
+    m.cost.assign(m.size * m.size, std::numeric_limits<double>::infinity());
+    if (nodes.empty()) return m;
+
+    // The live hierarchy answers the whole matrix with one bucket pass
+    if (auto live = customizedFor(costs, true)) {
+        const CchMetric& cm = metric == RouteMetric::TravelTime ? live->travelTime : live->distance;
+        m.cost = live->hierarchy->manyToMany(cm, nodes, nodes, threads);
+        return m;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, nodes.size()));
+
+    std::atomic<size_t> nextRow{0};
+    auto work = [&] {
+        if (metric == RouteMetric::TravelTime) fillRows<TravelTimeOneToMany>(g, nodes, costs, nextRow, m);
+        else fillRows<DistanceOneToMany>(g, nodes, costs, nextRow, m);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(work);
+    work();
+    for (auto& w : workers) w.join();
+    return m;
+}
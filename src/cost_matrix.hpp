@@ -0,0 +1,31 @@
+#ifndef COST_MATRIX
+#define COST_MATRIX
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+#include "road_graph.hpp"
+#include "a_star.hpp"
+#include "edge_costs.hpp"
+
+// Road costs between every ordered pair of a set of nodes, row-major.
+// Unreachable pairs hold infinity.
+struct CostMatrix {
+    size_t size = 0;
+    std::vector<double> cost;
+
+    double at(size_t from, size_t to) const { return cost[from * size + to]; }
+};
+
+// Rows are spread over threads (0 = every core). costs is a live snapshot of
+// g's edge costs, or nullptr for free flow. When the live hierarchy is running
+// (startCustomization) the matrix comes from it, waiting for it to catch up
+// with costs if needed; otherwise one one-to-many Dijkstra runs per row,
+// each stopping once all nodes are settled.
+CostMatrix computeCostMatrix(const RoadGraph& g, const std::vector<uint32_t>& nodes,
+                             RouteMetric metric = RouteMetric::Distance, unsigned threads = 0,
+                             EdgeCostsPtr costs = nullptr);
+
+#endif
@@ -0,0 +1,450 @@
+#include "customizable_ch.hpp"
+#include "partition.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+// Cells this small are not dissected further
+constexpr size_t LEAF_CELL = 16;
+// Levels with fewer nodes are customized on the calling thread
+constexpr size_t PARALLEL_LEVEL = 2048;
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+// Nested dissection: order both halves first, then the separator between
+// them, so that separator nodes end up above everything they separate.
+// A cell that falls apart into components needs no separator at all.
+class Dissection {
+public:
+    Dissection(const RoadGraph& g, const Topology& t)
+        : m_topology(t), m_flow(g, t), m_cell(g.nodeCount(), 0)
+    {
+        m_order.reserve(g.nodeCount());
+    }
+
+    std::vector<uint32_t> run() {
+        std::vector<uint32_t> all(m_cell.size());
+        for (uint32_t v = 0; v < all.size(); ++v) all[v] = v;
+        dissect(all);
+        return std::move(m_order);
+    }
+
+private:
+    const Topology& m_topology;
+    InertialFlow m_flow;
+    std::vector<uint32_t> m_cell; // node -> id of the cell it was last put in
+    uint32_t m_cellCount = 0;
+    std::vector<uint32_t> m_order;
+
+    uint32_t newCell(const std::vector<uint32_t>& nodes) {
+        uint32_t id = ++m_cellCount;
+        for (uint32_t v : nodes) m_cell[v] = id;
+        return id;
+    }
+
+    template <typename F>
+    void forNeighbours(uint32_t v, F f) const {
+        for (uint32_t a = m_topology.firstOut[v]; a < m_topology.firstOut[v + 1]; ++a) f(m_topology.head[a]);
+    }
+
+    // Connected components of the cell, by breadth-first search inside it
+    std::vector<std::vector<uint32_t>> components(const std::vector<uint32_t>& nodes) {
+        uint32_t cell = newCell(nodes);
+        std::vector<std::vector<uint32_t>> parts;
+        for (uint32_t s : nodes) {
+            if (m_cell[s] != cell) continue;
+            uint32_t part = ++m_cellCount;
+            parts.emplace_back(1, s);
+            m_cell[s] = part;
+            auto& list = parts.back();
+            for (size_t q = 0; q < list.size(); ++q) {
+                forNeighbours(list[q], [&](uint32_t w) {
+                    if (m_cell[w] == cell) {
+                        m_cell[w] = part;
+                        list.push_back(w);
+                    }
+                });
+            }
+        }
+        return parts;
+    }
+
+    void dissect(std::vector<uint32_t>& nodes) {
+        if (nodes.size() <= LEAF_CELL) {
+            m_order.insert(m_order.end(), nodes.begin(), nodes.end());
+            return;
+        }
+        auto parts = components(nodes);
+        if (parts.size() > 1) {
+            for (auto& part : parts) dissect(part);
+            return;
+        }
+
+        // Turn the edge cut into a node separator: the endpoints on the side
+        // with fewer of them
+        size_t mid = m_flow.bisect(nodes);
+        std::vector<uint32_t> sides[2] = {{nodes.begin(), nodes.begin() + mid}, {nodes.begin() + mid, nodes.end()}};
+        uint32_t cells[2] = {newCell(sides[0]), newCell(sides[1])};
+        std::vector<uint32_t> border[2];
+        for (int s = 0; s < 2; ++s) {
+            for (uint32_t v : sides[s]) {
+                bool cut = false;
+                forNeighbours(v, [&](uint32_t w) { cut = cut || m_cell[w] == cells[1 - s]; });
+                if (cut) border[s].push_back(v);
+            }
+        }
+        int sep = border[0].size() <= border[1].size() ? 0 : 1;
+        uint32_t sepCell = newCell(border[sep]);
+        auto& reduced = sides[sep];
+        reduced.erase(std::remove_if(reduced.begin(), reduced.end(),
+                                     [&](uint32_t v) { return m_cell[v] == sepCell; }),
+                      reduced.end());
+
+        dissect(sides[0]);
+        dissect(sides[1]);
+        m_order.insert(m_order.end(), border[sep].begin(), border[sep].end());
+    }
+};
+
+CustomizableCH::CustomizableCH(const RoadGraph& g)
+{
+    const size_t n = g.nodeCount();
+    Topology topology = undirectedTopology(g);
+    std::vector<uint32_t> order = Dissection(g, topology).run();
+    m_rank.resize(n);
+    for (uint32_t r = 0; r < n; ++r) m_rank[order[r]] = r;
+
+    // Contract in rank order. The upward neighbours of a node become a
+    // clique; adding them to the lowest of them is enough, since that one
+    // passes its own neighbours on when it is contracted in turn.
+    std::vector<std::vector<uint32_t>> up(n);
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t a = topology.firstOut[u]; a < topology.firstOut[u + 1]; ++a) {
+            uint32_t v = topology.head[a];
+            if (m_rank[v] > m_rank[u]) up[m_rank[u]].push_back(m_rank[v]);
+        }
+    }
+    topology = Topology();
+
+    m_parent.assign(n, INVALID_NODE);
+    m_firstArc.assign(n + 1, 0);
+    for (uint32_t r = 0; r < n; ++r) {
+        auto& list = up[r];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        if (!list.empty()) {
+            m_parent[r] = list[0];
+            up[list[0]].insert(up[list[0]].end(), list.begin() + 1, list.end());
+        }
+        m_firstArc[r + 1] = m_firstArc[r] + static_cast<uint32_t>(list.size());
+    }
+    m_arcHead.reserve(m_firstArc[n]);
+    m_arcTail.reserve(m_firstArc[n]);
+    for (uint32_t r = 0; r < n; ++r) {
+        m_arcHead.insert(m_arcHead.end(), up[r].begin(), up[r].end());
+        m_arcTail.insert(m_arcTail.end(), up[r].size(), r);
+        std::vector<uint32_t>().swap(up[r]);
+    }
+
+    // Incoming arcs per head, and elimination tree levels: a node's level
+    // is one above the highest level below it
+    std::vector<uint32_t> level(n, 0);
+    m_firstDown.assign(n + 1, 0);
+    for (uint32_t a = 0; a < m_arcHead.size(); ++a) {
+        m_firstDown[m_arcHead[a] + 1]++;
+        level[m_arcHead[a]] = std::max(level[m_arcHead[a]], level[m_arcTail[a]] + 1);
+    }
+    for (size_t r = 0; r < n; ++r) m_firstDown[r + 1] += m_firstDown[r];
+    m_downArc.resize(m_arcHead.size());
+    std::vector<uint32_t> fill(m_firstDown.begin(), m_firstDown.end() - 1);
+    for (uint32_t a = 0; a < m_arcHead.size(); ++a) m_downArc[fill[m_arcHead[a]]++] = a;
+
+    uint32_t levels = n ? *std::max_element(level.begin(), level.end()) + 1 : 0;
+    m_levelFirst.assign(levels + 1, 0);
+    for (uint32_t l : level) m_levelFirst[l + 1]++;
+    for (size_t l = 0; l < levels; ++l) m_levelFirst[l + 1] += m_levelFirst[l];
+    m_levelNodes.resize(n);
+    fill.assign(m_levelFirst.begin(), m_levelFirst.end() - 1);
+    for (uint32_t r = 0; r < n; ++r) m_levelNodes[fill[level[r]]++] = r;
+
+    // Every graph edge lands on the arc between its endpoints
+    m_edgeArc.assign(g.edgeCount(), INVALID_EDGE);
+    m_edgeUpward.assign(g.edgeCount(), 0);
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+            uint32_t ru = m_rank[u], rv = m_rank[g.head[e]];
+            if (ru == rv) continue;
+            m_edgeArc[e] = ru < rv ? findArc(ru, rv) : findArc(rv, ru);
+            m_edgeUpward[e] = ru < rv;
+        }
+    }
+}
+
+uint32_t CustomizableCH::findArc(uint32_t tail, uint32_t head) const {
+    auto first = m_arcHead.begin() + m_firstArc[tail];
+    auto last = m_arcHead.begin() + m_firstArc[tail + 1];
+    auto it = std::lower_bound(first, last, head);
+    return it != last && *it == head ? static_cast<uint32_t>(it - m_arcHead.begin()) : INVALID_EDGE;
+}
+
+template <typename Cost>
+CchMetric CustomizableCH::customize(const std::vector<Cost>& cost, unsigned threads) const {
+    const size_t n = nodeCount();
+    CchMetric m;
+    m.up.assign(arcCount(), INF);
+    m.down.assign(arcCount(), INF);
+    m.upUnpack.assign(arcCount(), INVALID_NODE);
+    m.downUnpack.assign(arcCount(), INVALID_NODE);
+
+    for (uint32_t e = 0; e < m_edgeArc.size(); ++e) {
+        uint32_t a = m_edgeArc[e];
+        if (a == INVALID_EDGE) continue;
+        double c = static_cast<double>(cost[e]);
+        double& slot = m_edgeUpward[e] ? m.up[a] : m.down[a];
+        if (c < slot) {
+            slot = c;
+            (m_edgeUpward[e] ? m.upUnpack[a] : m.downUnpack[a]) = ORIGINAL_EDGE | e;
+        }
+    }
+
+    // Lower triangles: for x, every arc v -> x from below and every arc
+    // v -> y above x close a triangle with x -> y. Only x's own arcs are
+    // written, and only arcs of lower levels are read.
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<uint32_t>> arcTo(threads, std::vector<uint32_t>(n)); // head -> arc of x, per worker
+
+    auto relax = [&](uint32_t x, std::vector<uint32_t>& arcOf) {
+        for (uint32_t a = m_firstArc[x]; a < m_firstArc[x + 1]; ++a) arcOf[m_arcHead[a]] = a;
+        for (uint32_t d = m_firstDown[x]; d < m_firstDown[x + 1]; ++d) {
+            const uint32_t vx = m_downArc[d];
+            const uint32_t v = m_arcTail[vx];
+            const double xToV = m.down[vx], vToX = m.up[vx];
+            if (xToV == INF && vToX == INF) continue;
+            // v's arcs are sorted by head, so those after vx lead above x
+            for (uint32_t b = vx + 1; b < m_firstArc[v + 1]; ++b) {
+                const uint32_t a = arcOf[m_arcHead[b]];
+                double c = xToV + m.up[b];
+                if (c < m.up[a]) {
+                    m.up[a] = c;
+                    m.upUnpack[a] = v;
+                }
+                c = m.down[b] + vToX;
+                if (c < m.down[a]) {
+                    m.down[a] = c;
+                    m.downUnpack[a] = v;
+                }
+            }
+        }
+    };
+
+    // Level 0 has nothing below it
+    for (size_t l = 1; l + 1 < m_levelFirst.size(); ++l) {
+        const uint32_t* nodes = m_levelNodes.data() + m_levelFirst[l];
+        const size_t count = m_levelFirst[l + 1] - m_levelFirst[l];
+        if (count < PARALLEL_LEVEL || threads == 1) {
+            for (size_t i = 0; i < count; ++i) relax(nodes[i], arcTo[0]);
+        } else {
+            parallelFor(count, threads, [&](size_t i, unsigned worker) { relax(nodes[i], arcTo[worker]); });
+        }
+    }
+    return m;
+}
+
+template CchMetric CustomizableCH::customize<double>(const std::vector<double>&, unsigned) const;
+template CchMetric CustomizableCH::customize<float>(const std::vector<float>&, unsigned) const;
+
+void CustomizableCH::unpack(const CchMetric& metric, uint32_t arc, bool upward, std::vector<uint32_t>& edges) const {
+    std::vector<std::pair<uint32_t, bool>> stack{{arc, upward}};
+    while (!stack.empty()) {
+        auto [a, forward] = stack.back();
+        stack.pop_back();
+        uint32_t via = forward ? metric.upUnpack[a] : metric.downUnpack[a];
+        if (via & ORIGINAL_EDGE) {
+            edges.push_back(via & ~ORIGINAL_EDGE);
+            continue;
+        }
+        // tail -> head is tail -> via -> head, both arcs start at via
+        uint32_t viaTail = findArc(via, m_arcTail[a]);
+        uint32_t viaHead = findArc(via, m_arcHead[a]);
+        if (forward) {
+            stack.push_back({viaHead, true});
+            stack.push_back({viaTail, false});
+        } else {
+            stack.push_back({viaTail, true});
+            stack.push_back({viaHead, false});
+        }
+    }
+}
+
+// Relax upward from rank r along the elimination tree; dist must be
+// infinite everywhere on entry and is left set along r's ancestors
+static void walkUp(const std::vector<uint32_t>& parent, const std::vector<uint32_t>& firstArc,
+                   const std::vector<uint32_t>& arcHead, const std::vector<double>& cost, uint32_t r,
+                   std::vector<double>& dist, std::vector<uint32_t>* parentArc) {
+    dist[r] = 0.0;
+    if (parentArc) (*parentArc)[r] = INVALID_EDGE;
+    for (uint32_t v = r; v != INVALID_NODE; v = parent[v]) {
+        const double dv = dist[v];
+        if (dv == INF) continue;
+        for (uint32_t a = firstArc[v]; a < firstArc[v + 1]; ++a) {
+            double c = dv + cost[a];
+            if (c < dist[arcHead[a]]) {
+                dist[arcHead[a]] = c;
+                if (parentArc) (*parentArc)[arcHead[a]] = a;
+            }
+        }
+    }
+}
+
+static void clearPath(const std::vector<uint32_t>& parent, uint32_t r, std::vector<double>& dist) {
+    for (uint32_t v = r; v != INVALID_NODE; v = parent[v]) dist[v] = INF;
+}
+
+std::vector<double> CustomizableCH::manyToMany(const CchMetric& metric, const std::vector<uint32_t>& sources,
+                                               const std::vector<uint32_t>& targets, unsigned threads) const {
+    const size_t n = nodeCount(), columns = targets.size();
+    std::vector<double> result(sources.size() * columns, INF);
+    if (sources.empty() || targets.empty()) return result;
+
+    // Buckets: backward distance of every target at each of its ancestors
+    struct Entry {
+        uint32_t column;
+        double cost;
+    };
+    std::vector<double> dist(n, INF);
+    std::vector<uint32_t> bucketFirst(n + 1, 0);
+    std::vector<std::pair<uint32_t, Entry>> found;
+    for (uint32_t j = 0; j < columns; ++j) {
+        uint32_t r = m_rank[targets[j]];
+        walkUp(m_parent, m_firstArc, m_arcHead, metric.down, r, dist, nullptr);
+        for (uint32_t v = r; v != INVALID_NODE; v = m_parent[v]) {
+            if (dist[v] == INF) continue;
+            found.push_back({v, {j, dist[v]}});
+            bucketFirst[v + 1]++;
+        }
+        clearPath(m_parent, r, dist);
+    }
+    for (size_t v = 0; v < n; ++v) bucketFirst[v + 1] += bucketFirst[v];
+    std::vector<Entry> buckets(found.size());
+    std::vector<uint32_t> fill(bucketFirst.begin(), bucketFirst.end() - 1);
+    for (const auto& f : found) buckets[fill[f.first]++] = f.second;
+    std::vector<std::pair<uint32_t, Entry>>().swap(found);
+
+    // Rows: forward search from the source, then scan the buckets it meets
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, sources.size()));
+    std::vector<std::vector<double>> forward(threads);
+    parallelFor(sources.size(), threads, [&](size_t i, unsigned worker) {
+        auto& df = forward[worker];
+        if (df.empty()) df.assign(n, INF);
+        uint32_t r = m_rank[sources[i]];
+        walkUp(m_parent, m_firstArc, m_arcHead, metric.up, r, df, nullptr);
+        double* row = result.data() + i * columns;
+        for (uint32_t v = r; v != INVALID_NODE; v = m_parent[v]) {
+            if (df[v] == INF) continue;
+            for (uint32_t b = bucketFirst[v]; b < bucketFirst[v + 1]; ++b) {
+                row[buckets[b].column] = std::min(row[buckets[b].column], df[v] + buckets[b].cost);
+            }
+        }
+        clearPath(m_parent, r, df);
+    });
+    return result;
+}
+
+CchQuery::CchQuery(const CustomizableCH& ch)
+    : m_ch(ch),
+      m_forward(ch.nodeCount(), INF),
+      m_backward(ch.nodeCount(), INF),
+      m_forwardArc(ch.nodeCount(), INVALID_EDGE),
+      m_backwardArc(ch.nodeCount(), INVALID_EDGE)
+{
+}
+
+double CchQuery::run(const CchMetric& metric, uint32_t source, uint32_t target) {
+    m_metric = &metric;
+    m_source = m_ch.m_rank[source];
+    m_target = m_ch.m_rank[target];
+    m_meeting = INVALID_NODE;
+    walkUp(m_ch.m_parent, m_ch.m_firstArc, m_ch.m_arcHead, metric.up, m_source, m_forward, &m_forwardArc);
+    walkUp(m_ch.m_parent, m_ch.m_firstArc, m_ch.m_arcHead, metric.down, m_target, m_backward, &m_backwardArc);
+
+    // Both walks end in the same root if the endpoints are connected at all
+    double best = INF;
+    for (uint32_t v = m_target; v != INVALID_NODE; v = m_ch.m_parent[v]) {
+        double c = m_forward[v] + m_backward[v];
+        if (c < best) {
+            best = c;
+            m_meeting = v;
+        }
+    }
+    clearPath(m_ch.m_parent, m_source, m_forward);
+    clearPath(m_ch.m_parent, m_target, m_backward);
+    return best;
+}
+
+std::vector<uint32_t> CchQuery::edgePath() const {
+    std::vector<uint32_t> edges;
+    if (m_meeting == INVALID_NODE) return edges;
+
+    std::vector<uint32_t> arcs;
+    for (uint32_t v = m_meeting; v != m_source; v = m_ch.m_arcTail[m_forwardArc[v]]) {
+        arcs.push_back(m_forwardArc[v]);
+    }
+    for (auto it = arcs.rbegin(); it != arcs.rend(); ++it) m_ch.unpack(*m_metric, *it, true, edges);
+    for (uint32_t v = m_meeting; v != m_target; v = m_ch.m_arcTail[m_backwardArc[v]]) {
+        m_ch.unpack(*m_metric, m_backwardArc[v], false, edges);
+    }
+    return edges;
+}
+
+// ---- Hierarchy of the loaded graph, kept customized for the live costs ----
+
+static std::shared_ptr<const LiveHierarchy> liveCustomized;
+static std::mutex liveMutex;
+static std::condition_variable liveChanged;
+static bool customizationStarted = false;
+
+void startCustomization(unsigned threads) {
+    {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        if (customizationStarted) return;
+        customizationStarted = true;
+    }
+    LiveCosts& live = getLiveCosts();
+    std::thread([threads, &live] {
+        auto start = std::chrono::steady_clock::now();
+        auto hierarchy = std::make_shared<const CustomizableCH>(getRoadGraph());
+        auto built = std::chrono::steady_clock::now();
+        std::cout << "Contraction hierarchy: " << hierarchy->arcCount() << " arcs, ordered in "
+                  << std::chrono::duration<double>(built - start).count() << " s\n";
+
+        for (EdgeCostsPtr costs = live.snapshot();; costs = live.waitForNewer(costs->version)) {
+            auto next = std::make_shared<LiveHierarchy>();
+            next->hierarchy = hierarchy;
+            next->costs = costs;
+            next->distance = hierarchy->customize(costs->weight, threads);
+            next->travelTime = hierarchy->customize(costs->duration, threads);
+            {
+                std::lock_guard<std::mutex> lock(liveMutex);
+                liveCustomized = std::move(next);
+            }
+            liveChanged.notify_all();
+        }
+    }).detach();
+}
+
+std::shared_ptr<const LiveHierarchy> customizedFor(const EdgeCostsPtr& costs, bool wait) {
+    if (!costs || costs->profile != Profile::Car) return nullptr; // only the car's costs are customized
+    std::unique_lock<std::mutex> lock(liveMutex);
+    if (!customizationStarted) return nullptr;
+    if (wait) {
+        liveChanged.wait(lock, [&] { return liveCustomized && liveCustomized->costs->version >= costs->version; });
+    }
+    return liveCustomized && liveCustomized->costs == costs ? liveCustomized : nullptr;
+}
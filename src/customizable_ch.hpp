@@ -0,0 +1,112 @@
+#ifndef CUSTOMIZABLE_CH
+#define CUSTOMIZABLE_CH
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+
+// Marks a CchMetric unpack entry that holds a graph edge instead of a middle node
+constexpr uint32_t ORIGINAL_EDGE = 0x80000000u;
+
+// Costs of one metric on the hierarchy's arcs. An arc joins a lower ranked
+// tail to a higher ranked head; up is the cost tail -> head, down head -> tail.
+struct CchMetric {
+    std::vector<double> up, down;
+    // How each direction got its cost: the lower middle rank of a shortcut,
+    // or ORIGINAL_EDGE | graph edge id
+    std::vector<uint32_t> upUnpack, downUnpack;
+};
+
+// Customizable contraction hierarchy. The node order (nested dissection with
+// inertial flow separators) and the shortcut topology depend on the road
+// network only and are computed once. customize() then turns any edge cost
+// array - free flow, a live snapshot, another profile - into a CchMetric in
+// one bottom-up pass over the lower triangles of every arc, parallel over
+// nodes of equal elimination tree level.
+class CustomizableCH {
+public:
+    explicit CustomizableCH(const RoadGraph& g);
+
+    // Cost per graph edge, infinity for closed edges; threads == 0 uses every core
+    template <typename Cost>
+    CchMetric customize(const std::vector<Cost>& cost, unsigned threads = 0) const;
+
+    // Cost from every source to every target, row-major; infinity if unreachable.
+    // Backward searches fill buckets, forward searches scan them.
+    std::vector<double> manyToMany(const CchMetric& metric, const std::vector<uint32_t>& sources,
+                                   const std::vector<uint32_t>& targets, unsigned threads = 0) const;
+
+    size_t nodeCount() const { return m_rank.size(); }
+    size_t arcCount() const { return m_arcHead.size(); }
+    uint32_t rank(uint32_t v) const { return m_rank[v]; }
+
+private:
+    friend class CchQuery;
+    friend class HubLabels;
+    friend class Phast;
+
+    std::vector<uint32_t> m_rank;      // graph node -> rank
+    std::vector<uint32_t> m_parent;    // rank -> lowest upward neighbour (elimination tree), INVALID_NODE at roots
+
+    // Upward arcs in rank space, per tail sorted by head
+    std::vector<uint32_t> m_firstArc;
+    std::vector<uint32_t> m_arcHead;
+    std::vector<uint32_t> m_arcTail;
+
+    // Arcs into each rank from below, in ascending tail order
+    std::vector<uint32_t> m_firstDown;
+    std::vector<uint32_t> m_downArc;
+
+    // Nodes grouped by elimination tree level; a level only depends on lower ones
+    std::vector<uint32_t> m_levelFirst;
+    std::vector<uint32_t> m_levelNodes;
+
+    std::vector<uint32_t> m_edgeArc;   // graph edge -> arc, INVALID_EDGE for loops
+    std::vector<uint8_t> m_edgeUpward; // graph edge runs tail -> head of its arc
+
+    uint32_t findArc(uint32_t tail, uint32_t head) const;
+    void unpack(const CchMetric& metric, uint32_t arc, bool upward, std::vector<uint32_t>& edges) const;
+};
+
+// Point-to-point query: both searches walk the elimination tree from their
+// endpoint to the root, so there is no priority queue and no stalling.
+// One instance per thread; it holds per-node scratch.
+class CchQuery {
+public:
+    explicit CchQuery(const CustomizableCH& ch);
+
+    // Cost from source to target (graph node ids), infinity if unreachable
+    double run(const CchMetric& metric, uint32_t source, uint32_t target);
+
+    // Graph edges of the last path found, source to target
+    std::vector<uint32_t> edgePath() const;
+
+private:
+    const CustomizableCH& m_ch;
+    const CchMetric* m_metric = nullptr;
+    std::vector<double> m_forward, m_backward;
+    std::vector<uint32_t> m_forwardArc, m_backwardArc;
+    uint32_t m_source = INVALID_NODE, m_target = INVALID_NODE, m_meeting = INVALID_NODE;
+};
+
+// The road graph's hierarchy customized for one snapshot of the live costs
+struct LiveHierarchy {
+    std::shared_ptr<const CustomizableCH> hierarchy;
+    EdgeCostsPtr costs;
+    CchMetric distance, travelTime;
+};
+
+// Build the hierarchy of getRoadGraph() on a background thread, then
+// customize it again each time the live costs change
+void startCustomization(unsigned threads = 0);
+
+// The hierarchy customized for exactly these costs, or nullptr while
+// customization has not caught up (or was never started) and for costs of
+// profiles other than the car's. With wait set, block until it catches up.
+std::shared_ptr<const LiveHierarchy> customizedFor(const EdgeCostsPtr& costs, bool wait = false);
+
+#endif
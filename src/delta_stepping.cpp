@@ -0,0 +1,228 @@
+#include "delta_stepping.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+// Bucket width as a multiple of the mean edge cost. Narrower buckets mean
+// fewer re-relaxations, wider ones fewer (synchronized) phases; road graphs
+// were fastest around a few edges' worth.
+constexpr double DELTA_FACTOR = 4.0;
+
+// Nodes are dealt to threads in blocks this large, keeping a thread's nodes
+// close together in the Hilbert order
+constexpr uint32_t OWNER_BLOCK_BITS = 10;
+
+namespace {
+
+// Reusable barrier for the workers of one run
+class Barrier {
+public:
+    explicit Barrier(unsigned count) : m_count(count) {}
+
+    void wait() {
+        if (m_count == 1) return;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const size_t generation = m_generation;
+        if (++m_arrived == m_count) {
+            m_arrived = 0;
+            m_generation++;
+            m_released.notify_all();
+        } else {
+            m_released.wait(lock, [&] { return generation != m_generation; });
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+    unsigned m_count, m_arrived = 0;
+    size_t m_generation = 0;
+};
+
+struct Request {
+    uint32_t node, edge;
+    double dist;
+};
+
+struct Worker {
+    std::vector<std::vector<uint32_t>> buckets; // of the nodes this worker owns
+    std::vector<uint32_t> current, settled;
+    std::vector<std::vector<Request>> outbox;   // per owner
+    size_t next = 0;                            // lowest non-empty bucket
+    bool active = false;                        // current bucket refilled
+    size_t settledCount = 0;
+};
+
+}
+
+DeltaStepping::DeltaStepping(const RoadGraph& g, unsigned threads)
+    : m_graph(g),
+      m_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      m_dist(g.nodeCount(), INF),
+      m_parentEdge(g.nodeCount(), INVALID_EDGE),
+      m_bucket(g.nodeCount(), INVALID_NODE),
+      m_settledIn(g.nodeCount(), INVALID_NODE)
+{
+}
+
+void DeltaStepping::run(uint32_t source, RouteMetric metric, EdgeCostsPtr costs, double limit, double delta) {
+    const size_t n = m_graph.nodeCount();
+    std::fill(m_dist.begin(), m_dist.end(), INF);
+    std::fill(m_parentEdge.begin(), m_parentEdge.end(), INVALID_EDGE);
+    std::fill(m_bucket.begin(), m_bucket.end(), INVALID_NODE);
+    std::fill(m_settledIn.begin(), m_settledIn.end(), INVALID_NODE);
+    m_settled = m_phases = 0;
+    m_source = source < n ? source : INVALID_NODE;
+    if (m_source == INVALID_NODE) return;
+
+    if (!costs) costs = freeFlowSnapshot(m_graph);
+    const double* weight = nullptr;
+    const float* duration = nullptr;
+    if (metric == RouteMetric::TravelTime) {
+        duration = costs->duration.data();
+    } else {
+        weight = costs->weight.data();
+    }
+    auto cost = [&](uint32_t e) { return weight ? weight[e] : static_cast<double>(duration[e]); };
+
+    if (delta <= 0.0) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (uint32_t e = 0; e < m_graph.edgeCount(); ++e) {
+            const double c = cost(e);
+            if (c != INF) {
+                sum += c;
+                count++;
+            }
+        }
+        delta = count ? DELTA_FACTOR * sum / count : 1.0;
+        if (!(delta > 0.0)) delta = 1.0;
+    }
+    m_delta = delta;
+
+    const unsigned threads = m_threads;
+    auto owner = [threads](uint32_t v) { return (v >> OWNER_BLOCK_BITS) % threads; };
+    auto bucketOf = [delta](double d) { return static_cast<size_t>(d / delta); };
+
+    std::vector<Worker> workers(threads);
+    for (Worker& w : workers) w.outbox.resize(threads);
+    Barrier barrier(threads);
+
+    m_dist[m_source] = 0.0;
+    m_bucket[m_source] = 0;
+    workers[owner(m_source)].buckets.assign(1, {m_source});
+
+    auto work = [&](unsigned id) {
+        Worker& me = workers[id];
+
+        auto relax = [&](uint32_t u, bool light) {
+            const double du = m_dist[u];
+            for (uint32_t e = m_graph.firstOut[u]; e < m_graph.firstOut[u + 1]; ++e) {
+                const double c = cost(e);
+                if ((c <= delta) != light || c == INF) continue;
+                const double d = du + c;
+                if (d > limit) continue;
+                const uint32_t v = m_graph.head[e];
+                me.outbox[owner(v)].push_back({v, e, d});
+            }
+        };
+
+        // Requests addressed to this worker, from every worker's outbox
+        auto apply = [&]() {
+            for (Worker& from : workers) {
+                for (const Request& r : from.outbox[id]) {
+                    if (!(r.dist < m_dist[r.node])) continue;
+                    m_dist[r.node] = r.dist;
+                    m_parentEdge[r.node] = r.edge;
+                    const size_t b = bucketOf(r.dist);
+                    m_bucket[r.node] = static_cast<uint32_t>(b);
+                    if (b >= me.buckets.size()) me.buckets.resize(b + 1);
+                    me.buckets[b].push_back(r.node);
+                }
+                from.outbox[id].clear();
+            }
+        };
+
+        size_t i = 0;
+        while (true) {
+            me.next = SIZE_MAX;
+            for (size_t b = i; b < me.buckets.size(); ++b) {
+                if (!me.buckets[b].empty()) {
+                    me.next = b;
+                    break;
+                }
+            }
+            barrier.wait();
+            i = SIZE_MAX;
+            for (const Worker& w : workers) i = std::min(i, w.next);
+            if (i == SIZE_MAX || i * delta > limit) break;
+
+            // Light edges until no node falls back into bucket i
+            me.settled.clear();
+            while (true) {
+                if (i < me.buckets.size()) me.current.swap(me.buckets[i]);
+                for (uint32_t u : me.current) {
+                    if (m_bucket[u] != i) continue; // moved to a lower cost since
+                    m_bucket[u] = INVALID_NODE;
+                    // A node can come back into bucket i at a lower cost: its
+                    // light edges go again, its heavy ones wait for the end
+                    if (m_settledIn[u] != i) {
+                        m_settledIn[u] = static_cast<uint32_t>(i);
+                        me.settled.push_back(u);
+                    }
+                    relax(u, true);
+                }
+                me.current.clear();
+                barrier.wait();
+                apply();
+                me.active = i < me.buckets.size() && !me.buckets[i].empty();
+                barrier.wait();
+                bool any = false;
+                for (const Worker& w : workers) any = any || w.active;
+                if (id == 0) m_phases++;
+                if (!any) break;
+            }
+
+            // Heavy edges once; they can only reach later buckets
+            for (uint32_t u : me.settled) relax(u, false);
+            barrier.wait();
+            apply();
+            if (id == 0) m_phases++;
+            me.settledCount += me.settled.size();
+            i++;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work, t);
+    work(0);
+    for (auto& t : pool) t.join();
+    for (const Worker& w : workers) m_settled += w.settledCount;
+}
+
+std::vector<uint32_t> DeltaStepping::edgePath(uint32_t target) const {
+    std::vector<uint32_t> edges;
+    if (m_source == INVALID_NODE || target >= m_dist.size() || m_dist[target] == INF) return edges;
+    for (uint32_t at = target; at != m_source && edges.size() < m_graph.nodeCount();) {
+        const uint32_t e = m_parentEdge[at];
+        edges.push_back(e);
+        // Tail of e: the out-edge ranges are sorted by node
+        at = static_cast<uint32_t>(std::upper_bound(m_graph.firstOut.begin(), m_graph.firstOut.end(), e) -
+                                   m_graph.firstOut.begin() - 1);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+std::vector<uint32_t> DeltaStepping::reached() const {
+    std::vector<uint32_t> nodes;
+    for (uint32_t v = 0; v < m_dist.size(); ++v) {
+        if (m_dist[v] != INF) nodes.push_back(v);
+    }
+    return nodes;
+}
@@ -0,0 +1,56 @@
+#ifndef DELTA_STEPPING
+#define DELTA_STEPPING
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+#include "a_star.hpp"
+
+// Parallel single-source shortest paths by delta-stepping (Meyer & Sanders),
+// for whole trees without any preprocessing. Tentative costs are kept in
+// buckets delta wide; all nodes of the lowest bucket are settled together,
+// light edges (cost <= delta) repeatedly until the bucket stays empty, then
+// heavy edges once. Nodes are dealt to the threads in blocks, each thread
+// owns its nodes' costs and buckets, and relaxations travel as requests to
+// the owner, so no cost is ever written by two threads.
+class DeltaStepping {
+public:
+    // threads == 0 uses every core
+    explicit DeltaStepping(const RoadGraph& g, unsigned threads = 0);
+
+    // Costs from source to every node, or only to nodes within limit (the
+    // rest stay infinite). costs == nullptr uses the car's free flow; delta == 0
+    // picks a bucket width from the mean edge cost.
+    void run(uint32_t source, RouteMetric metric = RouteMetric::Distance, EdgeCostsPtr costs = nullptr,
+             double limit = std::numeric_limits<double>::infinity(), double delta = 0.0);
+
+    double distance(uint32_t v) const { return m_dist[v]; }
+    const std::vector<double>& distances() const { return m_dist; }
+    // Last edge of v's shortest path, INVALID_EDGE at the source and unreached nodes
+    uint32_t parentEdge(uint32_t v) const { return m_parentEdge[v]; }
+    // Edges from the source to target, empty if it was not reached
+    std::vector<uint32_t> edgePath(uint32_t target) const;
+    // Nodes reached, in no particular order
+    std::vector<uint32_t> reached() const;
+
+    double delta() const { return m_delta; }
+    size_t settledCount() const { return m_settled; }
+    size_t phaseCount() const { return m_phases; } // light and heavy rounds
+
+private:
+    const RoadGraph& m_graph;
+    unsigned m_threads;
+    std::vector<double> m_dist;
+    std::vector<uint32_t> m_parentEdge;
+    std::vector<uint32_t> m_bucket; // bucket a node waits in, INVALID_NODE once taken out
+    std::vector<uint32_t> m_settledIn; // bucket a node was settled in, so a re-entry counts once
+    uint32_t m_source = INVALID_NODE;
+    double m_delta = 0.0;
+    size_t m_settled = 0, m_phases = 0;
+};
+
+#endif
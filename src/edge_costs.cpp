@@ -0,0 +1,202 @@
+#include "edge_costs.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <exception>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+LiveCosts::LiveCosts(const RoadGraph& g)
+    : m_graph(g)
+{
+    for (uint32_t e = 0; e < g.edgeCount(); ++e) {
+        m_edgesOfWay[g.ways[g.edgeWay[e]].osmId].push_back(e);
+    }
+    reset();
+}
+
+// Free-flow duration of edge e for profile, infinity where it may not go
+static float freeFlowDuration(const RoadGraph& g, uint32_t e, Profile profile) {
+    if (!(g.edgeAccess[e] & profileBit(profile))) return std::numeric_limits<float>::infinity();
+    if (profile == Profile::Car) return g.duration[e];
+    float speed = g.ways[g.edgeWay[e]].speed[static_cast<size_t>(profile)];
+    return speed > 0.0f ? static_cast<float>(g.weight[e] / speed) : g.duration[e];
+}
+
+EdgeCosts freeFlowCosts(const RoadGraph& g, Profile profile) {
+    EdgeCosts costs;
+    costs.profile = profile;
+    costs.weight.resize(g.edgeCount());
+    costs.duration.resize(g.edgeCount());
+    const uint8_t bit = profileBit(profile);
+    for (uint32_t e = 0; e < g.edgeCount(); ++e) {
+        costs.weight[e] = g.edgeAccess[e] & bit ? g.weight[e] : std::numeric_limits<double>::infinity();
+        costs.duration[e] = freeFlowDuration(g, e, profile);
+    }
+    return costs;
+}
+
+EdgeCostsPtr freeFlowSnapshot(const RoadGraph& g, Profile profile) {
+    static std::mutex mutex;
+    static const RoadGraph* graphs[PROFILE_COUNT] = {};
+    static EdgeCostsPtr costs[PROFILE_COUNT];
+    const size_t p = static_cast<size_t>(profile);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (graphs[p] != &g || costs[p]->weight.size() != g.edgeCount()) {
+        costs[p] = std::make_shared<const EdgeCosts>(freeFlowCosts(g, profile));
+        graphs[p] = &g;
+    }
+    return costs[p];
+}
+
+EdgeCostsPtr LiveCosts::snapshot(Profile profile) const {
+    return std::atomic_load(&m_current[static_cast<size_t>(profile)]);
+}
+
+void LiveCosts::publish(std::shared_ptr<EdgeCosts> (&costs)[PROFILE_COUNT]) {
+    EdgeCostsPtr previous = std::atomic_load(&m_current[0]);
+    const uint64_t version = previous ? previous->version + 1 : 0;
+    {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+            costs[p]->version = version;
+            costs[p]->profile = static_cast<Profile>(p);
+            std::atomic_store(&m_current[p], EdgeCostsPtr(std::move(costs[p])));
+        }
+    }
+    m_published.notify_all();
+}
+
+EdgeCostsPtr LiveCosts::waitForNewer(uint64_t version) const {
+    std::unique_lock<std::mutex> lock(m_publishMutex);
+    m_published.wait(lock, [&] { return std::atomic_load(&m_current[0])->version > version; });
+    return std::atomic_load(&m_current[0]);
+}
+
+void LiveCosts::reset() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    std::shared_ptr<EdgeCosts> next[PROFILE_COUNT];
+    for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+        next[p] = std::make_shared<EdgeCosts>(freeFlowCosts(m_graph, static_cast<Profile>(p)));
+    }
+    publish(next);
+}
+
+size_t LiveCosts::apply(const std::vector<EdgeUpdate>& updates, bool fromFreeFlow) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    EdgeCostsPtr currentCar = std::atomic_load(&m_current[0]);
+    std::shared_ptr<EdgeCosts> next[PROFILE_COUNT];
+    for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+        next[p] = fromFreeFlow ? std::make_shared<EdgeCosts>(freeFlowCosts(m_graph, static_cast<Profile>(p)))
+                               : std::make_shared<EdgeCosts>(*std::atomic_load(&m_current[p]));
+    }
+    const double inf = std::numeric_limits<double>::infinity();
+
+    auto update = [&](uint32_t e, const EdgeUpdate& u) {
+        for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+            const Profile profile = static_cast<Profile>(p);
+            if (!(m_graph.edgeAccess[e] & profileBit(profile))) continue; // stays closed to it
+            double weight = m_graph.weight[e];
+            float duration = freeFlowDuration(m_graph, e, profile);
+            if (u.closed || u.speedFactor <= 0.0) {
+                weight = inf;
+                duration = std::numeric_limits<float>::infinity();
+            } else if (profile == Profile::Car || profile == Profile::Motorbike) {
+                // Never faster than the fastest road, so the A* bound stays admissible
+                double seconds = duration / u.speedFactor;
+                if (m_graph.maxSpeed > 0.0) seconds = std::max(seconds, weight / m_graph.maxSpeed);
+                duration = static_cast<float>(seconds);
+            }
+            next[p]->weight[e] = weight;
+            next[p]->duration[e] = duration;
+        }
+    };
+
+    for (const EdgeUpdate& u : updates) {
+        if (u.wayId != 0) {
+            auto it = m_edgesOfWay.find(u.wayId);
+            if (it == m_edgesOfWay.end()) continue;
+            for (uint32_t e : it->second) update(e, u);
+            continue;
+        }
+        uint32_t from = m_graph.toDense(u.fromNode);
+        uint32_t to = m_graph.toDense(u.toNode);
+        if (from == INVALID_NODE || to == INVALID_NODE) continue;
+        // Per-node edges are sorted by head; parallel edges are all updated
+        auto first = m_graph.head.begin() + m_graph.firstOut[from];
+        auto last = m_graph.head.begin() + m_graph.firstOut[from + 1];
+        for (auto it = std::lower_bound(first, last, to); it != last && *it == to; ++it) {
+            update(static_cast<uint32_t>(it - m_graph.head.begin()), u);
+        }
+    }
+
+    size_t changed = 0;
+    const EdgeCosts& car = *next[0];
+    for (size_t e = 0; e < car.weight.size(); ++e) {
+        if (car.weight[e] != currentCar->weight[e] || car.duration[e] != currentCar->duration[e]) changed++;
+    }
+    publish(next);
+    return changed;
+}
+
+LiveCosts& getLiveCosts() {
+    // Never destroyed: background threads may still wait on it at exit
+    static LiveCosts* costs = new LiveCosts(getRoadGraph());
+    return *costs;
+}
+
+std::vector<EdgeUpdate> readEdgeUpdates(std::istream& in) {
+    std::vector<EdgeUpdate> updates;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::vector<std::string> fields;
+        std::string field;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+
+        EdgeUpdate u;
+        std::string value;
+        try {
+            if (fields.size() == 3 && fields[0] == "way") {
+                u.wayId = std::stoll(fields[1]);
+                value = fields[2];
+            } else if (fields.size() == 4 && fields[0] == "pair") {
+                u.fromNode = std::stoll(fields[1]);
+                u.toNode = std::stoll(fields[2]);
+                value = fields[3];
+            } else {
+                continue; // header or malformed
+            }
+            value.erase(value.find_last_not_of(" \r") + 1);
+            if (value == "closed") u.closed = true;
+            else u.speedFactor = std::stod(value);
+        } catch (const std::exception&) {
+            continue;
+        }
+        updates.push_back(u);
+    }
+    return updates;
+}
+
+void startTrafficFeed(const std::string& path, int intervalSeconds) {
+    getLiveCosts(); // build before the first query races the feed for it
+    std::thread([path, intervalSeconds] {
+        for (;;) {
+            std::ifstream in(path);
+            if (in) {
+                std::vector<EdgeUpdate> updates = readEdgeUpdates(in);
+                size_t changed = getLiveCosts().apply(updates, true);
+                std::cout << "Traffic feed: " << updates.size() << " updates, "
+                          << changed << " edges changed\n";
+            } else {
+                std::cerr << "Traffic feed: cannot open " << path << "\n";
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(intervalSeconds));
+        }
+    }).detach();
+}
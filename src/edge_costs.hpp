@@ -0,0 +1,91 @@
+#ifndef EDGE_COSTS
+#define EDGE_COSTS
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+#include <unordered_map>
+#include <string>
+
+#include "road_graph.hpp"
+
+// One consistent set of edge costs for one profile. Closed edges, and edges
+// the profile may not use, cost infinity.
+struct EdgeCosts {
+    std::vector<double> weight;  // meters
+    std::vector<float> duration; // seconds
+    uint64_t version = 0;
+    Profile profile = Profile::Car;
+};
+
+using EdgeCostsPtr = std::shared_ptr<const EdgeCosts>;
+
+// Costs of profile with nothing closed: graph lengths, and durations at the
+// profile's speed on each way
+EdgeCosts freeFlowCosts(const RoadGraph& g, Profile profile);
+
+// The same, built on first use and kept while g is the graph asked about.
+// Engines handed no snapshot use the car's, so they never take an edge
+// cars may not.
+EdgeCostsPtr freeFlowSnapshot(const RoadGraph& g, Profile profile = Profile::Car);
+
+// A change to one OSM way (every edge of it) or one directed node pair.
+// Factors are relative to free flow, so sending the same update twice does
+// not compound and speedFactor 1 with closed false restores the edge.
+struct EdgeUpdate {
+    int64_t wayId = 0;                // OSM way id, or 0 to use the node pair
+    int64_t fromNode = 0, toNode = 0; // OSM node ids of one directed edge
+    bool closed = false;
+    double speedFactor = 1.0;         // share of free-flow speed, e.g. 0.4 in a jam
+};
+
+// Copy-on-write edge costs over a fixed graph. Queries take a snapshot
+// (one atomic shared_ptr load) and keep it for their whole run; a batch of
+// updates copies the current arrays, edits the copy and publishes it
+// atomically, so readers never wait and never see half an update.
+// Every profile has its own snapshot; one batch publishes all of them under
+// one version. Closures apply to everyone, speed factors to motor vehicles.
+class LiveCosts {
+public:
+    explicit LiveCosts(const RoadGraph& g);
+
+    EdgeCostsPtr snapshot(Profile profile = Profile::Car) const;
+
+    // Block until a car snapshot newer than version is published and return it
+    EdgeCostsPtr waitForNewer(uint64_t version) const;
+
+    // Apply a batch on top of the current costs, or on top of free flow when
+    // the batch is a complete picture (a feed snapshot); returns car edges changed.
+    // Writers are serialised, readers are never blocked.
+    size_t apply(const std::vector<EdgeUpdate>& updates, bool fromFreeFlow = false);
+
+    // Back to free-flow costs with nothing closed
+    void reset();
+
+private:
+    const RoadGraph& m_graph;
+    EdgeCostsPtr m_current[PROFILE_COUNT]; // only accessed through std::atomic_load/store
+    std::mutex m_writeMutex;
+    mutable std::mutex m_publishMutex; // only pairs m_published with the store
+    mutable std::condition_variable m_published;
+    std::unordered_map<int64_t, std::vector<uint32_t>> m_edgesOfWay; // OSM way id -> edges
+
+    void publish(std::shared_ptr<EdgeCosts> (&costs)[PROFILE_COUNT]);
+};
+
+// Live costs of the loaded road graph, created on first use
+LiveCosts& getLiveCosts();
+
+// Read updates from CSV lines "way,<way_id>,<factor|closed>" or
+// "pair,<from_node>,<to_node>,<factor|closed>"; other lines are skipped
+std::vector<EdgeUpdate> readEdgeUpdates(std::istream& in);
+
+// Re-read a full traffic snapshot from path every intervalSeconds on a
+// background thread and publish it into getLiveCosts()
+void startTrafficFeed(const std::string& path, int intervalSeconds = 60);
+
+#endif
@@ -0,0 +1,101 @@
+#include "edge_mask.hpp"
+#include "segment_index.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <limits>
+
+size_t EdgeMask::blockedCount() const {
+    size_t count = 0;
+    for (uint64_t word : m_bits) count += std::bitset<64>(word).count();
+    return count;
+}
+
+// Ray casting on plain (lat, lon); areas are city sized, so the distortion does not matter
+static bool inside(const AvoidArea& area, double lat, double lon) {
+    bool in = false;
+    for (size_t i = 0, j = area.size() - 1; i < area.size(); j = i++) {
+        const double yi = area[i].first, xi = area[i].second;
+        const double yj = area[j].first, xj = area[j].second;
+        if ((yi > lat) != (yj > lat) && lon < (xj - xi) * (lat - yi) / (yj - yi) + xi) in = !in;
+    }
+    return in;
+}
+
+static double cross(double ax, double ay, double bx, double by, double cx, double cy) {
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+// Proper crossing of segments p1-p2 and q1-q2; touching ends are caught by inside()
+static bool crosses(double p1y, double p1x, double p2y, double p2x, double q1y, double q1x, double q2y, double q2x) {
+    const double d1 = cross(q1x, q1y, q2x, q2y, p1x, p1y);
+    const double d2 = cross(q1x, q1y, q2x, q2y, p2x, p2y);
+    const double d3 = cross(p1x, p1y, p2x, p2y, q1x, q1y);
+    const double d4 = cross(p1x, p1y, p2x, p2y, q2x, q2y);
+    return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0));
+}
+
+static bool touches(const AvoidArea& area, const Node& a, const Node& b) {
+    if (inside(area, a.latDeg(), a.lonDeg()) || inside(area, b.latDeg(), b.lonDeg())) return true;
+    for (size_t i = 0, j = area.size() - 1; i < area.size(); j = i++) {
+        if (crosses(a.latDeg(), a.lonDeg(), b.latDeg(), b.lonDeg(), area[j].first, area[j].second, area[i].first,
+                    area[i].second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+EdgeMaskPtr buildEdgeMask(const RoadGraph& g, const SegmentIndex& index, const RouteRestrictions& restrictions) {
+    if (restrictions.empty()) return nullptr;
+    auto mask = std::make_shared<EdgeMask>(g.edgeCount());
+
+    if (restrictions.roadClasses != 0 || restrictions.tolls) {
+        std::vector<uint8_t> wayBlocked(g.ways.size(), 0);
+        for (size_t w = 0; w < g.ways.size(); ++w) {
+            const WayInfo& way = g.ways[w];
+            wayBlocked[w] = (restrictions.roadClasses & roadClassBit(way.roadClass)) != 0 ||
+                            (restrictions.tolls && way.toll);
+        }
+        for (uint32_t e = 0; e < g.edgeCount(); ++e) {
+            if (wayBlocked[g.edgeWay[e]]) mask->block(e);
+        }
+    }
+
+    // Both directions of every way segment an area touches
+    auto blockBetween = [&](uint32_t u, uint32_t v, uint32_t way) {
+        for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+            if (g.head[e] == v && g.edgeWay[e] == way) mask->block(e);
+        }
+    };
+    for (const AvoidArea& area : restrictions.areas) {
+        if (area.size() < 3) continue;
+        double minLat = area[0].first, maxLat = minLat, minLon = area[0].second, maxLon = minLon;
+        for (const auto& corner : area) {
+            minLat = std::min(minLat, corner.first);
+            maxLat = std::max(maxLat, corner.first);
+            minLon = std::min(minLon, corner.second);
+            maxLon = std::max(maxLon, corner.second);
+        }
+        for (uint32_t id : index.inBox(minLat, minLon, maxLat, maxLon)) {
+            const RoadSegment& s = index.segment(id);
+            if (!touches(area, g.coords[s.u], g.coords[s.v])) continue;
+            blockBetween(s.u, s.v, s.way);
+            blockBetween(s.v, s.u, s.way);
+        }
+    }
+
+    if (mask->blockedCount() == 0) return nullptr;
+    return mask;
+}
+
+EdgeCostsPtr maskCosts(const EdgeCosts& costs, const EdgeMask& mask) {
+    auto masked = std::make_shared<EdgeCosts>(costs);
+    for (uint32_t e = 0; e < masked->weight.size(); ++e) {
+        if (mask.blocked(e)) {
+            masked->weight[e] = std::numeric_limits<double>::infinity();
+            masked->duration[e] = std::numeric_limits<float>::infinity();
+        }
+    }
+    return masked;
+}
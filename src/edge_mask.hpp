@@ -0,0 +1,52 @@
+#ifndef EDGE_MASK
+#define EDGE_MASK
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+
+class SegmentIndex;
+
+// Edges a query must stay off, one bit per edge
+class EdgeMask {
+public:
+    explicit EdgeMask(size_t edgeCount) : m_bits((edgeCount + 63) / 64, 0) {}
+
+    bool blocked(uint32_t e) const { return (m_bits[e >> 6] >> (e & 63)) & 1u; }
+    void block(uint32_t e) { m_bits[e >> 6] |= uint64_t(1) << (e & 63); }
+    size_t blockedCount() const;
+
+private:
+    std::vector<uint64_t> m_bits;
+};
+
+using EdgeMaskPtr = std::shared_ptr<const EdgeMask>;
+
+// Corners (lat, lon) of an area to avoid, in order; the last joins the first
+using AvoidArea = std::vector<std::pair<double, double>>;
+
+inline uint32_t roadClassBit(RoadClass rc) { return 1u << static_cast<unsigned>(rc); }
+
+// What one query must avoid
+struct RouteRestrictions {
+    std::vector<AvoidArea> areas; // any edge touching one is blocked
+    uint32_t roadClasses = 0;     // roadClassBit()s
+    bool tolls = false;
+
+    bool empty() const { return areas.empty() && roadClasses == 0 && !tolls; }
+};
+
+// Mask of every edge the restrictions rule out; nullptr when they rule out
+// nothing, so unrestricted queries keep their usual (unmasked) path. Areas
+// only look at the segments the index files under their bounding box.
+EdgeMaskPtr buildEdgeMask(const RoadGraph& g, const SegmentIndex& index, const RouteRestrictions& restrictions);
+
+// Copy of costs with the masked edges closed, for engines that only take costs
+EdgeCostsPtr maskCosts(const EdgeCosts& costs, const EdgeMask& mask);
+
+#endif
@@ -0,0 +1,189 @@
+#include "facilities.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// Facilities farther than this from any car road are left unreachable
+constexpr double SNAP_RADIUS = 500.0;
+
+static const char* const KIND_NAMES[FACILITY_KIND_COUNT] = {
+    "hospital", "fuel", "police", "fire_station", "pharmacy"
+};
+
+const char* facilityKindName(FacilityKind kind) {
+    return KIND_NAMES[static_cast<size_t>(kind)];
+}
+
+bool parseFacilityKind(const std::string& name, FacilityKind& kind) {
+    for (size_t k = 0; k < FACILITY_KIND_COUNT; ++k) {
+        if (name == KIND_NAMES[k]) {
+            kind = static_cast<FacilityKind>(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool facilityKindFromTags(const std::function<const char*(const char*)>& tag, FacilityKind& kind) {
+    const char* amenity = tag("amenity");
+    if (amenity && parseFacilityKind(amenity, kind)) return true;
+    const char* healthcare = tag("healthcare");
+    if (healthcare && std::string(healthcare) == "hospital") {
+        kind = FacilityKind::Hospital;
+        return true;
+    }
+    return false;
+}
+
+// Cars may leave v by some edge
+static bool carUsable(const RoadGraph& g, uint32_t v) {
+    for (uint32_t e = g.firstOut[v]; e < g.firstOut[v + 1]; ++e) {
+        if (g.edgeAccess[e] & profileBit(Profile::Car)) return true;
+    }
+    return false;
+}
+
+FacilityIndex::FacilityIndex(const RoadGraph& g, const SegmentIndex& segments, std::vector<Facility> facilities)
+    : m_graph(g), m_facilities(std::move(facilities)), m_reverse(reverseAdjacency(g))
+{
+    for (uint32_t i = 0; i < m_facilities.size(); ++i) {
+        Facility& f = m_facilities[i];
+        f.node = INVALID_NODE;
+        auto snap = [&](const SegmentHit& h) {
+            const RoadSegment& s = segments.segment(h.segment);
+            uint32_t nearer = h.fraction < 0.5 ? s.u : s.v;
+            uint32_t farther = h.fraction < 0.5 ? s.v : s.u;
+            if (carUsable(g, nearer)) f.node = nearer;
+            else if (carUsable(g, farther)) f.node = farther;
+            return f.node != INVALID_NODE;
+        };
+        // The closest segment almost always does; list the others only when it is a footpath
+        SegmentHit closest = segments.nearest(f.lat, f.lon, SNAP_RADIUS);
+        if (closest.segment == UINT32_MAX) continue;
+        if (!snap(closest)) {
+            for (const SegmentHit& h : segments.within(f.lat, f.lon, SNAP_RADIUS)) {
+                if (snap(h)) break;
+            }
+        }
+        if (f.node != INVALID_NODE) m_byNode[static_cast<size_t>(f.kind)].push_back({f.node, i});
+    }
+    for (size_t k = 0; k < FACILITY_KIND_COUNT; ++k) {
+        std::sort(m_byNode[k].begin(), m_byNode[k].end());
+        for (const auto& nf : m_byNode[k]) m_nodesOf[k].push_back(nf.first);
+    }
+}
+
+size_t FacilityIndex::count(FacilityKind kind) const {
+    return m_byNode[static_cast<size_t>(kind)].size();
+}
+
+// One search object per thread and variant, reused across queries
+template <typename SearchT>
+static SearchT& searchInstance(const RoadGraph& g) {
+    thread_local SearchT search(g);
+    return search;
+}
+
+template <typename SearchT>
+static std::vector<FacilityHit> settleNearest(const RoadGraph& g, const EdgeCostsPtr& costs, uint32_t from, size_t k,
+                                              const std::vector<uint32_t>& nodes,
+                                              const std::vector<std::pair<uint32_t, uint32_t>>& byNode) {
+    SearchT& search = searchInstance<SearchT>(g);
+    search.useCosts(costs);
+    search.stopPolicy().setTargets(g.nodeCount(), nodes, k);
+    search.run(from, INVALID_NODE);
+
+    // Facilities at the settled nodes, in the order settled
+    std::vector<FacilityHit> hits;
+    for (uint32_t v : search.stopPolicy().settledTargets) {
+        auto range = std::equal_range(byNode.begin(), byNode.end(), std::make_pair(v, 0u),
+                                      [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto it = range.first; it != range.second && hits.size() < k; ++it) {
+            hits.push_back({it->second, static_cast<double>(search.distance(v))});
+        }
+    }
+    search.useCosts(nullptr); // do not keep an old snapshot alive between queries
+    return hits;
+}
+
+std::vector<FacilityHit> FacilityIndex::nearest(uint32_t from, FacilityKind kind, size_t k, RouteMetric metric,
+                                                const EdgeCostsPtr& costs) const {
+    const size_t kk = static_cast<size_t>(kind);
+    if (k == 0 || from >= m_graph.nodeCount() || m_nodesOf[kk].empty()) return {};
+    if (metric == RouteMetric::TravelTime) {
+        return settleNearest<TravelTimeNearestTargets>(m_graph, costs, from, k, m_nodesOf[kk], m_byNode[kk]);
+    }
+    return settleNearest<DistanceNearestTargets>(m_graph, costs, from, k, m_nodesOf[kk], m_byNode[kk]);
+}
+
+template <typename Cost>
+void FacilityIndex::sweep(FacilityKind kind, const Cost* cost, NearestFacilityMap& map) const {
+    const size_t n = m_graph.nodeCount();
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> dist(n, inf);
+    map.facility.assign(n, INVALID_NODE);
+    map.nextEdge.assign(n, INVALID_EDGE);
+
+    // Every facility is a source; the lowest index wins where several share a node
+    QuaternaryHeap<double> queue;
+    queue.resize(n);
+    for (const auto& nf : m_byNode[static_cast<size_t>(kind)]) {
+        if (dist[nf.first] == 0.0) continue;
+        dist[nf.first] = 0.0;
+        map.facility[nf.first] = nf.second;
+        queue.push(nf.first, 0.0);
+    }
+
+    // Addressable queue and nonnegative costs: each node is popped once, final
+    while (!queue.empty()) {
+        uint32_t v = queue.pop();
+        const double dv = dist[v];
+        for (uint32_t a = m_reverse.firstIn[v]; a < m_reverse.firstIn[v + 1]; ++a) {
+            const uint32_t e = m_reverse.edge[a];
+            const double w = cost[e];
+            if (w == inf) continue; // closed
+            const uint32_t u = m_reverse.tail[a];
+            if (dv + w < dist[u]) {
+                dist[u] = dv + w;
+                map.facility[u] = map.facility[v];
+                map.nextEdge[u] = e;
+                queue.push(u, dist[u]);
+            }
+        }
+    }
+
+    map.cost.resize(n);
+    for (size_t v = 0; v < n; ++v) map.cost[v] = static_cast<float>(dist[v]);
+}
+
+std::shared_ptr<const NearestFacilityMap> FacilityIndex::nearestMap(FacilityKind kind, RouteMetric metric,
+                                                                    const EdgeCostsPtr& given) const {
+    const EdgeCostsPtr costs = given ? given : freeFlowSnapshot(m_graph);
+    const size_t kk = static_cast<size_t>(kind);
+    const size_t mm = metric == RouteMetric::TravelTime ? 1 : 0;
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        if (m_cache[kk][mm] && m_cache[kk][mm]->costs == costs) return m_cache[kk][mm];
+    }
+
+    // Sweep outside the lock; a concurrent caller may sweep the same costs too
+    auto map = std::make_shared<NearestFacilityMap>();
+    map->costs = costs;
+    map->metric = metric;
+    if (metric == RouteMetric::TravelTime) sweep(kind, costs->duration.data(), *map);
+    else sweep(kind, costs->weight.data(), *map);
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_cache[kk][mm] = map;
+    return map;
+}
+
+const FacilityIndex& getFacilityIndex() {
+    static std::unique_ptr<FacilityIndex> index;
+    static std::once_flag built;
+    std::call_once(built, [] {
+        index = std::make_unique<FacilityIndex>(getRoadGraph(), getSegmentIndex(), getLoadedFacilities());
+    });
+    return *index;
+}
@@ -0,0 +1,98 @@
+#ifndef FACILITIES
+#define FACILITIES
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "a_star.hpp"
+#include "edge_costs.hpp"
+#include "segment_index.hpp"
+
+// Points of interest that emergency and fleet queries route to
+enum class FacilityKind : uint8_t { Hospital, Fuel, Police, FireStation, Pharmacy };
+constexpr size_t FACILITY_KIND_COUNT = 5;
+
+// "hospital", "fuel", "police", "fire_station", "pharmacy" (the amenity values)
+const char* facilityKindName(FacilityKind kind);
+bool parseFacilityKind(const std::string& name, FacilityKind& kind);
+
+// Kind of an OSM node or area from its tags; false if it is no facility.
+// tag returns the value of a key or nullptr.
+bool facilityKindFromTags(const std::function<const char*(const char*)>& tag, FacilityKind& kind);
+
+struct Facility {
+    int64_t osmId = 0;
+    FacilityKind kind = FacilityKind::Hospital;
+    std::string name;
+    double lat = 0.0, lon = 0.0;
+    uint32_t node = INVALID_NODE; // road node it is reached at, INVALID_NODE if no road is near
+};
+
+struct FacilityHit {
+    uint32_t facility = 0; // index into FacilityIndex::facilities()
+    double cost = 0.0;     // meters or seconds by road from the query node
+};
+
+// Nearest facility of one kind for every node, and the first edge towards it
+struct NearestFacilityMap {
+    EdgeCostsPtr costs;
+    RouteMetric metric = RouteMetric::Distance;
+    std::vector<uint32_t> facility; // node -> facility index, INVALID_NODE if none reachable
+    std::vector<float> cost;        // node -> cost to get there
+    std::vector<uint32_t> nextEdge; // node -> edge to leave by, INVALID_EDGE at a facility
+};
+
+// Facilities snapped onto the road graph. Each one is reached at the nearer
+// end of the closest road segment cars may use.
+class FacilityIndex {
+public:
+    FacilityIndex(const RoadGraph& g, const SegmentIndex& segments, std::vector<Facility> facilities);
+
+    const std::vector<Facility>& facilities() const { return m_facilities; }
+    size_t count(FacilityKind kind) const;
+
+    // The k facilities of kind closest to node `from` by road, nearest first.
+    // One Dijkstra settles outwards and stops at the k-th facility instead of
+    // routing to every candidate.
+    std::vector<FacilityHit> nearest(uint32_t from, FacilityKind kind, size_t k,
+                                     RouteMetric metric = RouteMetric::Distance,
+                                     const EdgeCostsPtr& costs = nullptr) const;
+
+    // Nearest facility of kind from every node: one Dijkstra over reversed
+    // edges seeded at all facilities at once. Computed on first use for each
+    // kind and metric and again whenever costs differ from the cached ones.
+    // Null costs, here and in nearest(), mean the car's free flow.
+    std::shared_ptr<const NearestFacilityMap> nearestMap(FacilityKind kind,
+                                                         RouteMetric metric = RouteMetric::Distance,
+                                                         const EdgeCostsPtr& costs = nullptr) const;
+
+private:
+    const RoadGraph& m_graph;
+    std::vector<Facility> m_facilities;
+    // Per kind: (road node, facility) sorted by node, and the nodes alone with repeats
+    std::vector<std::pair<uint32_t, uint32_t>> m_byNode[FACILITY_KIND_COUNT];
+    std::vector<uint32_t> m_nodesOf[FACILITY_KIND_COUNT];
+
+    ReverseAdjacency m_reverse; // for the all-nodes sweeps
+
+    mutable std::mutex m_cacheMutex;
+    mutable std::shared_ptr<const NearestFacilityMap> m_cache[FACILITY_KIND_COUNT][2];
+
+    template <typename Cost>
+    void sweep(FacilityKind kind, const Cost* cost, NearestFacilityMap& map) const;
+};
+
+// Facilities found while loading the map; defined by the loader
+const std::vector<Facility>& getLoadedFacilities();
+
+// Index over the loaded facilities, built on first use
+const FacilityIndex& getFacilityIndex();
+
+#endif
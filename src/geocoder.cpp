@@ -0,0 +1,66 @@
+#include "geocoder.hpp"
+#include "road_graph.hpp"
+#include "segment_index.hpp"
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+
+ReverseGeocodeResult reverseGeocode(double lat, double lon, double maxDistance) {
+    ReverseGeocodeResult result;
+    const SegmentIndex& index = getSegmentIndex();
+
+    SegmentHit hit = index.nearest(lat, lon, maxDistance, true);
+    if (hit.segment == UINT32_MAX) return result;
+
+    const RoadGraph& g = getRoadGraph();
+    const RoadSegment& seg = index.segment(hit.segment);
+    const WayInfo& way = g.ways[seg.way];
+
+    result.found = true;
+    result.wayId = way.osmId;
+    result.roadName = g.names[way.name];
+    result.highway = roadClassName(way.roadClass);
+    result.distance = hit.distance;
+    result.positionAlong = seg.offset + hit.fraction * seg.length;
+    result.lat = hit.lat;
+    result.lon = hit.lon;
+    return result;
+}
+
+// Quote a CSV field if it needs it
+static std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string q = "\"";
+    for (char c : s) {
+        if (c == '"') q += '"';
+        q += c;
+    }
+    return q + "\"";
+}
+
+size_t reverseGeocodeStream(std::istream& in, std::ostream& out, double maxDistance) {
+    size_t count = 0;
+    std::string line;
+    out << "lat,lon,way_id,name,highway,distance_m,position_m\n";
+    out << std::fixed;
+
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        double lat, lon;
+        char comma;
+        if (!(ss >> lat >> comma >> lon) || comma != ',') continue; // header or malformed
+
+        ReverseGeocodeResult r = reverseGeocode(lat, lon, maxDistance);
+        out << std::setprecision(7) << lat << ',' << lon << ',';
+        if (r.found) {
+            out << r.wayId << ',' << csvField(r.roadName) << ',' << r.highway << ','
+                << std::setprecision(1) << r.distance << ',' << r.positionAlong << '\n';
+        } else {
+            out << ",,,,\n";
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,27 @@
+#ifndef GEOCODER
+#define GEOCODER
+
+#include <string>
+#include <cstdint>
+#include <iosfwd>
+
+// Nearest named road to a point
+struct ReverseGeocodeResult {
+    bool found = false;
+    int64_t wayId = 0;          // OSM way id
+    std::string roadName;
+    std::string highway;
+    double distance = 0.0;      // meters from the point to the road
+    double positionAlong = 0.0; // meters from the first node of the way to the projected point
+    double lat = 0.0, lon = 0.0; // projected point on the road
+};
+
+// Look up the nearest named way within maxDistance meters of lat/lon.
+// The segment index over the loaded graph is built on first use.
+ReverseGeocodeResult reverseGeocode(double lat, double lon, double maxDistance = 500.0);
+
+// Batch mode: read "lat,lon" lines, write one CSV row per point
+// (lat,lon,way_id,name,highway,distance_m,position_m). Returns points processed.
+size_t reverseGeocodeStream(std::istream& in, std::ostream& out, double maxDistance = 500.0);
+
+#endif
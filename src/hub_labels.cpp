@@ -0,0 +1,307 @@
+#include "hub_labels.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const double INF = std::numeric_limits<double>::infinity();
+static const char MAGIC[8] = {'H', 'U', 'B', 'L', 'A', 'B', 'L', '1'};
+
+// File image, in native byte order. Sections follow the header in this
+// order, each starting on a 64-byte boundary.
+struct HubLabels::Header {
+    char magic[8];
+    uint64_t nodeCount, edgeCount; // of the graph the labels belong to
+    uint64_t forwardEntries, backwardEntries;
+    uint32_t metric; // RouteMetric
+    uint32_t reserved;
+};
+
+struct Layout {
+    size_t label, forwardFirst, backwardFirst, forwardHub, forwardCost, backwardHub, backwardCost, total;
+};
+
+static Layout layout(uint64_t n, uint64_t forward, uint64_t backward) {
+    auto align = [](size_t x) { return (x + 63) & ~static_cast<size_t>(63); };
+    Layout l;
+    size_t at = align(sizeof(HubLabels::Header));
+    l.label = at;         at = align(at + n * sizeof(uint32_t));
+    l.forwardFirst = at;  at = align(at + (n + 1) * sizeof(uint64_t));
+    l.backwardFirst = at; at = align(at + (n + 1) * sizeof(uint64_t));
+    l.forwardHub = at;    at = align(at + forward * sizeof(uint32_t));
+    l.forwardCost = at;   at = align(at + forward * sizeof(float));
+    l.backwardHub = at;   at = align(at + backward * sizeof(uint32_t));
+    l.backwardCost = at;  at = align(at + backward * sizeof(float));
+    l.total = at;
+    return l;
+}
+
+// Scratch of one worker: cost per hub of the label being built
+struct LabelScratch {
+    std::vector<double> cost;
+    std::vector<uint32_t> touched;
+};
+
+HubLabels::HubLabels(const RoadGraph& g, const CustomizableCH& ch, const CchMetric& metric, RouteMetric kind,
+                     unsigned threads)
+{
+    const size_t n = ch.nodeCount();
+
+    // A node's upward neighbours are all its elimination tree ancestors, so
+    // nodes of equal depth can be labelled side by side once the depths
+    // above them are done
+    std::vector<uint32_t> depth(n, 0);
+    uint32_t maxDepth = 0;
+    for (size_t r = n; r-- > 0;) {
+        if (ch.m_parent[r] != INVALID_NODE) depth[r] = depth[ch.m_parent[r]] + 1;
+        maxDepth = std::max(maxDepth, depth[r]);
+    }
+    std::vector<std::vector<uint32_t>> byDepth(n ? maxDepth + 1 : 0);
+    for (uint32_t r = 0; r < n; ++r) byDepth[depth[r]].push_back(r);
+
+    // Per rank and direction (0 forward, 1 backward): hubs by rank and costs
+    std::vector<std::vector<uint32_t>> hubs[2] = {std::vector<std::vector<uint32_t>>(n),
+                                                  std::vector<std::vector<uint32_t>>(n)};
+    std::vector<std::vector<float>> costs[2] = {std::vector<std::vector<float>>(n),
+                                                std::vector<std::vector<float>>(n)};
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<LabelScratch> scratch(threads);
+    for (auto& s : scratch) s.cost.assign(n, INF);
+
+    auto label = [&](uint32_t v, int dir, LabelScratch& s) {
+        const std::vector<double>& arcCost = dir == 0 ? metric.up : metric.down;
+        s.cost[v] = 0.0;
+        s.touched.push_back(v);
+        for (uint32_t a = ch.m_firstArc[v]; a < ch.m_firstArc[v + 1]; ++a) {
+            const double c = arcCost[a];
+            if (c == INF) continue;
+            const uint32_t w = ch.m_arcHead[a];
+            const auto& wh = hubs[dir][w];
+            const auto& wc = costs[dir][w];
+            for (size_t k = 0; k < wh.size(); ++k) {
+                const double d = c + wc[k];
+                if (d < s.cost[wh[k]]) {
+                    if (s.cost[wh[k]] == INF) s.touched.push_back(wh[k]);
+                    s.cost[wh[k]] = d;
+                }
+            }
+        }
+        std::sort(s.touched.begin(), s.touched.end());
+
+        // Drop (h, d) when some hub x already in the label offers a cheaper
+        // way between v and h; h's opposite label holds the h side of that
+        auto& outHubs = hubs[dir][v];
+        auto& outCosts = costs[dir][v];
+        for (uint32_t h : s.touched) {
+            const double d = s.cost[h];
+            bool dominated = false;
+            if (h != v) {
+                const auto& xh = hubs[1 - dir][h];
+                const auto& xc = costs[1 - dir][h];
+                for (size_t k = 0; k < xh.size() && !dominated; ++k) dominated = s.cost[xh[k]] + xc[k] < d;
+            }
+            if (!dominated) {
+                outHubs.push_back(h);
+                outCosts.push_back(static_cast<float>(d));
+            }
+        }
+        for (uint32_t h : s.touched) s.cost[h] = INF;
+        s.touched.clear();
+    };
+
+    for (const auto& nodes : byDepth) {
+        // Levels near the root are a handful of nodes; no threads for those
+        const unsigned levelThreads = static_cast<unsigned>(std::min<size_t>(threads, (nodes.size() + 63) / 64));
+        parallelFor(nodes.size(), levelThreads, [&](size_t i, unsigned worker) {
+            label(nodes[i], 0, scratch[worker]);
+            label(nodes[i], 1, scratch[worker]);
+        });
+    }
+
+    // Flatten into the file image
+    uint64_t entries[2] = {0, 0};
+    for (int dir = 0; dir < 2; ++dir) {
+        for (const auto& h : hubs[dir]) entries[dir] += h.size();
+    }
+    const Layout l = layout(n, entries[0], entries[1]);
+    m_owned.assign((l.total + 7) / 8, 0);
+    char* image = reinterpret_cast<char*>(m_owned.data());
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.nodeCount = n;
+    header.edgeCount = g.edgeCount();
+    header.forwardEntries = entries[0];
+    header.backwardEntries = entries[1];
+    header.metric = static_cast<uint32_t>(kind);
+    std::memcpy(image, &header, sizeof(header));
+
+    for (uint32_t v = 0; v < n; ++v) reinterpret_cast<uint32_t*>(image + l.label)[v] = ch.rank(v);
+    const size_t firstAt[2] = {l.forwardFirst, l.backwardFirst};
+    const size_t hubAt[2] = {l.forwardHub, l.backwardHub};
+    const size_t costAt[2] = {l.forwardCost, l.backwardCost};
+    for (int dir = 0; dir < 2; ++dir) {
+        uint64_t* first = reinterpret_cast<uint64_t*>(image + firstAt[dir]);
+        uint32_t* hubOut = reinterpret_cast<uint32_t*>(image + hubAt[dir]);
+        float* costOut = reinterpret_cast<float*>(image + costAt[dir]);
+        first[0] = 0;
+        for (uint32_t r = 0; r < n; ++r) {
+            std::copy(hubs[dir][r].begin(), hubs[dir][r].end(), hubOut + first[r]);
+            std::copy(costs[dir][r].begin(), costs[dir][r].end(), costOut + first[r]);
+            first[r + 1] = first[r] + hubs[dir][r].size();
+            std::vector<uint32_t>().swap(hubs[dir][r]);
+            std::vector<float>().swap(costs[dir][r]);
+        }
+    }
+    attach(image, l.total);
+}
+
+HubLabels::~HubLabels() {
+    if (m_mapping) munmap(m_mapping, m_size);
+}
+
+bool HubLabels::attach(const void* data, size_t size) {
+    if (size < sizeof(Header)) return false;
+    const char* base = static_cast<const char*>(data);
+    const Header* header = reinterpret_cast<const Header*>(base);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+    const Layout l = layout(header->nodeCount, header->forwardEntries, header->backwardEntries);
+    if (size < l.total) return false;
+
+    m_header = header;
+    m_size = size;
+    m_label = reinterpret_cast<const uint32_t*>(base + l.label);
+    m_forwardFirst = reinterpret_cast<const uint64_t*>(base + l.forwardFirst);
+    m_backwardFirst = reinterpret_cast<const uint64_t*>(base + l.backwardFirst);
+    m_forwardHub = reinterpret_cast<const uint32_t*>(base + l.forwardHub);
+    m_forwardCost = reinterpret_cast<const float*>(base + l.forwardCost);
+    m_backwardHub = reinterpret_cast<const uint32_t*>(base + l.backwardHub);
+    m_backwardCost = reinterpret_cast<const float*>(base + l.backwardCost);
+    return true;
+}
+
+bool HubLabels::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(m_header), static_cast<std::streamsize>(m_size));
+    return static_cast<bool>(file);
+}
+
+std::unique_ptr<HubLabels> HubLabels::open(const std::string& path, const RoadGraph& g) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open label file " << path << "\n";
+        return nullptr;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd); // the mapping stays valid
+    if (data == MAP_FAILED) {
+        std::cerr << "Cannot map label file " << path << "\n";
+        return nullptr;
+    }
+
+    std::unique_ptr<HubLabels> labels(new HubLabels());
+    labels->m_mapping = data;
+    labels->m_size = static_cast<size_t>(st.st_size);
+    if (!labels->attach(data, labels->m_size)) {
+        std::cerr << path << " is not a label file\n";
+        return nullptr;
+    }
+    if (labels->m_header->nodeCount != g.nodeCount() || labels->m_header->edgeCount != g.edgeCount()) {
+        std::cerr << path << " was built for another road graph\n";
+        return nullptr;
+    }
+    return labels;
+}
+
+// Smallest a-cost + b-cost over hubs in both sorted labels
+static float intersect(const uint32_t* aHub, const float* aCost, size_t aCount,
+                       const uint32_t* bHub, const float* bCost, size_t bCount) {
+    float best = std::numeric_limits<float>::infinity();
+    size_t i = 0, j = 0;
+#if defined(__SSE2__)
+    // Four hubs against four: compare with the b block rotated through all
+    // four lanes, keep the cheapest sum where hubs match, then step past
+    // whichever block ends lower (both if they end alike)
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 bestv = inf;
+    while (i + 4 <= aCount && j + 4 <= bCount) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aHub + i));
+        const __m128 ac = _mm_loadu_ps(aCost + i);
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bHub + j));
+        __m128 bc = _mm_loadu_ps(bCost + j);
+        for (int rot = 0; rot < 4; ++rot) {
+            const __m128 match = _mm_castsi128_ps(_mm_cmpeq_epi32(a, b));
+            const __m128 sum = _mm_add_ps(ac, bc);
+            bestv = _mm_min_ps(bestv, _mm_or_ps(_mm_and_ps(match, sum), _mm_andnot_ps(match, inf)));
+            b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+            bc = _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 3, 2, 1));
+        }
+        const uint32_t aLast = aHub[i + 3], bLast = bHub[j + 3];
+        if (aLast <= bLast) i += 4;
+        if (bLast <= aLast) j += 4;
+    }
+    bestv = _mm_min_ps(bestv, _mm_shuffle_ps(bestv, bestv, _MM_SHUFFLE(2, 3, 0, 1)));
+    bestv = _mm_min_ps(bestv, _mm_shuffle_ps(bestv, bestv, _MM_SHUFFLE(1, 0, 3, 2)));
+    best = _mm_cvtss_f32(bestv);
+#endif
+    while (i < aCount && j < bCount) {
+        if (aHub[i] < bHub[j]) {
+            ++i;
+        } else if (bHub[j] < aHub[i]) {
+            ++j;
+        } else {
+            best = std::min(best, aCost[i] + bCost[j]);
+            ++i;
+            ++j;
+        }
+    }
+    return best;
+}
+
+double HubLabels::distance(uint32_t source, uint32_t target) const {
+    if (source >= m_header->nodeCount || target >= m_header->nodeCount) return INF;
+    const uint32_t s = m_label[source], t = m_label[target];
+    const uint64_t fs = m_forwardFirst[s], bt = m_backwardFirst[t];
+    return intersect(m_forwardHub + fs, m_forwardCost + fs, m_forwardFirst[s + 1] - fs,
+                     m_backwardHub + bt, m_backwardCost + bt, m_backwardFirst[t + 1] - bt);
+}
+
+std::vector<double> HubLabels::distances(const std::vector<uint32_t>& sources,
+                                         const std::vector<uint32_t>& targets) const {
+    std::vector<double> result(sources.size() * targets.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        for (size_t j = 0; j < targets.size(); ++j) result[i * targets.size() + j] = distance(sources[i], targets[j]);
+    }
+    return result;
+}
+
+RouteMetric HubLabels::metric() const {
+    return static_cast<RouteMetric>(m_header->metric);
+}
+
+size_t HubLabels::nodeCount() const {
+    return m_header->nodeCount;
+}
+
+size_t HubLabels::entryCount() const {
+    return m_header->forwardEntries + m_header->backwardEntries;
+}
@@ -0,0 +1,76 @@
+#ifndef HUB_LABELS
+#define HUB_LABELS
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "customizable_ch.hpp"
+#include "a_star.hpp"
+
+// Hub labeling distance oracle. Every node keeps a forward label (hubs it
+// reaches, with the cost) and a backward label (hubs that reach it); the
+// cost s -> t is the smallest sum over hubs in both s's forward and t's
+// backward label. Labels are sorted by hub, so a query is one merge of two
+// short arrays with no graph access at all.
+//
+// Labels come from a customized hierarchy, top down: a node's label is its
+// upward neighbours' labels extended by the arc costs, minus the entries
+// that a path through some other hub already beats.
+//
+// On disk and in memory labels share one layout, so a label file is used
+// straight from a read-only mapping: a header, node -> label index, label
+// offsets, then hub ids and costs in separate arrays. Costs are stored as
+// 32-bit floats, halving the labels against doubles (centimetres at 100 km).
+class HubLabels {
+public:
+    // Labels of g for one customization of ch; threads == 0 uses every core
+    HubLabels(const RoadGraph& g, const CustomizableCH& ch, const CchMetric& metric, RouteMetric kind,
+              unsigned threads = 0);
+    ~HubLabels();
+    HubLabels(const HubLabels&) = delete;
+    HubLabels& operator=(const HubLabels&) = delete;
+
+    // Write the labels to path; false if the file could not be written
+    bool save(const std::string& path) const;
+
+    // Map a label file written by save() for graph g; nullptr if it cannot be
+    // read or was built for another graph
+    static std::unique_ptr<HubLabels> open(const std::string& path, const RoadGraph& g);
+
+    // Cost from source to target (graph node ids), infinity if unreachable
+    double distance(uint32_t source, uint32_t target) const;
+
+    // Cost from every source to every target, row-major
+    std::vector<double> distances(const std::vector<uint32_t>& sources, const std::vector<uint32_t>& targets) const;
+
+    RouteMetric metric() const;
+    size_t nodeCount() const;
+    size_t entryCount() const; // forward and backward label entries together
+    size_t byteSize() const { return m_size; }
+
+    struct Header;
+
+private:
+    HubLabels() = default;
+
+    std::vector<uint64_t> m_owned; // the image when built here, 8-byte aligned
+    void* m_mapping = nullptr;     // the image when mapped from a file
+    size_t m_size = 0;
+
+    const Header* m_header = nullptr;
+    const uint32_t* m_label = nullptr; // graph node -> label index
+    const uint64_t* m_forwardFirst = nullptr;
+    const uint64_t* m_backwardFirst = nullptr;
+    const uint32_t* m_forwardHub = nullptr;
+    const float* m_forwardCost = nullptr;
+    const uint32_t* m_backwardHub = nullptr;
+    const float* m_backwardCost = nullptr;
+
+    bool attach(const void* data, size_t size);
+};
+
+#endif
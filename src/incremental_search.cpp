@@ -0,0 +1,253 @@
+#include "incremental_search.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+IncrementalSearch::IncrementalSearch(const RoadGraph& g)
+    : m_graph(g),
+      m_reverse(reverseAdjacency(g)),
+      m_g(g.nodeCount()),
+      m_rhs(g.nodeCount()),
+      m_key(g.nodeCount()),
+      m_queued(g.nodeCount(), 0),
+      m_stamp(g.nodeCount(), 0)
+{
+}
+
+// fn(edge, node at its other end)
+template <typename Fn>
+void IncrementalSearch::forEachTowardRoot(uint32_t v, Fn&& fn) const {
+    if (m_rootIsStart) {
+        for (uint32_t a = m_reverse.firstIn[v]; a < m_reverse.firstIn[v + 1]; ++a) fn(m_reverse.edge[a], m_reverse.tail[a]);
+    } else {
+        for (uint32_t e = m_graph.firstOut[v]; e < m_graph.firstOut[v + 1]; ++e) fn(e, m_graph.head[e]);
+    }
+}
+
+template <typename Fn>
+void IncrementalSearch::forEachAwayFromRoot(uint32_t v, Fn&& fn) const {
+    if (m_rootIsStart) {
+        for (uint32_t e = m_graph.firstOut[v]; e < m_graph.firstOut[v + 1]; ++e) fn(e, m_graph.head[e]);
+    } else {
+        for (uint32_t a = m_reverse.firstIn[v]; a < m_reverse.firstIn[v + 1]; ++a) fn(m_reverse.edge[a], m_reverse.tail[a]);
+    }
+}
+
+// Equirectangular straight line, consistent like the A* bound
+double IncrementalSearch::heuristic(uint32_t a, uint32_t b) const {
+    const Node& p = m_graph.coords[a];
+    const Node& q = m_graph.coords[b];
+    double dy = static_cast<double>(p.lat - q.lat) * m_graph.metersPerLatUnit;
+    double dx = static_cast<double>(p.lon - q.lon) * m_graph.metersPerLonUnit;
+    return std::sqrt(dx * dx + dy * dy) * m_heuristicScale;
+}
+
+void IncrementalSearch::touch(uint32_t v) {
+    if (m_stamp[v] == m_round) return;
+    m_stamp[v] = m_round;
+    m_g[v] = m_rhs[v] = INF;
+    m_queued[v] = 0;
+}
+
+IncrementalSearch::Key IncrementalSearch::calculateKey(uint32_t v) const {
+    double m = std::min(m_g[v], m_rhs[v]);
+    return {m + heuristic(m_endpoint, v) + m_km, m};
+}
+
+// Queue v while it is inconsistent, under its current key
+void IncrementalSearch::updateQueue(uint32_t v) {
+    if (m_g[v] != m_rhs[v]) {
+        Key k = calculateKey(v);
+        if (!m_queued[v] || !(m_key[v] == k)) {
+            m_key[v] = k;
+            m_queued[v] = 1;
+            m_queue.push({k, v});
+        }
+    } else {
+        m_queued[v] = 0;
+    }
+}
+
+double IncrementalSearch::bestRhs(uint32_t v) const {
+    double best = INF;
+    forEachTowardRoot(v, [&](uint32_t e, uint32_t u) {
+        if (m_stamp[u] == m_round) best = std::min(best, m_g[u] + cost(e));
+    });
+    return best;
+}
+
+IncrementalSearch::Key IncrementalSearch::topKey() {
+    while (!m_queue.empty()) {
+        const Entry& top = m_queue.top();
+        if (m_queued[top.node] && m_stamp[top.node] == m_round && m_key[top.node] == top.key) return top.key;
+        m_queue.pop(); // stale
+    }
+    return {INF, INF};
+}
+
+void IncrementalSearch::reset(uint32_t root, bool rootIsStart, uint32_t endpoint, RouteMetric metric,
+                              EdgeCostsPtr costs) {
+    m_root = root;
+    m_rootIsStart = rootIsStart;
+    m_endpoint = endpoint;
+    m_km = 0.0;
+    m_costs = costs ? std::move(costs) : freeFlowSnapshot(m_graph);
+    if (metric == RouteMetric::TravelTime) {
+        m_weight = nullptr;
+        m_duration = m_costs->duration.data();
+        m_heuristicScale = m_graph.maxSpeed > 0.0 ? 1.0 / m_graph.maxSpeed : 0.0;
+    } else {
+        m_weight = m_costs->weight.data();
+        m_duration = nullptr;
+        m_heuristicScale = 1.0;
+    }
+
+    // New round; on wrap-around really clear the stamps once
+    if (++m_round == 0) {
+        std::fill(m_stamp.begin(), m_stamp.end(), 0);
+        m_round = 1;
+    }
+    m_queue = {};
+    touch(m_root);
+    m_rhs[m_root] = 0.0;
+    updateQueue(m_root);
+}
+
+void IncrementalSearch::computeShortestPath() {
+    m_expanded = 0;
+    touch(m_endpoint);
+    for (;;) {
+        Key top = topKey();
+        if (!(top < calculateKey(m_endpoint)) && m_rhs[m_endpoint] == m_g[m_endpoint]) break;
+        if (top.k1 == INF) break; // queue ran dry
+
+        const uint32_t u = m_queue.top().node;
+        const Key fresh = calculateKey(u);
+        if (top < fresh) {
+            // Queued before the endpoint last moved; requeue under the current key
+            m_queue.pop();
+            m_key[u] = fresh;
+            m_queue.push({fresh, u});
+            continue;
+        }
+        m_queue.pop();
+        m_queued[u] = 0;
+        m_expanded++;
+
+        if (m_g[u] > m_rhs[u]) {
+            // Overconsistent: settle, then offer u to the nodes that may build on it
+            m_g[u] = m_rhs[u];
+            forEachAwayFromRoot(u, [&](uint32_t e, uint32_t s) {
+                const double w = cost(e);
+                if (w == INF || s == m_root) return;
+                touch(s);
+                if (m_g[u] + w < m_rhs[s]) {
+                    m_rhs[s] = m_g[u] + w;
+                    updateQueue(s);
+                }
+            });
+        } else {
+            // Underconsistent: forget g, and whoever relied on it looks again
+            const double old = m_g[u];
+            m_g[u] = INF;
+            forEachAwayFromRoot(u, [&](uint32_t e, uint32_t s) {
+                const double w = cost(e);
+                if (w == INF || s == m_root) return;
+                touch(s);
+                if (m_rhs[s] == old + w) {
+                    m_rhs[s] = bestRhs(s);
+                    updateQueue(s);
+                }
+            });
+            if (u != m_root) m_rhs[u] = bestRhs(u);
+            updateQueue(u);
+        }
+    }
+}
+
+double IncrementalSearch::moveTo(uint32_t v) {
+    if (m_root == INVALID_NODE || v >= m_graph.nodeCount()) return INF;
+    if (v != m_endpoint) {
+        m_km += heuristic(m_endpoint, v);
+        m_endpoint = v;
+    }
+    computeShortestPath();
+    return m_g[m_endpoint];
+}
+
+void IncrementalSearch::useCosts(EdgeCostsPtr costs) {
+    if (!costs) costs = freeFlowSnapshot(m_graph);
+    if (costs == m_costs || m_root == INVALID_NODE) return;
+    const RouteMetric metric = m_weight ? RouteMetric::Distance : RouteMetric::TravelTime;
+    auto newCost = [&](uint32_t e) -> double {
+        if (m_weight) return costs->weight[e];
+        return costs->duration[e];
+    };
+
+    std::vector<uint32_t> changed;
+    for (uint32_t e = 0; e < m_graph.edgeCount(); ++e) {
+        if (newCost(e) != cost(e)) changed.push_back(e);
+    }
+    if (changed.size() > m_graph.nodeCount() / 8) {
+        // Repairing would touch most of the tree anyway
+        reset(m_root, m_rootIsStart, m_endpoint, metric, std::move(costs));
+        return;
+    }
+
+    // Node whose rhs uses edge e, and the node it uses it from
+    std::vector<std::pair<uint32_t, double>> before;
+    before.reserve(changed.size());
+    for (uint32_t e : changed) before.push_back({e, cost(e)});
+
+    m_costs = std::move(costs);
+    if (m_weight) m_weight = m_costs->weight.data();
+    else m_duration = m_costs->duration.data();
+
+    for (const auto& [e, old] : before) {
+        uint32_t tail = INVALID_NODE;
+        for (uint32_t a = m_reverse.firstIn[m_graph.head[e]]; a < m_reverse.firstIn[m_graph.head[e] + 1]; ++a) {
+            if (m_reverse.edge[a] == e) tail = m_reverse.tail[a];
+        }
+        const uint32_t from = m_rootIsStart ? tail : m_graph.head[e]; // closer to the root
+        const uint32_t to = m_rootIsStart ? m_graph.head[e] : tail;
+        if (to == m_root || m_stamp[from] != m_round) continue; // from was never reached
+        touch(to);
+        const double now = cost(e);
+        if (now < old) {
+            m_rhs[to] = std::min(m_rhs[to], m_g[from] + now);
+        } else if (m_rhs[to] == m_g[from] + old) {
+            m_rhs[to] = bestRhs(to);
+        }
+        updateQueue(to);
+    }
+}
+
+std::vector<uint32_t> IncrementalSearch::edgePath() const {
+    std::vector<uint32_t> edges;
+    if (m_root == INVALID_NODE || m_stamp[m_endpoint] != m_round || m_g[m_endpoint] == INF) return edges;
+
+    // Walk from the endpoint to the root along the cheapest tree edges
+    uint32_t v = m_endpoint;
+    while (v != m_root && edges.size() < m_graph.nodeCount()) {
+        uint32_t bestEdge = INVALID_EDGE, bestNode = INVALID_NODE;
+        double best = INF;
+        forEachTowardRoot(v, [&](uint32_t e, uint32_t u) {
+            if (m_stamp[u] != m_round) return;
+            double c = m_g[u] + cost(e);
+            if (c < best) {
+                best = c;
+                bestEdge = e;
+                bestNode = u;
+            }
+        });
+        if (bestEdge == INVALID_EDGE) return {};
+        edges.push_back(bestEdge);
+        v = bestNode;
+    }
+    if (v != m_root) return {};
+    if (m_rootIsStart) std::reverse(edges.begin(), edges.end());
+    return edges;
+}
@@ -0,0 +1,93 @@
+#ifndef INCREMENTAL_SEARCH
+#define INCREMENTAL_SEARCH
+
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+#include "a_star.hpp"
+
+// D* Lite (Koenig & Likhachev) between a fixed root and a free endpoint.
+// The search tree hangs off the root, so moving the free endpoint only shifts
+// the heuristic's focus (accumulated in km) and edge cost changes only
+// disturb the nodes below the changed edges; each moveTo repairs what the
+// change made inconsistent instead of searching from scratch. One instance
+// per thread; it holds per-node scratch.
+class IncrementalSearch {
+public:
+    explicit IncrementalSearch(const RoadGraph& g);
+
+    // Start over. With rootIsStart paths run root -> endpoint (the end moves),
+    // otherwise endpoint -> root (the start moves). costs == nullptr uses the
+    // car's free flow.
+    void reset(uint32_t root, bool rootIsStart, uint32_t endpoint, RouteMetric metric = RouteMetric::Distance,
+               EdgeCostsPtr costs = nullptr);
+
+    // Move the free endpoint to v and repair the tree; cost of the path, infinity if none
+    double moveTo(uint32_t v);
+
+    // Switch to new costs. Nodes at edges whose cost changed are queued and
+    // the next moveTo repairs from them; wide changes just start over.
+    void useCosts(EdgeCostsPtr costs);
+
+    // Edges of the current path in travel order; empty if there is none
+    std::vector<uint32_t> edgePath() const;
+
+    uint32_t root() const { return m_root; }
+    uint32_t endpoint() const { return m_endpoint; }
+    bool rootIsStart() const { return m_rootIsStart; }
+    const EdgeCostsPtr& costs() const { return m_costs; }
+    size_t expandedCount() const { return m_expanded; } // nodes expanded by the last moveTo
+
+private:
+    struct Key {
+        double k1, k2;
+        bool operator<(const Key& o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+        bool operator==(const Key& o) const { return k1 == o.k1 && k2 == o.k2; }
+    };
+    struct Entry {
+        Key key;
+        uint32_t node;
+        bool operator>(const Entry& o) const { return o.key < key; }
+    };
+
+    const RoadGraph& m_graph;
+    const ReverseAdjacency m_reverse;
+    EdgeCostsPtr m_costs;
+    const double* m_weight = nullptr;  // set for RouteMetric::Distance
+    const float* m_duration = nullptr; // set for RouteMetric::TravelTime
+    double m_heuristicScale = 1.0;     // meters -> cost units
+
+    uint32_t m_root = INVALID_NODE, m_endpoint = INVALID_NODE;
+    bool m_rootIsStart = true;
+    double m_km = 0.0;
+    size_t m_expanded = 0;
+
+    // Per-node state is valid only where m_stamp == m_round
+    std::vector<double> m_g, m_rhs;
+    std::vector<Key> m_key;           // key of the live queue entry
+    std::vector<uint8_t> m_queued;
+    std::vector<uint32_t> m_stamp;
+    uint32_t m_round = 0;
+    // Lazy deletion: an entry is live only if its node is queued under that key
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_queue;
+
+    double cost(uint32_t e) const { return m_weight ? m_weight[e] : m_duration[e]; }
+    double heuristic(uint32_t a, uint32_t b) const;
+    void touch(uint32_t v);
+    Key calculateKey(uint32_t v) const;
+    void updateQueue(uint32_t v);
+    double bestRhs(uint32_t v) const;
+    Key topKey();
+    void computeShortestPath();
+
+    // Edges whose cost v's rhs is built from (towards the root), and edges
+    // to the nodes that build theirs on v (away from it)
+    template <typename Fn> void forEachTowardRoot(uint32_t v, Fn&& fn) const;
+    template <typename Fn> void forEachAwayFromRoot(uint32_t v, Fn&& fn) const;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "instructions.hpp"
+#include "road_graph.hpp"
+
+#include <cmath>
+#include <string>
+
+constexpr double PI_CONST = 3.14159265358979323846;
+
+// Initial bearing a -> b in degrees clockwise from north (flat approximation, fine per edge)
+static double bearing(const Node& a, const Node& b) {
+    double dy = static_cast<double>(b.lat - a.lat);
+    double dx = static_cast<double>(b.lon - a.lon) * std::cos(a.latDeg() * PI_CONST / 180.0);
+    return std::atan2(dx, dy) * 180.0 / PI_CONST;
+}
+
+// Signed turn at via, positive to the right, in (-180, 180]
+static int turnAngle(const RoadGraph& g, uint32_t from, uint32_t via, uint32_t to) {
+    double turn = bearing(g.coords[via], g.coords[to]) - bearing(g.coords[from], g.coords[via]);
+    while (turn > 180.0) turn -= 360.0;
+    while (turn <= -180.0) turn += 360.0;
+    return static_cast<int>(std::lround(turn));
+}
+
+static Maneuver classifyTurn(int angle) {
+    int a = std::abs(angle);
+    if (a < 20) return Maneuver::Continue;
+    if (a >= 165) return Maneuver::UTurn;
+    if (angle > 0) return a < 50 ? Maneuver::SlightRight : (a < 130 ? Maneuver::Right : Maneuver::SharpRight);
+    return a < 50 ? Maneuver::SlightLeft : (a < 130 ? Maneuver::Left : Maneuver::SharpLeft);
+}
+
+// Could the traveller have gone somewhere else at via (other than back to from)?
+static bool isDecisionPoint(const RoadGraph& g, uint32_t from, uint32_t via, Profile profile) {
+    int options = 0;
+    for (uint32_t e = g.firstOut[via]; e < g.firstOut[via + 1]; e++) {
+        if (!(g.edgeAccess[e] & profileBit(profile))) continue;
+        if (g.head[e] != from) options++;
+    }
+    return options > 1;
+}
+
+// Does via have an exit off the roundabout other than the way back to from?
+static bool hasRoundaboutExit(const RoadGraph& g, uint32_t from, uint32_t via, Profile profile) {
+    for (uint32_t e = g.firstOut[via]; e < g.firstOut[via + 1]; e++) {
+        if (!(g.edgeAccess[e] & profileBit(profile))) continue;
+        if (g.head[e] != from && !g.ways[g.edgeWay[e]].roundabout) return true;
+    }
+    return false;
+}
+
+static const char* compassName(double bearingDeg) {
+    static const char* const names[] = {"north", "northeast", "east", "southeast",
+                                        "south", "southwest", "west", "northwest"};
+    int idx = static_cast<int>(std::lround((bearingDeg < 0 ? bearingDeg + 360.0 : bearingDeg) / 45.0)) % 8;
+    return names[idx];
+}
+
+static std::string ordinal(int n) {
+    int mod100 = n % 100;
+    const char* suffix = "th";
+    if (mod100 < 11 || mod100 > 13) {
+        if (n % 10 == 1) suffix = "st";
+        else if (n % 10 == 2) suffix = "nd";
+        else if (n % 10 == 3) suffix = "rd";
+    }
+    return std::to_string(n) + suffix;
+}
+
+static std::string describe(const Instruction& ins, double departBearing) {
+    std::string onto = ins.roadName.empty() ? "" : " onto " + ins.roadName;
+    switch (ins.type) {
+        case Maneuver::Depart:
+            return std::string("Head ") + compassName(departBearing) +
+                   (ins.roadName.empty() ? "" : " on " + ins.roadName);
+        case Maneuver::Continue:    return "Continue" + onto;
+        case Maneuver::SlightLeft:  return "Turn slight left" + onto;
+        case Maneuver::Left:        return "Turn left" + onto;
+        case Maneuver::SharpLeft:   return "Turn sharp left" + onto;
+        case Maneuver::SlightRight: return "Turn slight right" + onto;
+        case Maneuver::Right:       return "Turn right" + onto;
+        case Maneuver::SharpRight:  return "Turn sharp right" + onto;
+        case Maneuver::UTurn:       return "Make a U-turn" + onto;
+        case Maneuver::Roundabout:
+            return "At the roundabout, take the " + ordinal(ins.roundaboutExit) + " exit" + onto;
+        case Maneuver::Arrive:      return "Arrive at destination";
+    }
+    return "";
+}
+
+std::vector<Instruction> buildInstructions(const PathResult& path) {
+    std::vector<Instruction> out;
+    if (!path.found || path.nodeIds.empty()) return out;
+
+    const RoadGraph& g = getRoadGraph();
+    const auto& segs = path.segments;
+
+    std::vector<uint32_t> nodes;
+    nodes.reserve(path.nodeIds.size());
+    for (int64_t id : path.nodeIds) {
+        uint32_t v = g.toDense(id);
+        if (v == INVALID_NODE) return out; // path from another graph
+        nodes.push_back(v);
+    }
+
+    double departBearing = 0.0;
+    if (!segs.empty()) {
+        departBearing = bearing(g.coords[nodes[0]], g.coords[nodes[1]]);
+        const WayInfo& first = g.ways[segs[0].way];
+        out.push_back({Maneuver::Depart, path.nodeIds[0], g.names[first.name], 0.0f, 0.0f, 0, 0, ""});
+    }
+
+    int exitsPassed = 0;
+    for (size_t i = 0; i < segs.size(); i++) {
+        if (i > 0) {
+            const WayInfo& prev = g.ways[segs[i - 1].way];
+            const WayInfo& cur = g.ways[segs[i].way];
+            uint32_t from = nodes[i - 1], via = nodes[i], to = nodes[i + 1];
+
+            if (cur.roundabout) {
+                if (!prev.roundabout) {
+                    // entering: one instruction covers the whole roundabout
+                    out.push_back({Maneuver::Roundabout, path.nodeIds[i], "", 0.0f, 0.0f,
+                                   turnAngle(g, from, via, to), 0, ""});
+                    exitsPassed = 0;
+                } else if (hasRoundaboutExit(g, from, via, path.profile)) {
+                    exitsPassed++;
+                }
+            } else if (prev.roundabout && out.back().type == Maneuver::Roundabout) {
+                // leaving: complete the roundabout instruction with the exit taken
+                Instruction& r = out.back();
+                r.roundaboutExit = exitsPassed + 1;
+                r.roadName = g.names[cur.name];
+            } else if (prev.roundabout) {
+                // leaving a roundabout the route started on: exits count from the start
+                out.push_back({Maneuver::Roundabout, path.nodeIds[i], g.names[cur.name], 0.0f, 0.0f,
+                               turnAngle(g, from, via, to), exitsPassed + 1, ""});
+            } else {
+                int angle = turnAngle(g, from, via, to);
+                Maneuver m = classifyTurn(angle);
+                bool nameChanged = cur.name != prev.name;
+                if (nameChanged || (m != Maneuver::Continue && isDecisionPoint(g, from, via, path.profile))) {
+                    out.push_back({m, path.nodeIds[i], g.names[cur.name], 0.0f, 0.0f, angle, 0, ""});
+                }
+            }
+        }
+        out.back().distance += segs[i].distance;
+        out.back().duration += segs[i].duration;
+    }
+
+    // A path that ends inside a roundabout still needs an exit number
+    if (!out.empty() && out.back().type == Maneuver::Roundabout && out.back().roundaboutExit == 0) {
+        out.back().roundaboutExit = exitsPassed + 1;
+    }
+
+    out.push_back({Maneuver::Arrive, path.nodeIds.back(), "", 0.0f, 0.0f, 0, 0, ""});
+
+    for (auto& ins : out) ins.text = describe(ins, departBearing);
+    return out;
+}
@@ -0,0 +1,36 @@
+#ifndef INSTRUCTIONS
+#define INSTRUCTIONS
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "a_star.hpp"
+
+enum class Maneuver {
+    Depart,
+    Continue,
+    SlightLeft, Left, SharpLeft,
+    SlightRight, Right, SharpRight,
+    UTurn,
+    Roundabout,
+    Arrive
+};
+
+// One turn-by-turn step: do `type` at `nodeId`, then follow `roadName` for `distance` meters
+struct Instruction {
+    Maneuver type;
+    int64_t nodeId;
+    std::string roadName;
+    float distance;         // meters until the next instruction
+    float duration;         // seconds until the next instruction
+    int turnAngle;          // degrees, positive = right
+    int roundaboutExit;     // exit number for Maneuver::Roundabout, otherwise 0
+    std::string text;       // human readable form
+};
+
+// Turn a found path into instructions. Street changes are detected by
+// comparing interned name ids, so this is linear in the path length.
+std::vector<Instruction> buildInstructions(const PathResult& path);
+
+#endif
@@ -1,19 +1,388 @@
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <utility>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <limits>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "map_data.hpp"
 #include "a_star.hpp"
+#include "geocoder.hpp"
+#include "map_matching.hpp"
+#include "vrp.hpp"
+#include "edge_costs.hpp"
+#include "speed_profiles.hpp"
+#include "travel_profiles.hpp"
+#include "facilities.hpp"
+#include "anytime_search.hpp"
+#include "customizable_ch.hpp"
+#include "hub_labels.hpp"
+#include "phast.hpp"
+#include "overlay_graph.hpp"
+#include "delta_stepping.hpp"
+#include "pareto_search.hpp"
+#include "search.hpp"
 
 #include "windower.hpp"
 #include "renderer.hpp"
 
 
-int main(void)
+static void printUsage(const char* prog)
+{
+    std::cerr << "Usage: " << prog << " [--reverse-geocode <points.csv> [out.csv]]\n"
+              << "       " << prog << " [--match-traces <traces.csv> [out.csv]]\n"
+              << "       " << prog << " [--traffic-feed <updates.csv>]\n"
+              << "       " << prog << " [--plan-vehicles <stops.csv> <vehicles> <capacity> [out.csv]]\n"
+              << "       " << prog << " [--route-at <profiles.csv> <from_node> <to_node> <HH:MM>]\n"
+              << "       " << prog << " [--route-by <car|motorbike|bicycle|foot> <from_node> <to_node>]\n"
+              << "       " << prog << " [--route-anytime <from_node> <to_node> [deadline_ms]]\n"
+              << "       " << prog << " [--build-labels <out.hl> [distance|time]]\n"
+              << "       " << prog << " [--label-bench <labels.hl> [queries]]\n"
+              << "       " << prog << " [--route-pareto <from_node> <to_node>]\n"
+              << "       " << prog << " [--route-avoid <from_node> <to_node> <highway|toll>[,...]]\n"
+              << "       " << prog << " [--route-overlay <from_node> <to_node>]\n"
+              << "       " << prog << " [--sssp-bench [grid <side>] [sources] [threads]]\n"
+              << "       " << prog << " [--reach-counts <minutes> [sources] [out.csv]]\n"
+              << "       " << prog << " [--nearest <hospital|fuel|police|fire_station|pharmacy> <lat> <lon> [k]]\n"
+              << "       " << prog << " [--nearest-all <hospital|fuel|police|fire_station|pharmacy> [out.csv]]\n";
+}
+
+int main(int argc, char** argv)
 {  
     // Initialize A* pathfinding with map data
     initAStar("res/data/karachi.osm.pbf");
 
+    // Live traffic for the interactive map; batch modes run without opening a window
+    if (argc == 3 && std::string(argv[1]) == "--traffic-feed") {
+        startTrafficFeed(argv[2]);
+    } else if (argc > 1) {
+        std::string mode = argv[1];
+        if ((mode == "--reverse-geocode" || mode == "--match-traces") && argc >= 3) {
+            std::ifstream in(argv[2]);
+            if (!in) {
+                std::cerr << "Cannot open " << argv[2] << "\n";
+                return 1;
+            }
+            std::ofstream file;
+            if (argc >= 4) file.open(argv[3]);
+            std::ostream& out = argc >= 4 ? file : std::cout;
+
+            auto t0 = std::chrono::steady_clock::now();
+            bool matching = mode == "--match-traces";
+            size_t n = matching ? matchTraceStream(in, out) : reverseGeocodeStream(in, out);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            std::cerr << (matching ? "Map matched " : "Reverse geocoded ") << n << " points in " << secs << " s\n";
+            return 0;
+        }
+        if (mode == "--plan-vehicles" && argc >= 5) {
+            std::ifstream in(argv[2]);
+            if (!in) {
+                std::cerr << "Cannot open " << argv[2] << "\n";
+                return 1;
+            }
+            std::ofstream file;
+            if (argc >= 6) file.open(argv[5]);
+            std::ostream& out = argc >= 6 ? file : std::cout;
+
+            auto t0 = std::chrono::steady_clock::now();
+            size_t n = solveVrpStream(in, out, std::stoul(argv[3]), std::stod(argv[4]));
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            std::cerr << "Planned " << n << " stops in " << secs << " s\n";
+            return 0;
+        }
+        if (mode == "--route-at" && argc >= 6) {
+            std::ifstream in(argv[2]);
+            if (!in) {
+                std::cerr << "Cannot open " << argv[2] << "\n";
+                return 1;
+            }
+            SpeedProfiles& profiles = getSpeedProfiles();
+            size_t ways = profiles.load(in);
+            std::cerr << "Speed profiles: " << ways << " ways, " << profiles.profileCount() << " distinct profiles, "
+                      << profiles.breakpointCount() << " breakpoints, " << profiles.memoryBytes() / 1024 << " KiB\n";
+
+            int h = 0, m = 0;
+            if (std::sscanf(argv[5], "%d:%d", &h, &m) != 2) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            PathResult path = aStarDepartingAt(std::stoll(argv[3]), std::stoll(argv[4]), h * 3600.0 + m * 60.0);
+            if (!path.found) return 1;
+            long arrival = std::lround(path.arrival);
+            std::printf("Depart %02d:%02d, arrive %02ld:%02ld:%02ld after %.1f min, %.2f km\n", h, m,
+                        arrival / 3600 % 24, arrival / 60 % 60, arrival % 60, path.duration / 60.0,
+                        path.distance / 1000.0);
+            return 0;
+        }
+        if ((mode == "--nearest" && argc >= 5) || (mode == "--nearest-all" && argc >= 3)) {
+            FacilityKind kind;
+            if (!parseFacilityKind(argv[2], kind)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            const RoadGraph& g = getRoadGraph();
+            const FacilityIndex& index = getFacilityIndex();
+            std::cerr << index.count(kind) << " " << argv[2] << " facilities on the road network\n";
+            auto t0 = std::chrono::steady_clock::now();
+
+            if (mode == "--nearest") {
+                uint32_t from = g.toDense(findNearestNode(std::stod(argv[3]), std::stod(argv[4])));
+                size_t k = argc >= 6 ? std::stoul(argv[5]) : 3;
+                auto hits = index.nearest(from, kind, k, RouteMetric::Distance, getLiveCosts().snapshot());
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                for (const FacilityHit& h : hits) {
+                    const Facility& f = index.facilities()[h.facility];
+                    std::printf("%s (%lld): %.2f km by road\n", f.name.empty() ? "unnamed" : f.name.c_str(),
+                                static_cast<long long>(f.osmId), h.cost / 1000.0);
+                }
+                std::cerr << hits.size() << " found in " << ms << " ms\n";
+                return hits.empty() ? 1 : 0;
+            }
+
+            auto map = index.nearestMap(kind, RouteMetric::Distance, getLiveCosts().snapshot());
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            std::ofstream file;
+            if (argc >= 4) file.open(argv[3]);
+            std::ostream& out = argc >= 4 ? file : std::cout;
+            out << "node_id,facility_id,distance_m\n";
+            for (uint32_t v = 0; v < g.nodeCount(); ++v) {
+                if (map->facility[v] == INVALID_NODE) continue;
+                out << g.osmIds[v] << "," << index.facilities()[map->facility[v]].osmId << ","
+                    << map->cost[v] << "\n";
+            }
+            std::cerr << "Nearest " << argv[2] << " for " << g.nodeCount() << " nodes in " << secs << " s\n";
+            return 0;
+        }
+        if (mode == "--route-by" && argc >= 5) {
+            Profile profile;
+            if (!parseProfile(argv[2], profile)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            PathResult path = aStarWithNodes(std::stoll(argv[3]), std::stoll(argv[4]), RouteMetric::TravelTime, profile);
+            if (!path.found) return 1;
+            std::printf("%s: %.2f km, %.1f min\n", profileName(profile), path.distance / 1000.0,
+                        path.duration / 60.0);
+            return 0;
+        }
+        if (mode == "--route-anytime" && argc >= 4) {
+            const RoadGraph& g = getRoadGraph();
+            uint32_t from = g.toDense(std::stoll(argv[2]));
+            uint32_t to = g.toDense(std::stoll(argv[3]));
+            if (from == INVALID_NODE || to == INVALID_NODE) {
+                std::cerr << "Unknown node\n";
+                return 1;
+            }
+            auto deadline = std::chrono::milliseconds(argc >= 5 ? std::stoll(argv[4]) : 1000);
+            auto start = std::chrono::steady_clock::now();
+            AnytimeRouter router(g);
+            router.start(from, to, RouteMetric::Distance, getLiveCosts().snapshot(), deadline,
+                         [start](const AnytimeSolution& s) {
+                             double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                             std::printf("%8.1f ms  %.3f km  within %.1f%%  (%zu nodes expanded)\n", ms, s.cost / 1000.0,
+                                         (s.bound - 1.0) * 100.0, s.expanded);
+                         });
+            while (router.running()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            size_t count = 0;
+            router.latest(&count);
+            return count > 0 ? 0 : 1;
+        }
+        if (mode == "--build-labels" && argc >= 3) {
+            RouteMetric metric = RouteMetric::Distance;
+            if (argc >= 4 && std::string(argv[3]) == "time") metric = RouteMetric::TravelTime;
+            auto t0 = std::chrono::steady_clock::now();
+            startCustomization();
+            auto live = customizedFor(getLiveCosts().snapshot(), true);
+            if (!live) {
+                std::cerr << "No hierarchy to label\n";
+                return 1;
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            HubLabels labels(getRoadGraph(), *live->hierarchy,
+                             metric == RouteMetric::TravelTime ? live->travelTime : live->distance, metric);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+            if (!labels.save(argv[2])) {
+                std::cerr << "Cannot write " << argv[2] << "\n";
+                return 1;
+            }
+            std::cerr << "Hierarchy in " << std::chrono::duration<double>(t1 - t0).count() << " s, "
+                      << labels.entryCount() << " label entries (" << labels.byteSize() / (1024 * 1024)
+                      << " MiB) in " << secs << " s\n";
+            return 0;
+        }
+        if (mode == "--label-bench" && argc >= 3) {
+            const RoadGraph& g = getRoadGraph();
+            auto labels = HubLabels::open(argv[2], g);
+            if (!labels) return 1;
+            size_t queries = argc >= 4 ? std::stoull(argv[3]) : 1000000;
+            std::vector<uint32_t> pairs(2 * queries);
+            uint32_t state = 12345;
+            for (uint32_t& v : pairs) {
+                state = state * 1664525u + 1013904223u;
+                v = state % static_cast<uint32_t>(g.nodeCount());
+            }
+            double checksum = 0.0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < queries; ++i) {
+                double d = labels->distance(pairs[2 * i], pairs[2 * i + 1]);
+                if (d != std::numeric_limits<double>::infinity()) checksum += d;
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            std::printf("%zu queries in %.3f s: %.0f per second, %.1f ns each (checksum %.0f)\n", queries, secs,
+                        queries / secs, secs * 1e9 / queries, checksum);
+            return 0;
+        }
+        if (mode == "--route-pareto" && argc >= 4) {
+            const RoadGraph& g = getRoadGraph();
+            uint32_t from = g.toDense(std::stoll(argv[2]));
+            uint32_t to = g.toDense(std::stoll(argv[3]));
+            if (from == INVALID_NODE || to == INVALID_NODE) {
+                std::cerr << "Unknown node\n";
+                return 1;
+            }
+            ParetoSearch search(g);
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<ParetoRoute> routes = search.run(from, to, getLiveCosts().snapshot());
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            for (const ParetoRoute& route : routes) {
+                std::printf("%.2f km, %.1f min\n", route.distance / 1000.0, route.duration / 60.0);
+            }
+            std::cerr << routes.size() << " routes in " << ms << " ms (" << search.labelCount() << " labels)\n";
+            return routes.empty() ? 1 : 0;
+        }
+        if (mode == "--route-avoid" && argc >= 5) {
+            RouteRestrictions restrictions;
+            std::stringstream list(argv[4]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (item == "toll") {
+                    restrictions.tolls = true;
+                    continue;
+                }
+                // Unknown tags map to Other; only take that when asked for by name
+                RoadClass rc = roadClassFromTag(item.c_str());
+                if (rc == RoadClass::Other && item != roadClassName(RoadClass::Other)) {
+                    std::cerr << "Unknown road class " << item << "\n";
+                    return 1;
+                }
+                restrictions.roadClasses |= roadClassBit(rc);
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            PathResult path = aStarAvoiding(std::stoll(argv[2]), std::stoll(argv[3]), restrictions);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (!path.found) return 1;
+            std::printf("%.2f km, %.1f min\n", path.distance / 1000.0, path.duration / 60.0);
+            std::cerr << "Routed in " << ms << " ms\n";
+            return 0;
+        }
+        if (mode == "--route-overlay" && argc >= 4) {
+            const RoadGraph& g = getRoadGraph();
+            uint32_t from = g.toDense(std::stoll(argv[2]));
+            uint32_t to = g.toDense(std::stoll(argv[3]));
+            if (from == INVALID_NODE || to == INVALID_NODE) {
+                std::cerr << "Unknown node\n";
+                return 1;
+            }
+            EdgeCostsPtr costs = getLiveCosts().snapshot();
+            auto t0 = std::chrono::steady_clock::now();
+            OverlayGraph overlay(g);
+            auto t1 = std::chrono::steady_clock::now();
+            OverlayMetric metric = overlay.customize(costs->duration);
+            auto t2 = std::chrono::steady_clock::now();
+            OverlayQuery query(overlay);
+            double cost = query.run(metric, from, to);
+            auto t3 = std::chrono::steady_clock::now();
+            for (size_t l = 1; l <= overlay.levelCount(); ++l) {
+                std::fprintf(stderr, "level %zu: %zu cells, %zu boundary nodes\n", l, overlay.cellCount(l),
+                             overlay.boundaryCount(l));
+            }
+            auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+            std::fprintf(stderr, "partition %.0f ms, customization %.0f ms, query %.2f ms (%zu nodes settled)\n",
+                         ms(t0, t1), ms(t1, t2), ms(t2, t3), query.settledCount());
+            if (cost == std::numeric_limits<double>::infinity()) return 1;
+            PathResult path = pathFromEdges(from, query.edgePath(), *costs);
+            std::printf("%.2f km, %.1f min\n", path.distance / 1000.0, path.duration / 60.0);
+            return 0;
+        }
+        if (mode == "--sssp-bench") {
+            // Whole shortest path trees: delta-stepping against serial Dijkstra,
+            // on the extract or on a synthetic grid larger than it
+            RoadGraph grid;
+            int arg = 2;
+            if (argc >= 4 && std::string(argv[2]) == "grid") {
+                grid = syntheticGrid(static_cast<uint32_t>(std::stoul(argv[3])));
+                arg = 4;
+                std::cerr << "Grid: " << grid.nodeCount() << " nodes, " << grid.edgeCount() << " edges\n";
+            }
+            const RoadGraph& g = arg == 4 ? grid : getRoadGraph();
+            size_t count = argc > arg ? std::stoull(argv[arg]) : 20;
+            if (count == 0 || g.nodeCount() == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            unsigned threads = argc > arg + 1 ? static_cast<unsigned>(std::stoul(argv[arg + 1])) : 0;
+            DeltaStepping parallel(g, threads);
+            DistanceTree serial(g);
+            double parallelSecs = 0.0, serialSecs = 0.0;
+            size_t mismatches = 0;
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t source = static_cast<uint32_t>(i * g.nodeCount() / count);
+                auto t0 = std::chrono::steady_clock::now();
+                parallel.run(source);
+                auto t1 = std::chrono::steady_clock::now();
+                serial.run(source, INVALID_NODE);
+                auto t2 = std::chrono::steady_clock::now();
+                parallelSecs += std::chrono::duration<double>(t1 - t0).count();
+                serialSecs += std::chrono::duration<double>(t2 - t1).count();
+                for (uint32_t v = 0; v < g.nodeCount(); ++v) {
+                    if (parallel.distance(v) != serial.distance(v)) mismatches++;
+                }
+            }
+            std::printf("%zu trees: delta-stepping %.2f ms, Dijkstra %.2f ms per tree (delta %.0f m, %zu mismatches)\n",
+                        count, parallelSecs * 1000.0 / count, serialSecs * 1000.0 / count, parallel.delta(),
+                        mismatches);
+            return mismatches ? 1 : 0;
+        }
+        if (mode == "--reach-counts" && argc >= 3) {
+            // Accessibility: how many nodes each source reaches within the time limit
+            const RoadGraph& g = getRoadGraph();
+            const double limit = std::stod(argv[2]) * 60.0;
+            size_t count = argc >= 4 ? std::stoull(argv[3]) : 1000;
+            startCustomization();
+            auto live = customizedFor(getLiveCosts().snapshot(), true);
+            if (!live) {
+                std::cerr << "No hierarchy to sweep\n";
+                return 1;
+            }
+            std::vector<uint32_t> sources(count);
+            for (size_t i = 0; i < count; ++i) sources[i] = static_cast<uint32_t>(i * g.nodeCount() / count);
+            std::vector<size_t> reached(count, 0);
+            auto t0 = std::chrono::steady_clock::now();
+            Phast(*live->hierarchy).run(live->travelTime, sources,
+                                        [&](size_t i, unsigned, const std::vector<double>& cost) {
+                                            for (double c : cost) reached[i] += c <= limit;
+                                        });
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            std::ofstream file;
+            if (argc >= 5) file.open(argv[4]);
+            std::ostream& out = argc >= 5 ? file : std::cout;
+            out << "osm_id,reached\n";
+            for (size_t i = 0; i < count; ++i) out << g.osmIds[sources[i]] << "," << reached[i] << "\n";
+            std::cerr << count << " shortest path trees in " << secs << " s\n";
+            return 0;
+        }
+        printUsage(argv[0]);
+        return 1;
+    }
+
     // Parse map and provide geometry to renderer
     Renderer renderer;
 
@@ -30,6 +399,7 @@ int main(void)
 
     Windower windower(renderer, 800, 640);
     windower.setMapBounds(map.midX, map.midY, map.scale);
+    windower.panel.m_nameIndex.build(std::move(map.places));
     windower.run();
 
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <osmium/handler.hpp>
 #include <osmium/visitor.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/osm/location.hpp>
 #include <unordered_set>
 #include <unordered_map>
 #include <chrono>
@@ -30,11 +31,12 @@ struct Road {
 class MyHandler : public osmium::handler::Handler {
 public:
     std::map<std::pair<std::string, std::string>, Road> mergedRoads;
-    std::unordered_map<osmium::object_id_type, std::pair<double, double>> node_coords;
+    // Stored as osmium::Location: int32 fixed point (1e-7 degrees), half the size of two doubles
+    std::unordered_map<osmium::object_id_type, osmium::Location> node_coords;
 
     void node(const osmium::Node& node) {
         if (node.location().valid()) {
-            node_coords[node.id()] = { node.location().lat(), node.location().lon() };
+            node_coords[node.id()] = node.location();
         }
     }
 
@@ -86,7 +88,7 @@ public:
                         auto it = node_coords.find(nid);
                         if (it != node_coords.end()) {
                             out << "     Node " << nid << " [lat: " << std::fixed << std::setprecision(7)
-                                << it->second.first << ", lon: " << it->second.second << "]\n";
+                                << it->second.lat() << ", lon: " << it->second.lon() << "]\n";
                         } else {
                             out << "     Node " << nid << " [lat/lon: unknown]\n";
                         }
@@ -108,7 +110,7 @@ public:
                             auto it = node_coords.find(nid);
                             if (it != node_coords.end()) {
                                 out << "       " << nid << " [lat: " << std::fixed << std::setprecision(7)
-                                    << it->second.first << ", lon: " << it->second.second << "]\n";
+                                    << it->second.lat() << ", lon: " << it->second.lon() << "]\n";
                             } else {
                                 out << "       " << nid << " [lat/lon: unknown]\n";
                             }
@@ -144,8 +146,8 @@ Map parseMap(const std::string& filepath) {
         double maxLon = std::numeric_limits<double>::lowest();
 
         for (const auto& kv : handler.node_coords) {
-            double lat = kv.second.first;
-            double lon = kv.second.second;
+            double lat = kv.second.lat();
+            double lon = kv.second.lon();
             minLat = std::min(minLat, lat);
             maxLat = std::max(maxLat, lat);
             minLon = std::min(minLon, lon);
@@ -184,8 +186,8 @@ Map parseMap(const std::string& filepath) {
                         auto coordIt = handler.node_coords.find(nid);
                         if (coordIt == handler.node_coords.end()) continue; // skip unknown nodes
 
-                        double lat = coordIt->second.first;
-                        double lon = coordIt->second.second;
+                        double lat = coordIt->second.lat();
+                        double lon = coordIt->second.lon();
 
                         // Project to Web Mercator for better visual layout
                         const double deg2rad = M_PI / 180.0;
@@ -246,6 +248,22 @@ Map parseMap(const std::string& filepath) {
             }
         }
 
+        // One searchable entry per named road: the middle node of its longest segment
+        for (const auto& entry : handler.mergedRoads) {
+            const auto& road = entry.second;
+            if (road.name == "unnamed") continue;
+
+            const std::vector<osmium::object_id_type>* longest = nullptr;
+            for (const auto& seg : road.segments) {
+                if (!longest || seg.size() > longest->size()) longest = &seg;
+            }
+            if (!longest || longest->empty()) continue;
+
+            auto coordIt = handler.node_coords.find((*longest)[longest->size() / 2]);
+            if (coordIt == handler.node_coords.end()) continue;
+            out.places.push_back({road.name, road.type, coordIt->second.lat(), coordIt->second.lon()});
+        }
+
         std::cout << "Parsed map: vertices=" << (out.vertices.size()/3) << " indices=" << out.indices.size() << "\n";
 
         // Normalize mercator coordinates to NDC [-1,1] while preserving aspect ratio
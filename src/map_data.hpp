@@ -15,12 +15,17 @@
 #include <iomanip>
 #include <sstream>
 
+#include "name_index.hpp"
+
 struct Map {
 	std::vector<float> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<size_t> segmentOffsets;
 	std::vector<size_t> segmentLengths;
 
+	// Named streets with a representative point, for the name search
+	std::vector<PlaceEntry> places;
+
 	// Normalization parameters
 	float midX = 0.0f;
 	float midY = 0.0f;
@@ -0,0 +1,248 @@
+#include "map_matching.hpp"
+#include "road_graph.hpp"
+#include "segment_index.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+constexpr uint32_t NO_CANDIDATE = UINT32_MAX;
+
+struct Candidate {
+    SegmentHit hit;
+    bool forward, backward; // segment may be driven u -> v / v -> u
+    double score;           // log probability of the best chain ending here
+    uint32_t back;          // candidate at the previous matched fix, NO_CANDIDATE at a chain start
+};
+
+// Per-node edges are sorted by head; parallel edges of other ways are checked too
+static bool hasEdge(const RoadGraph& g, uint32_t from, uint32_t to, Profile profile) {
+    auto first = g.head.begin() + g.firstOut[from];
+    auto last = g.head.begin() + g.firstOut[from + 1];
+    for (auto it = std::lower_bound(first, last, to); it != last && *it == to; ++it) {
+        if (g.edgeAccess[it - g.head.begin()] & profileBit(profile)) return true;
+    }
+    return false;
+}
+
+// Road distance between two candidates, given a search run from a's exits
+static double routeDistance(const SegmentIndex& index, const DistanceBounded& search,
+                            const Candidate& a, const Candidate& b, double limit) {
+    const RoadSegment& sa = index.segment(a.hit.segment);
+    const RoadSegment& sb = index.segment(b.hit.segment);
+    double best = std::numeric_limits<double>::infinity();
+
+    // Along the same segment without touching a node
+    if (a.hit.segment == b.hit.segment) {
+        double delta = (b.hit.fraction - a.hit.fraction) * sa.length;
+        if ((delta >= 0.0 && a.forward) || (delta <= 0.0 && a.backward)) best = std::abs(delta);
+    }
+
+    // Enter b's segment from either end. Distances past the limit are not final.
+    double du = search.distance(sb.u);
+    if (b.forward && du <= limit) best = std::min(best, du + b.hit.fraction * sb.length);
+    double dv = search.distance(sb.v);
+    if (b.backward && dv <= limit) best = std::min(best, dv + (1.0 - b.hit.fraction) * sb.length);
+    return best;
+}
+
+static DistanceBounded& boundedSearch(const RoadGraph& g) {
+    thread_local DistanceBounded search(g);
+    return search;
+}
+
+std::vector<MatchedPoint> matchTrace(const std::vector<GpsPoint>& trace, const MatchParams& params) {
+    const RoadGraph& g = getRoadGraph();
+    const SegmentIndex& index = getSegmentIndex();
+    DistanceBounded& search = boundedSearch(g);
+    search.useCosts(freeFlowSnapshot(g, params.profile));
+    const double NEG_INF = -std::numeric_limits<double>::infinity();
+
+    std::vector<std::vector<Candidate>> layers(trace.size());
+    std::vector<std::pair<uint32_t, double>> sources;
+    size_t prev = trace.size(); // last fix with candidates
+
+    for (size_t i = 0; i < trace.size(); ++i) {
+        std::vector<SegmentHit> hits = index.within(trace[i].lat, trace[i].lon, params.searchRadius);
+        auto& cur = layers[i];
+        for (const SegmentHit& h : hits) {
+            if (cur.size() == params.maxCandidates) break;
+            const RoadSegment& s = index.segment(h.segment);
+            bool forward = hasEdge(g, s.u, s.v, params.profile);
+            bool backward = hasEdge(g, s.v, s.u, params.profile);
+            if (forward || backward) cur.push_back({h, forward, backward, NEG_INF, NO_CANDIDATE});
+        }
+        if (cur.empty()) continue;
+        auto emission = [&](const Candidate& c) {
+            double z = c.hit.distance / params.sigma;
+            return -0.5 * z * z;
+        };
+
+        bool connected = false;
+        if (prev < trace.size()) {
+            const GpsPoint& p = trace[prev];
+            double straight = haversine(p.lat, p.lon, trace[i].lat, trace[i].lon);
+            double limit = straight * params.maxRouteFactor + 2.0 * params.searchRadius;
+            search.stopPolicy().limit = limit;
+
+            const auto& last = layers[prev];
+            for (uint32_t ai = 0; ai < last.size(); ++ai) {
+                const Candidate& a = last[ai];
+                if (a.score == NEG_INF) continue;
+
+                const RoadSegment& sa = index.segment(a.hit.segment);
+                sources.clear();
+                if (a.forward) sources.push_back({sa.v, (1.0 - a.hit.fraction) * sa.length});
+                if (a.backward) sources.push_back({sa.u, a.hit.fraction * sa.length});
+                search.run(sources, INVALID_NODE);
+
+                for (Candidate& b : cur) {
+                    double route = routeDistance(index, search, a, b, limit);
+                    if (route > limit) continue;
+                    double score = a.score - std::abs(route - straight) / params.beta + emission(b);
+                    if (score > b.score) {
+                        b.score = score;
+                        b.back = ai;
+                        connected = true;
+                    }
+                }
+            }
+        }
+
+        // First fix, or no candidate pair connects: start a new chain here
+        if (!connected) {
+            for (Candidate& b : cur) {
+                b.score = emission(b);
+                b.back = NO_CANDIDATE;
+            }
+        }
+        prev = i;
+    }
+
+    // Backtrack each chain from its best final candidate
+    std::vector<MatchedPoint> result(trace.size());
+    uint32_t follow = NO_CANDIDATE;
+    for (size_t i = trace.size(); i-- > 0;) {
+        const auto& cur = layers[i];
+        if (cur.empty()) continue;
+        if (follow == NO_CANDIDATE) {
+            follow = 0;
+            for (uint32_t k = 1; k < cur.size(); ++k) {
+                if (cur[k].score > cur[follow].score) follow = k;
+            }
+        }
+        const Candidate& c = cur[follow];
+        MatchedPoint& m = result[i];
+        m.matched = true;
+        m.segment = c.hit.segment;
+        m.wayId = g.ways[index.segment(c.hit.segment).way].osmId;
+        m.lat = c.hit.lat;
+        m.lon = c.hit.lon;
+        m.distance = c.hit.distance;
+        follow = c.back;
+    }
+    return result;
+}
+
+struct TraceJob {
+    std::string id;
+    std::vector<GpsPoint> points;
+};
+
+static std::string formatTrace(const TraceJob& job, const std::vector<MatchedPoint>& matched) {
+    std::ostringstream out;
+    out << std::fixed;
+    for (size_t i = 0; i < job.points.size(); ++i) {
+        const GpsPoint& p = job.points[i];
+        const MatchedPoint& m = matched[i];
+        out << job.id << ',' << std::setprecision(3) << p.timestamp << ','
+            << std::setprecision(7) << p.lat << ',' << p.lon << ',';
+        if (m.matched) {
+            out << m.lat << ',' << m.lon << ',' << m.wayId << ','
+                << std::setprecision(1) << m.distance << '\n';
+        } else {
+            out << ",,,\n";
+        }
+    }
+    return out.str();
+}
+
+size_t matchTraceStream(std::istream& in, std::ostream& out, unsigned threads, const MatchParams& params) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    getSegmentIndex(); // build once before the workers need it
+
+    std::deque<TraceJob> queue;
+    std::mutex queueMutex, outMutex;
+    std::condition_variable notEmpty, notFull;
+    bool done = false;
+    const size_t maxQueued = size_t(threads) * 4;
+
+    out << "trace_id,timestamp,lat,lon,matched_lat,matched_lon,way_id,distance_m\n";
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (;;) {
+                TraceJob job;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    notEmpty.wait(lock, [&] { return !queue.empty() || done; });
+                    if (queue.empty()) return;
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                }
+                notFull.notify_one();
+
+                std::string text = formatTrace(job, matchTrace(job.points, params));
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << text;
+            }
+        });
+    }
+
+    auto submit = [&](TraceJob&& job) {
+        if (job.points.empty()) return;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            notFull.wait(lock, [&] { return queue.size() < maxQueued; });
+            queue.push_back(std::move(job));
+        }
+        notEmpty.notify_one();
+    };
+
+    size_t count = 0;
+    TraceJob current;
+    std::string line, id;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        GpsPoint p;
+        if (!std::getline(ss, id, ',')) continue;
+        if (!(ss >> p.timestamp) || ss.get() != ',' ||
+            !(ss >> p.lat) || ss.get() != ',' || !(ss >> p.lon)) continue; // header or malformed
+
+        if (id != current.id) {
+            submit(std::move(current));
+            current = TraceJob{id, {}};
+        }
+        current.points.push_back(p);
+        count++;
+    }
+    submit(std::move(current));
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        done = true;
+    }
+    notEmpty.notify_all();
+    for (auto& w : workers) w.join();
+    return count;
+}
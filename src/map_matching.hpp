@@ -0,0 +1,52 @@
+#ifndef MAP_MATCHING
+#define MAP_MATCHING
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+
+#include "road_graph.hpp"
+
+struct GpsPoint {
+    double timestamp = 0.0;
+    double lat = 0.0, lon = 0.0;
+};
+
+struct MatchParams {
+    double searchRadius = 50.0;  // meters around a fix to look for candidate roads
+    size_t maxCandidates = 8;    // closest candidates kept per fix
+    double sigma = 10.0;         // GPS noise, meters (emission)
+    double beta = 5.0;           // tolerated route vs straight-line difference, meters (transition)
+    double maxRouteFactor = 2.0; // routes longer than this times the straight line are not tried
+    Profile profile = Profile::Car; // only roads this profile may use are candidates
+};
+
+// Where one fix was placed on the road network
+struct MatchedPoint {
+    bool matched = false;
+    uint32_t segment = UINT32_MAX; // SegmentIndex segment id
+    int64_t wayId = 0;
+    double lat = 0.0, lon = 0.0;   // projected position
+    double distance = 0.0;         // meters from the fix
+};
+
+// Hidden Markov model map matching (Newson & Krumm).
+// Candidates are the road segments near each fix; emission favours close
+// candidates, transition favours pairs whose road distance matches the
+// straight-line distance between the fixes. Road distances come from one
+// Dijkstra per candidate bounded to a few times that straight line, and
+// Viterbi picks the most likely sequence. A fix with no road nearby stays
+// unmatched; where no candidate pair is connected the chain restarts.
+std::vector<MatchedPoint> matchTrace(const std::vector<GpsPoint>& trace, const MatchParams& params = {});
+
+// Batch mode: read "trace_id,timestamp,lat,lon" lines (rows of one trace
+// consecutive), match traces on a pool of threads and write one CSV row per fix
+// (trace_id,timestamp,lat,lon,matched_lat,matched_lon,way_id,distance_m).
+// Rows of a trace stay together, traces come out in completion order.
+// threads == 0 uses every core. Returns fixes processed.
+size_t matchTraceStream(std::istream& in, std::ostream& out, unsigned threads = 0,
+                        const MatchParams& params = {});
+
+#endif
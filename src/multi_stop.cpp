@@ -0,0 +1,188 @@
+#include "multi_stop.hpp"
+#include "road_graph.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+
+// Stops that cannot reach each other still need a finite cost to compare tours
+constexpr double UNREACHABLE_COST = 1e12;
+constexpr double MIN_GAIN = 1e-6;
+constexpr int PERTURBATIONS = 200;
+
+static double stopCost(const CostMatrix& m, size_t a, size_t b) {
+    double c = m.at(a, b);
+    return c < UNREACHABLE_COST ? c : UNREACHABLE_COST;
+}
+
+static double pathCost(const CostMatrix& m, const std::vector<size_t>& tour) {
+    double total = 0.0;
+    for (size_t k = 0; k + 1 < tour.size(); ++k) total += stopCost(m, tour[k], tour[k + 1]);
+    return total;
+}
+
+// 2-opt and Or-opt until no move improves; positions 1..hi may move
+static void improveTour(const CostMatrix& m, std::vector<size_t>& tour, size_t hi) {
+    const size_t n = tour.size();
+    auto cost = [&](size_t a, size_t b) { return stopCost(m, a, b); };
+    auto link = [&](size_t pos) { // cost from tour[pos] to tour[pos + 1]; the path may just end
+        return pos + 1 < n ? cost(tour[pos], tour[pos + 1]) : 0.0;
+    };
+
+    for (bool improved = true; improved;) {
+        improved = false;
+
+        // 2-opt: reverse tour[i..j]; with asymmetric costs the inner legs change too
+        for (size_t i = 1; i < hi; ++i) {
+            double forward = 0.0, backward = 0.0;
+            for (size_t j = i + 1; j <= hi; ++j) {
+                forward += cost(tour[j - 1], tour[j]);
+                backward += cost(tour[j], tour[j - 1]);
+                double after = j + 1 < n ? cost(tour[i], tour[j + 1]) : 0.0;
+                double delta = cost(tour[i - 1], tour[j]) + backward + after
+                             - link(i - 1) - forward - link(j);
+                if (delta < -MIN_GAIN) {
+                    std::reverse(tour.begin() + i, tour.begin() + j + 1);
+                    std::swap(forward, backward);
+                    improved = true;
+                }
+            }
+        }
+
+        // Or-opt: move a run of up to three stops elsewhere, same direction
+        for (size_t len = 1; len <= 3; ++len) {
+            for (size_t i = 1; i + len - 1 <= hi; ++i) {
+                size_t last = i + len - 1;
+                double next = last + 1 < n ? cost(tour[i - 1], tour[last + 1]) : 0.0;
+                double removeGain = link(i - 1) + link(last) - next;
+
+                for (size_t p = 0; p <= hi; ++p) {
+                    if (p + 1 >= i && p <= last) continue; // inside or next to the run
+                    double insertCost = cost(tour[p], tour[i])
+                                      + (p + 1 < n ? cost(tour[last], tour[p + 1]) : 0.0) - link(p);
+                    if (insertCost - removeGain < -MIN_GAIN) {
+                        std::vector<size_t> run(tour.begin() + i, tour.begin() + last + 1);
+                        tour.erase(tour.begin() + i, tour.begin() + last + 1);
+                        size_t at = p < i ? p + 1 : p + 1 - len;
+                        tour.insert(tour.begin() + at, run.begin(), run.end());
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<size_t> solveStopOrder(const CostMatrix& m, bool keepEnd) {
+    const size_t n = m.size;
+    std::vector<size_t> tour;
+    if (n == 0) return tour;
+    if (n == 1) keepEnd = false;
+
+    // Nearest neighbour construction
+    std::vector<bool> used(n, false);
+    tour.push_back(0);
+    used[0] = true;
+    if (keepEnd) used[n - 1] = true;
+    while (tour.size() < n - (keepEnd ? 1 : 0)) {
+        size_t from = tour.back(), best = n;
+        for (size_t k = 0; k < n; ++k) {
+            if (!used[k] && (best == n || stopCost(m, from, k) < stopCost(m, from, best))) best = k;
+        }
+        used[best] = true;
+        tour.push_back(best);
+    }
+    if (keepEnd) tour.push_back(n - 1);
+
+    // Positions 1..hi may move
+    const size_t hi = keepEnd ? n - 2 : n - 1;
+    if (n <= 2 || hi < 2) return tour;
+    improveTour(m, tour, hi);
+
+    // Iterated local search: a double-bridge kick moves the tour out of the
+    // local optimum, and the result is kept if local search makes it better
+    if (hi < 4) return tour;
+    std::vector<size_t> best = tour;
+    double bestCost = pathCost(m, best);
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    auto random = [&](size_t bound) { // xorshift, deterministic for a given matrix
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return static_cast<size_t>(seed % bound);
+    };
+
+    for (int round = 0; round < PERTURBATIONS; ++round) {
+        tour = best;
+        size_t cut[3];
+        for (size_t& c : cut) c = 2 + random(hi - 1); // in 2..hi
+        std::sort(cut, cut + 3);
+        if (cut[0] == cut[1] || cut[1] == cut[2]) continue;
+        // 1..a-1 | a..b-1 | b..c-1 | c..  ->  1..a-1 | b..c-1 | a..b-1 | c..
+        std::rotate(tour.begin() + cut[0], tour.begin() + cut[1], tour.begin() + cut[2]);
+        improveTour(m, tour, hi);
+
+        double c = pathCost(m, tour);
+        if (c < bestCost - MIN_GAIN) {
+            best = tour;
+            bestCost = c;
+        }
+    }
+    return best;
+}
+
+// Append a leg to the joined path; the leg starts where the path ends
+static void appendLeg(PathResult& path, PathResult&& leg) {
+    if (path.nodeIds.empty()) {
+        path = std::move(leg);
+        return;
+    }
+    path.nodeIds.insert(path.nodeIds.end(), leg.nodeIds.begin() + 1, leg.nodeIds.end());
+    path.segments.insert(path.segments.end(), std::make_move_iterator(leg.segments.begin()),
+                         std::make_move_iterator(leg.segments.end()));
+    path.distance += leg.distance;
+    path.duration += leg.duration;
+    path.straightPathDist += leg.straightPathDist;
+}
+
+MultiStopResult routeThroughStops(const std::vector<int64_t>& stops, RouteMetric metric, StopOrder order,
+                                  Profile profile, const EdgeMaskPtr& mask) {
+    MultiStopResult result;
+    result.path.found = false;
+    result.path.distance = result.path.duration = result.path.straightPathDist = 0.0f;
+    if (stops.size() < 2) return result;
+
+    result.order.resize(stops.size());
+    std::iota(result.order.begin(), result.order.end(), 0);
+
+    if (order != StopOrder::AsGiven && stops.size() > 2) {
+        const RoadGraph& g = getRoadGraph();
+        std::vector<uint32_t> nodes;
+        nodes.reserve(stops.size());
+        for (int64_t id : stops) {
+            uint32_t v = g.toDense(id);
+            if (v == INVALID_NODE) {
+                std::cerr << "Invalid stop node " << id << ".\n";
+                return result;
+            }
+            nodes.push_back(v);
+        }
+        EdgeCostsPtr costs = getLiveCosts().snapshot(profile);
+        if (mask) costs = maskCosts(*costs, *mask);
+        CostMatrix m = computeCostMatrix(g, nodes, metric, 0, costs);
+        result.order = solveStopOrder(m, order == StopOrder::OptimizeKeepEnd);
+    }
+
+    for (size_t k = 0; k + 1 < result.order.size(); ++k) {
+        PathResult leg = aStarAvoiding(stops[result.order[k]], stops[result.order[k + 1]], mask, metric, profile);
+        if (!leg.found) {
+            result.path.found = false;
+            return result;
+        }
+        appendLeg(result.path, std::move(leg));
+        result.legEnds.push_back(result.path.nodeIds.size() - 1);
+    }
+    result.path.found = true;
+    return result;
+}
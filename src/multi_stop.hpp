@@ -0,0 +1,38 @@
+#ifndef MULTI_STOP
+#define MULTI_STOP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "a_star.hpp"
+#include "cost_matrix.hpp"
+
+enum class StopOrder {
+    AsGiven,          // visit the stops in the order given
+    Optimize,         // keep the first stop, reorder the rest
+    OptimizeKeepEnd   // keep the first and last stops, reorder those in between
+};
+
+struct MultiStopResult {
+    PathResult path;              // all legs joined; path.found is false if any leg fails
+    std::vector<size_t> order;    // indices into the input stops, in visiting order
+    std::vector<size_t> legEnds;  // index into path.nodeIds where each leg ends
+};
+
+// Route through stops (OSM node ids). The optimising modes compute the cost
+// matrix between all stops in one batched pass, order the stops with
+// solveStopOrder, then route each leg with A*. Edges in mask are avoided
+// throughout.
+MultiStopResult routeThroughStops(const std::vector<int64_t>& stops,
+                                  RouteMetric metric = RouteMetric::Distance,
+                                  StopOrder order = StopOrder::AsGiven,
+                                  Profile profile = Profile::Car,
+                                  const EdgeMaskPtr& mask = nullptr);
+
+// Heuristic open-path TSP over an asymmetric cost matrix: nearest neighbour
+// from index 0, then 2-opt and Or-opt moves until no move improves the cost.
+// Index 0 stays first, and the last index stays last if keepEnd.
+std::vector<size_t> solveStopOrder(const CostMatrix& m, bool keepEnd);
+
+#endif
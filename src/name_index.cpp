@@ -0,0 +1,124 @@
+#include "name_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+std::string NameIndex::normalize(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (unsigned char c : s) {
+        if (c >= 0x80 || std::isalnum(c)) {
+            out.push_back(static_cast<char>(c >= 0x80 ? c : std::tolower(c)));
+        } else if (!out.empty() && out.back() != ' ') {
+            out.push_back(' ');
+        }
+    }
+    while (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+void NameIndex::build(std::vector<PlaceEntry> entries) {
+    m_entries = std::move(entries);
+    m_keys.clear();
+
+    for (uint32_t id = 0; id < m_entries.size(); ++id) {
+        std::string norm = normalize(m_entries[id].name);
+        for (size_t pos = 0; pos < norm.size(); ++pos) {
+            if (pos == 0 || norm[pos - 1] == ' ') {
+                m_keys.push_back({norm.substr(pos), id, pos != 0});
+            }
+        }
+    }
+    std::sort(m_keys.begin(), m_keys.end());
+}
+
+// Smallest optimal-string-alignment distance between q and any prefix of key,
+// or maxDist + 1 once it is certain to exceed maxDist. Only the diagonal band
+// |i - j| <= maxDist is evaluated; rows is caller-owned scratch space.
+static int prefixEditDistance(const std::string& q, const std::string& key, int maxDist,
+                              std::vector<int> (&rows)[3]) {
+    const int INF = maxDist + 1;
+    const int n = static_cast<int>(q.size());
+    const int m = std::min(static_cast<int>(key.size()), n + maxDist);
+    for (auto& r : rows) r.assign(n + 1, INF);
+    std::vector<int>* prev2 = &rows[0];
+    std::vector<int>* prev = &rows[1];
+    std::vector<int>* cur = &rows[2];
+    for (int i = 0; i <= std::min(n, maxDist); ++i) (*prev)[i] = i;
+
+    int best = (*prev)[n];
+    for (int j = 1; j <= m; ++j) {
+        const int lo = std::max(1, j - maxDist);
+        const int hi = std::min(n, j + maxDist);
+        std::fill(cur->begin(), cur->end(), INF);
+        (*cur)[0] = j <= maxDist ? j : INF;
+        int rowMin = (*cur)[0];
+        for (int i = lo; i <= hi; ++i) {
+            int cost = q[i - 1] == key[j - 1] ? 0 : 1;
+            int v = std::min({(*prev)[i] + 1, (*cur)[i - 1] + 1, (*prev)[i - 1] + cost});
+            if (i > 1 && j > 1 && q[i - 1] == key[j - 2] && q[i - 2] == key[j - 1]) {
+                v = std::min(v, (*prev2)[i - 2] + 1); // transposition
+            }
+            (*cur)[i] = std::min(v, INF);
+            rowMin = std::min(rowMin, (*cur)[i]);
+        }
+        best = std::min(best, (*cur)[n]);
+        if (rowMin > maxDist) break;
+        std::swap(prev2, prev);
+        std::swap(prev, cur);
+    }
+    return std::min(best, INF);
+}
+
+std::vector<uint32_t> NameIndex::search(const std::string& query, size_t limit) const {
+    std::vector<uint32_t> out;
+    std::string q = normalize(query);
+    if (q.empty() || limit == 0) return out;
+
+    std::unordered_set<uint32_t> seen;
+
+    // Exact prefix matches: whole-name matches rank before later-word matches,
+    // shorter names first within each group
+    auto lo = std::lower_bound(m_keys.begin(), m_keys.end(), Key{q, 0, false});
+    std::vector<const Key*> hits;
+    for (auto it = lo; it != m_keys.end() && it->text.compare(0, q.size(), q) == 0; ++it) {
+        hits.push_back(&*it);
+    }
+    // Only the best few are needed; short prefixes can match thousands of keys
+    auto rank = [](const Key* a, const Key* b) {
+        if (a->midName != b->midName) return !a->midName;
+        return a->text.size() < b->text.size();
+    };
+    size_t keep = std::min(hits.size(), limit * 4);
+    std::partial_sort(hits.begin(), hits.begin() + keep, hits.end(), rank);
+    hits.resize(keep);
+    for (const Key* k : hits) {
+        if (out.size() >= limit) return out;
+        if (seen.insert(k->entry).second) out.push_back(k->entry);
+    }
+
+    // Typo tolerance: one edit for short queries, two from six characters on.
+    // Only keys with the query's first letter are scanned.
+    if (q.size() < 3) return out;
+    const int maxDist = q.size() >= 6 ? 2 : 1;
+
+    auto first = std::lower_bound(m_keys.begin(), m_keys.end(), Key{q.substr(0, 1), 0, false});
+    std::vector<std::pair<int, const Key*>> fuzzy;
+    std::vector<int> rows[3];
+    for (auto it = first; it != m_keys.end() && it->text[0] == q[0]; ++it) {
+        if (seen.count(it->entry)) continue;
+        int d = prefixEditDistance(q, it->text, maxDist, rows);
+        if (d <= maxDist) fuzzy.push_back({d, &*it});
+    }
+    std::sort(fuzzy.begin(), fuzzy.end(), [](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (a.second->midName != b.second->midName) return !a.second->midName;
+        return a.second->text.size() < b.second->text.size();
+    });
+    for (const auto& f : fuzzy) {
+        if (out.size() >= limit) break;
+        if (seen.insert(f.second->entry).second) out.push_back(f.second->entry);
+    }
+    return out;
+}
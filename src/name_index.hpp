@@ -0,0 +1,47 @@
+#ifndef NAME_INDEX
+#define NAME_INDEX
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// A named street (one per name and highway type) with a representative point
+struct PlaceEntry {
+    std::string name;
+    std::string type;
+    double lat, lon;
+};
+
+// Street name lookup for autocomplete.
+// Every word start of every normalised name is a key in one sorted string
+// table, so prefix queries (also on later words, "faisal" finds
+// "Shahrah-e-Faisal") are a binary search plus a short scan. When too few
+// names match exactly, keys sharing the query's first letter are scanned
+// with a bounded edit distance to tolerate typos.
+class NameIndex {
+public:
+    void build(std::vector<PlaceEntry> entries);
+
+    // Entry ids matching query, best first, at most limit of them
+    std::vector<uint32_t> search(const std::string& query, size_t limit) const;
+
+    const PlaceEntry& entry(uint32_t id) const { return m_entries[id]; }
+    size_t size() const { return m_entries.size(); }
+
+    // Lower case, punctuation to single spaces; non-ASCII bytes are kept as is
+    static std::string normalize(const std::string& s);
+
+private:
+    struct Key {
+        std::string text;   // normalised name from a word start on
+        uint32_t entry;
+        bool midName;       // key starts at a later word of the name
+        bool operator<(const Key& o) const { return text < o.text; }
+    };
+
+    std::vector<PlaceEntry> m_entries;
+    std::vector<Key> m_keys;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "overlay_graph.hpp"
+#include "partition.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+static void prepare(OverlayScratch& s, size_t n) {
+    if (s.dist.size() == n) return;
+    s.dist.assign(n, INF);
+    s.parent.assign(n, INVALID_NODE);
+    s.parentEdge.assign(n, INVALID_EDGE);
+}
+
+static void clear(OverlayScratch& s) {
+    for (uint32_t v : s.touched) s.dist[v] = INF;
+    s.touched.clear();
+    s.heap.clear();
+}
+
+// Dijkstra from source until target is settled (or everything reachable
+// through arcs(u, relax) is); returns the number of nodes settled
+template <typename Arcs>
+static size_t dijkstra(OverlayScratch& s, uint32_t source, uint32_t target, Arcs arcs) {
+    const auto greater = std::greater<std::pair<double, uint32_t>>();
+    s.dist[source] = 0.0;
+    s.parent[source] = INVALID_NODE;
+    s.parentEdge[source] = INVALID_EDGE;
+    s.touched.push_back(source);
+    s.heap.assign(1, {0.0, source});
+    size_t settled = 0;
+    while (!s.heap.empty()) {
+        std::pop_heap(s.heap.begin(), s.heap.end(), greater);
+        const auto [d, u] = s.heap.back();
+        s.heap.pop_back();
+        if (d > s.dist[u]) continue; // stale
+        settled++;
+        if (u == target) break;
+        arcs(u, [&](uint32_t v, double c, uint32_t e) {
+            const double nd = d + c;
+            if (!(nd < s.dist[v])) return; // also skips closed arcs
+            if (s.dist[v] == INF) s.touched.push_back(v);
+            s.dist[v] = nd;
+            s.parent[v] = u;
+            s.parentEdge[v] = e;
+            s.heap.push_back({nd, v});
+            std::push_heap(s.heap.begin(), s.heap.end(), greater);
+        });
+    }
+    return settled;
+}
+
+OverlayGraph::OverlayGraph(const RoadGraph& g, const std::vector<size_t>& cellSizes)
+    : m_graph(g), m_levels(cellSizes.size())
+{
+    const size_t n = g.nodeCount();
+    const int levels = static_cast<int>(cellSizes.size());
+    for (Level& level : m_levels) level.cell.assign(n, 0);
+    std::vector<uint32_t> cellCount(levels, 0);
+
+    // Bisect top down; a piece becomes a cell on every level it first fits,
+    // so the cells of a level nest inside those of the level above
+    Topology topology = undirectedTopology(g);
+    InertialFlow flow(g, topology);
+    struct Piece {
+        std::vector<uint32_t> nodes;
+        int level; // highest level not yet assigned a cell
+    };
+    std::vector<Piece> pieces(1);
+    pieces[0].nodes.resize(n);
+    for (uint32_t v = 0; v < n; ++v) pieces[0].nodes[v] = v;
+    pieces[0].level = levels;
+    while (!pieces.empty()) {
+        Piece piece = std::move(pieces.back());
+        pieces.pop_back();
+        for (; piece.level >= 1 && piece.nodes.size() <= cellSizes[piece.level - 1]; --piece.level) {
+            const uint32_t id = cellCount[piece.level - 1]++;
+            for (uint32_t v : piece.nodes) m_levels[piece.level - 1].cell[v] = id;
+        }
+        if (piece.level == 0) continue;
+        size_t mid = flow.bisect(piece.nodes);
+        if (mid == 0 || mid == piece.nodes.size()) mid = piece.nodes.size() / 2;
+        pieces.push_back({{piece.nodes.begin() + mid, piece.nodes.end()}, piece.level});
+        pieces.push_back({{piece.nodes.begin(), piece.nodes.begin() + mid}, piece.level});
+    }
+
+    for (int l = 1; l <= levels; ++l) {
+        Level& level = m_levels[l - 1];
+        const size_t cells = cellCount[l - 1];
+
+        // Endpoints of edges between cells, both ways
+        std::vector<uint8_t> isBoundary(n, 0);
+        for (uint32_t u = 0; u < n; ++u) {
+            for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+                const uint32_t v = g.head[e];
+                if (level.cell[u] != level.cell[v]) isBoundary[u] = isBoundary[v] = 1;
+            }
+        }
+
+        level.firstBoundary.assign(cells + 1, 0);
+        for (uint32_t v = 0; v < n; ++v) {
+            if (isBoundary[v]) level.firstBoundary[level.cell[v] + 1]++;
+        }
+        for (size_t c = 0; c < cells; ++c) level.firstBoundary[c + 1] += level.firstBoundary[c];
+        level.boundary.resize(level.firstBoundary[cells]);
+        level.boundaryIndex.assign(n, INVALID_NODE);
+        std::vector<uint32_t> fill(level.firstBoundary.begin(), level.firstBoundary.end() - 1);
+        for (uint32_t v = 0; v < n; ++v) {
+            if (!isBoundary[v]) continue;
+            const uint32_t c = level.cell[v];
+            level.boundaryIndex[v] = fill[c] - level.firstBoundary[c];
+            level.boundary[fill[c]++] = v;
+        }
+
+        level.firstClique.assign(cells + 1, 0);
+        for (size_t c = 0; c < cells; ++c) {
+            const size_t b = level.firstBoundary[c + 1] - level.firstBoundary[c];
+            level.firstClique[c + 1] = level.firstClique[c] + b * b;
+        }
+    }
+}
+
+template <typename F>
+void OverlayGraph::forArcs(const OverlayMetric& metric, int level, uint32_t v, F f) const {
+    if (level == 0) {
+        for (uint32_t e = m_graph.firstOut[v]; e < m_graph.firstOut[v + 1]; ++e) f(m_graph.head[e], metric.edge[e], e);
+        return;
+    }
+    const Level& lv = m_levels[level - 1];
+    const uint32_t c = lv.cell[v];
+    const uint32_t first = lv.firstBoundary[c];
+    const size_t count = lv.firstBoundary[c + 1] - first;
+    const double* row = metric.clique[level - 1].data() + lv.firstClique[c] + lv.boundaryIndex[v] * count;
+    for (size_t j = 0; j < count; ++j) f(lv.boundary[first + j], row[j], INVALID_EDGE);
+    for (uint32_t e = m_graph.firstOut[v]; e < m_graph.firstOut[v + 1]; ++e) {
+        if (lv.cell[m_graph.head[e]] != c) f(m_graph.head[e], metric.edge[e], e);
+    }
+}
+
+void OverlayGraph::cellSearch(const OverlayMetric& metric, int level, uint32_t source, uint32_t target,
+                              OverlayScratch& s) const {
+    const std::vector<uint32_t>& cellOf = m_levels[level - 1].cell;
+    const uint32_t c = cellOf[source];
+    dijkstra(s, source, target, [&](uint32_t u, auto relax) {
+        forArcs(metric, level - 1, u, [&](uint32_t v, double cost, uint32_t e) {
+            if (cellOf[v] == c) relax(v, cost, e);
+        });
+    });
+}
+
+void OverlayGraph::unpack(const OverlayMetric& metric, int level, uint32_t from, uint32_t to, OverlayScratch& s,
+                          std::vector<uint32_t>& edges) const {
+    cellSearch(metric, level, from, to, s);
+    struct Hop {
+        uint32_t from, to, edge;
+    };
+    std::vector<Hop> hops;
+    if (s.dist[to] != INF) {
+        for (uint32_t v = to; v != from; v = s.parent[v]) hops.push_back({s.parent[v], v, s.parentEdge[v]});
+    }
+    clear(s);
+    for (size_t i = hops.size(); i-- > 0;) {
+        if (hops[i].edge != INVALID_EDGE) {
+            edges.push_back(hops[i].edge);
+        } else {
+            unpack(metric, level - 1, hops[i].from, hops[i].to, s, edges);
+        }
+    }
+}
+
+template <typename Cost>
+OverlayMetric OverlayGraph::customize(const std::vector<Cost>& cost, unsigned threads) const {
+    OverlayMetric m;
+    m.edge.assign(cost.begin(), cost.end());
+    m.clique.resize(m_levels.size());
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<OverlayScratch> scratch(threads);
+
+    // Bottom up: a level's cells search over the cliques of the level below
+    for (int l = 1; l <= static_cast<int>(m_levels.size()); ++l) {
+        const Level& level = m_levels[l - 1];
+        std::vector<double>& clique = m.clique[l - 1];
+        clique.assign(level.firstClique.back(), INF);
+        parallelFor(level.firstBoundary.size() - 1, threads, [&](size_t c, unsigned worker) {
+            OverlayScratch& s = scratch[worker];
+            prepare(s, m_graph.nodeCount());
+            const uint32_t first = level.firstBoundary[c];
+            const size_t count = level.firstBoundary[c + 1] - first;
+            for (size_t i = 0; i < count; ++i) {
+                cellSearch(m, l, level.boundary[first + i], INVALID_NODE, s);
+                double* row = clique.data() + level.firstClique[c] + i * count;
+                for (size_t j = 0; j < count; ++j) row[j] = s.dist[level.boundary[first + j]];
+                clear(s);
+            }
+        }, 1);
+    }
+    return m;
+}
+
+template OverlayMetric OverlayGraph::customize<double>(const std::vector<double>&, unsigned) const;
+template OverlayMetric OverlayGraph::customize<float>(const std::vector<float>&, unsigned) const;
+
+OverlayQuery::OverlayQuery(const OverlayGraph& overlay)
+    : m_overlay(overlay)
+{
+    prepare(m_search, overlay.m_graph.nodeCount());
+    prepare(m_unpack, overlay.m_graph.nodeCount());
+}
+
+int OverlayQuery::queryLevel(uint32_t v) const {
+    // Cells nest, so once v shares a cell with neither endpoint it does on every level below
+    for (int l = static_cast<int>(m_overlay.m_levels.size()); l >= 1; --l) {
+        const std::vector<uint32_t>& cellOf = m_overlay.m_levels[l - 1].cell;
+        if (cellOf[v] != cellOf[m_source] && cellOf[v] != cellOf[m_target]) return l;
+    }
+    return 0;
+}
+
+double OverlayQuery::run(const OverlayMetric& metric, uint32_t source, uint32_t target) {
+    clear(m_search);
+    m_metric = &metric;
+    m_settled = 0;
+    const size_t n = m_overlay.m_graph.nodeCount();
+    if (source >= n || target >= n) {
+        m_source = m_target = INVALID_NODE;
+        return INF;
+    }
+    m_source = source;
+    m_target = target;
+    m_settled = dijkstra(m_search, source, target, [&](uint32_t u, auto relax) {
+        m_overlay.forArcs(metric, queryLevel(u), u, relax);
+    });
+    return m_search.dist[target];
+}
+
+std::vector<uint32_t> OverlayQuery::edgePath() {
+    std::vector<uint32_t> edges;
+    if (m_target == INVALID_NODE || m_search.dist[m_target] == INF) return edges;
+    std::vector<uint32_t> nodes; // target back to source
+    for (uint32_t v = m_target; v != m_source; v = m_search.parent[v]) nodes.push_back(v);
+    uint32_t from = m_source;
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const uint32_t to = nodes[i];
+        const uint32_t e = m_search.parentEdge[to];
+        if (e != INVALID_EDGE) {
+            edges.push_back(e);
+        } else {
+            m_overlay.unpack(*m_metric, queryLevel(from), from, to, m_unpack, edges);
+        }
+        from = to;
+    }
+    return edges;
+}
@@ -0,0 +1,104 @@
+#ifndef OVERLAY_GRAPH
+#define OVERLAY_GRAPH
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+
+// Costs of one metric on an OverlayGraph: the graph's own edges and, per
+// level and cell, the cost between every pair of the cell's boundary nodes
+struct OverlayMetric {
+    std::vector<double> edge;                // per graph edge, infinity when closed
+    std::vector<std::vector<double>> clique; // [level - 1][firstClique[cell] + from * boundary + to]
+};
+
+// Dijkstra state over graph nodes, cleared through the touched list so a
+// search costs what it visits rather than the graph size
+struct OverlayScratch {
+    std::vector<double> dist;
+    std::vector<uint32_t> parent;     // previous node on the path
+    std::vector<uint32_t> parentEdge; // graph edge from parent, INVALID_EDGE for a clique arc
+    std::vector<uint32_t> touched;
+    std::vector<std::pair<double, uint32_t>> heap;
+};
+
+// Multi-level partition overlay (CRP, Delling et al.). Recursive inertial
+// flow bisection nests the nodes into cells of at most cellSizes[l - 1]
+// nodes on level l; a node is a boundary node of its cell when an edge
+// joins it to another cell. The partition depends on the network only.
+// customize() then fills each cell's boundary clique from searches inside
+// the cell over the level below - cells are independent, so a level
+// customizes in parallel, and a cost change only touches the cells around it.
+class OverlayGraph {
+public:
+    // cellSizes ascending, one entry per level
+    explicit OverlayGraph(const RoadGraph& g, const std::vector<size_t>& cellSizes = {256, 4096, 65536});
+
+    // Cost per graph edge, infinity for closed edges; threads == 0 uses every core
+    template <typename Cost>
+    OverlayMetric customize(const std::vector<Cost>& cost, unsigned threads = 0) const;
+
+    size_t levelCount() const { return m_levels.size(); }
+    size_t cellCount(int level) const { return m_levels[level - 1].firstBoundary.size() - 1; }
+    size_t boundaryCount(int level) const { return m_levels[level - 1].boundary.size(); }
+    uint32_t cell(int level, uint32_t v) const { return m_levels[level - 1].cell[v]; }
+
+private:
+    friend class OverlayQuery;
+
+    struct Level {
+        std::vector<uint32_t> cell;          // graph node -> cell
+        std::vector<uint32_t> firstBoundary; // boundary nodes of c are boundary[firstBoundary[c], firstBoundary[c + 1])
+        std::vector<uint32_t> boundary;
+        std::vector<uint32_t> boundaryIndex; // graph node -> position among its cell's boundary nodes, INVALID_NODE inside
+        std::vector<size_t> firstClique;     // cell -> start of its matrix in OverlayMetric::clique
+    };
+
+    const RoadGraph& m_graph;
+    std::vector<Level> m_levels; // m_levels[l - 1] is level l; level 0 is the road graph itself
+
+    // Call f(head, cost, edge) for the arcs out of boundary node v on level:
+    // its cell's clique and the edges leaving the cell (all edges on level 0)
+    template <typename F>
+    void forArcs(const OverlayMetric& metric, int level, uint32_t v, F f) const;
+
+    // Search from source inside its cell on level, over level - 1; stops at
+    // target unless that is INVALID_NODE
+    void cellSearch(const OverlayMetric& metric, int level, uint32_t source, uint32_t target,
+                    OverlayScratch& s) const;
+
+    // Append the graph edges of the clique arc from -> to on level
+    void unpack(const OverlayMetric& metric, int level, uint32_t from, uint32_t to, OverlayScratch& s,
+                std::vector<uint32_t>& edges) const;
+};
+
+// Point-to-point query: Dijkstra that, away from the source's and target's
+// cells, only moves along the cliques and cut edges of the highest level
+// separating it from both. One instance per thread; it holds per-node scratch.
+class OverlayQuery {
+public:
+    explicit OverlayQuery(const OverlayGraph& overlay);
+
+    // Cost from source to target (graph node ids), infinity if unreachable
+    double run(const OverlayMetric& metric, uint32_t source, uint32_t target);
+
+    // Graph edges of the last path found, source to target
+    std::vector<uint32_t> edgePath();
+
+    // Nodes settled by the last query
+    size_t settledCount() const { return m_settled; }
+
+private:
+    const OverlayGraph& m_overlay;
+    const OverlayMetric* m_metric = nullptr;
+    OverlayScratch m_search, m_unpack;
+    uint32_t m_source = INVALID_NODE, m_target = INVALID_NODE;
+    size_t m_settled = 0;
+
+    int queryLevel(uint32_t v) const;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef PARALLEL
+#define PARALLEL
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Run f(index, worker) for every index on up to `threads` threads, handing
+// out chunks of `chunk` indices; the calling thread is worker 0
+template <typename F>
+void parallelFor(size_t count, unsigned threads, F f, size_t chunk = 64) {
+    std::atomic<size_t> next{0};
+    auto work = [&](unsigned worker) {
+        for (size_t begin = next.fetch_add(chunk); begin < count; begin = next.fetch_add(chunk)) {
+            size_t end = std::min(count, begin + chunk);
+            for (size_t i = begin; i < end; ++i) f(i, worker);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(work, t);
+    work(0);
+    for (auto& w : workers) w.join();
+}
+
+#endif
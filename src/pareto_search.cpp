@@ -0,0 +1,118 @@
+#include "pareto_search.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+ParetoSearch::ParetoSearch(const RoadGraph& g)
+    : m_graph(g),
+      m_reverse(reverseAdjacency(g)),
+      m_bestDuration(g.nodeCount(), INF),
+      m_toTargetDistance(g.nodeCount(), INF),
+      m_toTargetDuration(g.nodeCount(), INF)
+{
+}
+
+template <typename Cost>
+void ParetoSearch::backward(uint32_t target, const Cost* cost, std::vector<double>& dist) const {
+    std::fill(dist.begin(), dist.end(), INF);
+    using Entry = std::pair<double, uint32_t>;
+    std::vector<Entry> heap;
+    const auto greater = std::greater<Entry>();
+    dist[target] = 0.0;
+    heap.push_back({0.0, target});
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        const auto [d, v] = heap.back();
+        heap.pop_back();
+        if (d > dist[v]) continue;
+        for (uint32_t i = m_reverse.firstIn[v]; i < m_reverse.firstIn[v + 1]; ++i) {
+            const double nd = d + static_cast<double>(cost[m_reverse.edge[i]]);
+            const uint32_t u = m_reverse.tail[i];
+            if (nd < dist[u]) {
+                dist[u] = nd;
+                heap.push_back({nd, u});
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
+    }
+}
+
+std::vector<ParetoRoute> ParetoSearch::run(uint32_t source, uint32_t target, EdgeCostsPtr costs, double epsilon,
+                                           size_t maxRoutes) {
+    m_labels.clear();
+    std::vector<ParetoRoute> routes;
+    const size_t n = m_graph.nodeCount();
+    if (source >= n || target >= n) return routes;
+
+    if (!costs) costs = freeFlowSnapshot(m_graph);
+    const double* weight = costs->weight.data();
+    const float* duration = costs->duration.data();
+    backward(target, weight, m_toTargetDistance);
+    backward(target, duration, m_toTargetDuration);
+    if (m_toTargetDistance[source] == INF || m_toTargetDuration[source] == INF) return routes;
+    std::fill(m_bestDuration.begin(), m_bestDuration.end(), INF);
+
+    // Queue of label indices, lexicographic by (distance, time) estimates
+    struct Entry {
+        double f1, f2;
+        uint32_t label;
+        bool operator>(const Entry& o) const { return f1 > o.f1 || (f1 == o.f1 && f2 > o.f2); }
+    };
+    std::vector<Entry> open;
+    const auto greater = std::greater<Entry>();
+    m_labels.push_back({0.0, 0.0, source, INVALID_EDGE, INVALID_NODE});
+    open.push_back({m_toTargetDistance[source], m_toTargetDuration[source], 0});
+
+    // The target's best time, less the slack epsilon allows
+    double targetCutoff = INF;
+    std::vector<uint32_t> found;
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), greater);
+        const Entry top = open.back();
+        open.pop_back();
+        const Label x = m_labels[top.label];
+        if (x.duration >= m_bestDuration[x.node] || top.f2 >= targetCutoff) continue;
+        m_bestDuration[x.node] = x.duration;
+        if (x.node == target) {
+            found.push_back(top.label);
+            targetCutoff = x.duration / (1.0 + epsilon);
+            continue;
+        }
+
+        for (uint32_t e = m_graph.firstOut[x.node]; e < m_graph.firstOut[x.node + 1]; ++e) {
+            const double w = weight[e], t = duration[e];
+            if (w == INF || t == INF) continue; // closed
+            const uint32_t v = m_graph.head[e];
+            const Label y{x.distance + w, x.duration + t, v, e, top.label};
+            const double f2 = y.duration + m_toTargetDuration[v];
+            if (y.duration >= m_bestDuration[v] || f2 >= targetCutoff) continue;
+            m_labels.push_back(y);
+            open.push_back({y.distance + m_toTargetDistance[v], f2, static_cast<uint32_t>(m_labels.size() - 1)});
+            std::push_heap(open.begin(), open.end(), greater);
+        }
+    }
+
+    // Keep the shortest and the fastest, spread the rest evenly between them
+    std::vector<uint32_t> kept;
+    if (found.size() <= maxRoutes || maxRoutes < 2) {
+        kept = found;
+        if (kept.size() > maxRoutes) kept.resize(maxRoutes);
+    } else {
+        for (size_t i = 0; i < maxRoutes; ++i) kept.push_back(found[i * (found.size() - 1) / (maxRoutes - 1)]);
+    }
+    for (uint32_t l : kept) {
+        ParetoRoute route;
+        route.distance = m_labels[l].distance;
+        route.duration = m_labels[l].duration;
+        for (uint32_t at = l; m_labels[at].parent != INVALID_NODE; at = m_labels[at].parent) {
+            route.edges.push_back(m_labels[at].edge);
+        }
+        std::reverse(route.edges.begin(), route.edges.end());
+        routes.push_back(std::move(route));
+    }
+    return routes;
+}
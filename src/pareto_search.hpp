@@ -0,0 +1,58 @@
+#ifndef PARETO_SEARCH
+#define PARETO_SEARCH
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+
+// One route of the distance / travel time trade-off
+struct ParetoRoute {
+    std::vector<uint32_t> edges;
+    double distance = 0.0; // meters
+    double duration = 0.0; // seconds
+};
+
+// Bi-criteria label-setting search (BOA*, Hernandez et al.) for the routes
+// where no other route is both shorter and faster. Labels come off the
+// queue in lexicographic (distance, time) order, so each node's settled
+// labels get ever slower to be worth keeping: one number per node - the
+// best time settled there - decides dominance, instead of a label set.
+// Exact remaining distance and time from backward searches guide the queue
+// and cut labels that cannot beat the routes found so far.
+// One instance per thread; it holds per-node scratch.
+class ParetoSearch {
+public:
+    explicit ParetoSearch(const RoadGraph& g);
+
+    // Routes from source to target, shortest (and slowest) first, fastest
+    // last. A route is dropped unless it is more than epsilon faster than the
+    // previous one; at most maxRoutes are returned, keeping both extremes and
+    // spreading the rest. costs == nullptr uses the car's free flow.
+    std::vector<ParetoRoute> run(uint32_t source, uint32_t target, EdgeCostsPtr costs = nullptr,
+                                 double epsilon = 0.01, size_t maxRoutes = 6);
+
+    // Labels created by the last search
+    size_t labelCount() const { return m_labels.size(); }
+
+private:
+    const RoadGraph& m_graph;
+    ReverseAdjacency m_reverse;
+
+    struct Label {
+        double distance, duration;
+        uint32_t node, edge; // edge into node, INVALID_EDGE at the source
+        uint32_t parent;     // label index, INVALID_NODE at the source
+    };
+    std::vector<Label> m_labels;
+    std::vector<double> m_bestDuration; // per node: time of the last label settled there
+    std::vector<double> m_toTargetDistance, m_toTargetDuration;
+
+    // Costs from every node to target over the reverse graph
+    template <typename Cost>
+    void backward(uint32_t target, const Cost* cost, std::vector<double>& dist) const;
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "partition.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+constexpr uint8_t SOURCE = 1;
+constexpr uint8_t SINK = 2;
+
+Topology undirectedTopology(const RoadGraph& g) {
+    const size_t n = g.nodeCount();
+    Topology t;
+    t.firstOut.assign(n + 1, 0);
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+            if (g.head[e] == u) continue;
+            t.firstOut[u + 1]++;
+            t.firstOut[g.head[e] + 1]++;
+        }
+    }
+    for (size_t u = 0; u < n; ++u) t.firstOut[u + 1] += t.firstOut[u];
+
+    std::vector<uint32_t> fill(t.firstOut.begin(), t.firstOut.end() - 1);
+    t.head.resize(t.firstOut[n]);
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+            uint32_t v = g.head[e];
+            if (v == u) continue;
+            t.head[fill[u]++] = v;
+            t.head[fill[v]++] = u;
+        }
+    }
+
+    // Two-way streets and parallel edges show up twice; compact in place
+    uint32_t out = 0;
+    for (size_t u = 0; u < n; ++u) {
+        auto first = t.head.begin() + t.firstOut[u];
+        auto last = t.head.begin() + t.firstOut[u + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        t.firstOut[u] = out;
+        for (auto it = first; it != last; ++it) t.head[out++] = *it;
+    }
+    t.firstOut[n] = out;
+    t.head.resize(out);
+    t.head.shrink_to_fit();
+    return t;
+}
+
+InertialFlow::InertialFlow(const RoadGraph& g, const Topology& t)
+    : m_graph(g), m_topology(t), m_local(g.nodeCount(), INVALID_NODE)
+{
+}
+
+void InertialFlow::buildSubgraph(const std::vector<uint32_t>& nodes) {
+    const uint32_t k = static_cast<uint32_t>(nodes.size());
+    for (uint32_t i = 0; i < k; ++i) m_local[nodes[i]] = i;
+
+    m_firstArc.assign(k + 1, 0);
+    m_arcHead.clear();
+    for (uint32_t i = 0; i < k; ++i) {
+        uint32_t u = nodes[i];
+        for (uint32_t a = m_topology.firstOut[u]; a < m_topology.firstOut[u + 1]; ++a) {
+            uint32_t j = m_local[m_topology.head[a]];
+            if (j != INVALID_NODE) m_arcHead.push_back(j);
+        }
+        m_firstArc[i + 1] = static_cast<uint32_t>(m_arcHead.size());
+    }
+
+    // Local lists keep the topology's order, i.e. ascending graph ids
+    m_arcReverse.resize(m_arcHead.size());
+    for (uint32_t i = 0; i < k; ++i) {
+        for (uint32_t a = m_firstArc[i]; a < m_firstArc[i + 1]; ++a) {
+            uint32_t j = m_arcHead[a];
+            auto first = m_arcHead.begin() + m_firstArc[j];
+            auto last = m_arcHead.begin() + m_firstArc[j + 1];
+            auto it = std::lower_bound(first, last, nodes[i],
+                                       [&](uint32_t x, uint32_t id) { return nodes[x] < id; });
+            m_arcReverse[a] = static_cast<uint32_t>(it - m_arcHead.begin());
+        }
+    }
+
+    m_flow.resize(m_arcHead.size());
+    m_level.resize(k);
+    m_nextArc.resize(k);
+    m_role.resize(k);
+}
+
+size_t InertialFlow::maxFlow() {
+    const uint32_t k = static_cast<uint32_t>(m_role.size());
+    std::fill(m_flow.begin(), m_flow.end(), 0);
+    size_t flow = 0;
+
+    for (;;) {
+        // Level graph by breadth-first search from every source at once
+        std::fill(m_level.begin(), m_level.end(), -1);
+        m_queue.clear();
+        for (uint32_t i = 0; i < k; ++i) {
+            if (m_role[i] == SOURCE) {
+                m_level[i] = 0;
+                m_queue.push_back(i);
+            }
+        }
+        bool sinkReached = false;
+        for (size_t q = 0; q < m_queue.size(); ++q) {
+            uint32_t u = m_queue[q];
+            if (m_role[u] == SINK) {
+                sinkReached = true;
+                continue;
+            }
+            for (uint32_t a = m_firstArc[u]; a < m_firstArc[u + 1]; ++a) {
+                uint32_t v = m_arcHead[a];
+                if (m_flow[a] < 1 && m_level[v] < 0) {
+                    m_level[v] = m_level[u] + 1;
+                    m_queue.push_back(v);
+                }
+            }
+        }
+        if (!sinkReached) return flow;
+
+        // Blocking flow: depth-first along the levels, dead ends are cut off
+        std::copy(m_firstArc.begin(), m_firstArc.end() - 1, m_nextArc.begin());
+        for (uint32_t s = 0; s < k; ++s) {
+            if (m_role[s] != SOURCE) continue;
+            for (;;) {
+                m_path.clear();
+                uint32_t u = s;
+                while (m_role[u] != SINK) {
+                    uint32_t& a = m_nextArc[u];
+                    while (a < m_firstArc[u + 1] &&
+                           !(m_flow[a] < 1 && m_level[m_arcHead[a]] == m_level[u] + 1)) ++a;
+                    if (a < m_firstArc[u + 1]) {
+                        m_path.push_back(a);
+                        u = m_arcHead[a];
+                        continue;
+                    }
+                    m_level[u] = -1;
+                    if (m_path.empty()) break;
+                    uint32_t back = m_path.back();
+                    m_path.pop_back();
+                    u = m_arcHead[m_arcReverse[back]];
+                    ++m_nextArc[u];
+                }
+                if (m_role[u] != SINK) break; // s is exhausted
+                for (uint32_t a : m_path) {
+                    m_flow[a]++;
+                    m_flow[m_arcReverse[a]]--;
+                }
+                flow++;
+            }
+        }
+    }
+}
+
+void InertialFlow::sourceSide(std::vector<uint8_t>& reached) {
+    const uint32_t k = static_cast<uint32_t>(m_role.size());
+    reached.assign(k, 0);
+    m_queue.clear();
+    for (uint32_t i = 0; i < k; ++i) {
+        if (m_role[i] == SOURCE) {
+            reached[i] = 1;
+            m_queue.push_back(i);
+        }
+    }
+    for (size_t q = 0; q < m_queue.size(); ++q) {
+        uint32_t u = m_queue[q];
+        for (uint32_t a = m_firstArc[u]; a < m_firstArc[u + 1]; ++a) {
+            uint32_t v = m_arcHead[a];
+            if (m_flow[a] < 1 && !reached[v]) {
+                reached[v] = 1;
+                m_queue.push_back(v);
+            }
+        }
+    }
+}
+
+size_t InertialFlow::bisect(std::vector<uint32_t>& nodes, double balance) {
+    const size_t k = nodes.size();
+    m_cutSize = 0;
+    if (k < 2) return k;
+    buildSubgraph(nodes);
+
+    // Projections in meters; two axes and both diagonals
+    static const double DIRECTIONS[4][2] = {
+        {1.0, 0.0}, {0.0, 1.0}, {M_SQRT1_2, M_SQRT1_2}, {M_SQRT1_2, -M_SQRT1_2}
+    };
+    const size_t share = std::max<size_t>(1, static_cast<size_t>(k * balance));
+    std::vector<std::pair<double, uint32_t>> order(k);
+    std::vector<uint8_t> side, bestSide;
+    size_t bestCut = std::numeric_limits<size_t>::max(), bestImbalance = 0;
+
+    for (const auto& dir : DIRECTIONS) {
+        for (uint32_t i = 0; i < k; ++i) {
+            const Node& c = m_graph.coords[nodes[i]];
+            double x = c.lon * m_graph.metersPerLonUnit;
+            double y = c.lat * m_graph.metersPerLatUnit;
+            order[i] = {dir[0] * x + dir[1] * y, i};
+        }
+        std::nth_element(order.begin(), order.begin() + share, order.end());
+        std::nth_element(order.begin() + share, order.end() - share, order.end());
+        std::fill(m_role.begin(), m_role.end(), 0);
+        for (size_t i = 0; i < share; ++i) m_role[order[i].second] = SOURCE;
+        for (size_t i = k - share; i < k; ++i) m_role[order[i].second] = SINK;
+
+        size_t cut = maxFlow();
+        sourceSide(side);
+        size_t count = static_cast<size_t>(std::count(side.begin(), side.end(), 1));
+        size_t imbalance = count * 2 > k ? count * 2 - k : k - count * 2;
+        if (cut < bestCut || (cut == bestCut && imbalance < bestImbalance)) {
+            bestCut = cut;
+            bestImbalance = imbalance;
+            bestSide.swap(side);
+        }
+    }
+
+    auto mid = std::stable_partition(nodes.begin(), nodes.end(),
+                                     [&](uint32_t v) { return bestSide[m_local[v]] != 0; });
+    for (uint32_t v : nodes) m_local[v] = INVALID_NODE;
+    m_cutSize = bestCut;
+    return static_cast<size_t>(mid - nodes.begin());
+}
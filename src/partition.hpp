@@ -0,0 +1,59 @@
+#ifndef PARTITION
+#define PARTITION
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "road_graph.hpp"
+
+// Undirected, unweighted adjacency of the road network: u and v are
+// neighbours if an edge joins them in either direction. Per-node lists are
+// sorted, without duplicates or self loops.
+struct Topology {
+    std::vector<uint32_t> firstOut; // neighbours of u are head[firstOut[u], firstOut[u + 1])
+    std::vector<uint32_t> head;
+
+    size_t nodeCount() const { return firstOut.size() - 1; }
+};
+
+Topology undirectedTopology(const RoadGraph& g);
+
+// Inertial flow bisection: project the nodes onto a few directions, take the
+// first and last share along each as source and sink, and keep the smallest
+// of the resulting minimum edge cuts (unit capacities, Dinic's algorithm).
+// Road networks have small cuts along geography, which this finds cheaply.
+class InertialFlow {
+public:
+    InertialFlow(const RoadGraph& g, const Topology& t);
+
+    // Reorder nodes so that nodes[0, returned) is one side of a small cut of
+    // the subgraph the nodes induce. Each side keeps at least `balance` of them.
+    size_t bisect(std::vector<uint32_t>& nodes, double balance = 0.25);
+
+    // Number of edges cut by the last bisection
+    size_t cutSize() const { return m_cutSize; }
+
+private:
+    const RoadGraph& m_graph;
+    const Topology& m_topology;
+    size_t m_cutSize = 0;
+
+    // Scratch for the induced subgraph, in local ids 0..k-1
+    std::vector<uint32_t> m_local;     // graph node -> local id, INVALID_NODE outside
+    std::vector<uint32_t> m_firstArc;
+    std::vector<uint32_t> m_arcHead;
+    std::vector<uint32_t> m_arcReverse;
+    std::vector<int8_t> m_flow;        // per arc, -1..1; the reverse arc holds the negation
+    std::vector<int32_t> m_level;
+    std::vector<uint32_t> m_nextArc;
+    std::vector<uint8_t> m_role;       // SOURCE, SINK or 0
+    std::vector<uint32_t> m_queue;
+    std::vector<uint32_t> m_path;
+
+    void buildSubgraph(const std::vector<uint32_t>& nodes);
+    size_t maxFlow();
+    void sourceSide(std::vector<uint8_t>& reached);
+};
+
+#endif
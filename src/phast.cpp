@@ -0,0 +1,80 @@
+#include "phast.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+static const double INF = std::numeric_limits<double>::infinity();
+
+Phast::Phast(const CustomizableCH& ch)
+    : m_ch(ch)
+{
+}
+
+void Phast::run(const CchMetric& metric, const std::vector<uint32_t>& sources, const TreeCallback& onTree,
+                unsigned threads) const {
+    const size_t n = m_ch.nodeCount();
+    const size_t batches = (sources.size() + PHAST_BATCH - 1) / PHAST_BATCH;
+    if (batches == 0) return;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, batches));
+
+    // Per worker: costs by rank, PHAST_BATCH per node, and one tree by graph node
+    struct Scratch {
+        std::vector<double> cost;
+        std::vector<double> tree;
+    };
+    std::vector<Scratch> scratch(threads);
+
+    parallelFor(batches, threads, [&](size_t batch, unsigned worker) {
+        Scratch& s = scratch[worker];
+        if (s.cost.empty()) {
+            s.cost.resize(n * PHAST_BATCH);
+            s.tree.resize(n);
+        }
+        std::fill(s.cost.begin(), s.cost.end(), INF);
+        double* cost = s.cost.data();
+        const size_t first = batch * PHAST_BATCH;
+        const size_t count = std::min(PHAST_BATCH, sources.size() - first);
+
+        // Upward: every arc out of a node leads to one of its elimination tree
+        // ancestors, so the path to the root in rank order is a valid order
+        for (size_t k = 0; k < count; ++k) {
+            if (sources[first + k] >= n) continue;
+            const uint32_t r = m_ch.m_rank[sources[first + k]];
+            cost[r * PHAST_BATCH + k] = 0.0;
+            for (uint32_t x = r; x != INVALID_NODE; x = m_ch.m_parent[x]) {
+                const double dx = cost[x * PHAST_BATCH + k];
+                if (dx == INF) continue;
+                for (uint32_t a = m_ch.m_firstArc[x]; a < m_ch.m_firstArc[x + 1]; ++a) {
+                    double& dw = cost[m_ch.m_arcHead[a] * PHAST_BATCH + k];
+                    dw = std::min(dw, dx + metric.up[a]);
+                }
+            }
+        }
+
+        // Downward: from the top rank down, each node's upward neighbours are final
+        for (size_t r = n; r-- > 0;) {
+            double* dv = cost + r * PHAST_BATCH;
+            for (uint32_t a = m_ch.m_firstArc[r]; a < m_ch.m_firstArc[r + 1]; ++a) {
+                const double c = metric.down[a];
+                if (c == INF) continue;
+                const double* dw = cost + m_ch.m_arcHead[a] * PHAST_BATCH;
+                for (size_t k = 0; k < PHAST_BATCH; ++k) dv[k] = std::min(dv[k], dw[k] + c);
+            }
+        }
+
+        for (size_t k = 0; k < count; ++k) {
+            if (sources[first + k] >= n) continue;
+            for (size_t v = 0; v < n; ++v) s.tree[v] = cost[m_ch.m_rank[v] * PHAST_BATCH + k];
+            onTree(first + k, worker, s.tree);
+        }
+    }, 1);
+}
+
+std::vector<double> Phast::tree(const CchMetric& metric, uint32_t source) const {
+    std::vector<double> result;
+    run(metric, {source}, [&](size_t, unsigned, const std::vector<double>& cost) { result = cost; }, 1);
+    return result;
+}
@@ -0,0 +1,42 @@
+#ifndef PHAST
+#define PHAST
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "customizable_ch.hpp"
+
+// How many sources share one PHAST sweep: their costs for a node fill one
+// 64-byte cache line, and the inner loop over them vectorizes
+constexpr size_t PHAST_BATCH = 8;
+
+// One-to-all shortest paths (PHAST, Delling et al.). From each source a
+// search walks up the elimination tree, then one linear sweep over all ranks
+// from the top down settles every node from its upward neighbours - no
+// priority queue and no random access beyond the arcs. PHAST_BATCH sources
+// go through each sweep together and batches run in parallel.
+class Phast {
+public:
+    // Receives the cost from sources[source] to every graph node (infinity
+    // where unreachable). Called concurrently from the workers; worker is
+    // below the thread count, for per-thread accumulators. The vector is
+    // reused once the call returns.
+    using TreeCallback = std::function<void(size_t source, unsigned worker, const std::vector<double>& cost)>;
+
+    explicit Phast(const CustomizableCH& ch);
+
+    // Shortest path tree costs from every source; threads == 0 uses every core.
+    // Each worker holds PHAST_BATCH doubles per node.
+    void run(const CchMetric& metric, const std::vector<uint32_t>& sources, const TreeCallback& onTree,
+             unsigned threads = 0) const;
+
+    // Cost from source to every graph node
+    std::vector<double> tree(const CchMetric& metric, uint32_t source) const;
+
+private:
+    const CustomizableCH& m_ch;
+};
+
+#endif
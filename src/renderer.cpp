@@ -44,6 +44,28 @@ void Renderer::render() const
         glLineWidth(1.5f);
     }
 
+    // Render routes
+    if (!m_routeOffsets.empty() && m_routeVAO != 0) {
+        static const float palette[][3] = {
+            {0.0f, 1.0f, 1.0f}, {1.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 0.0f},
+            {0.3f, 1.0f, 0.3f}, {0.4f, 0.6f, 1.0f}, {1.0f, 1.0f, 1.0f},
+        };
+        const size_t colours = sizeof(palette) / sizeof(palette[0]);
+
+        if (m_uOffsetLoc >= 0) glUniform2f(m_uOffsetLoc, m_camOffsetX, m_camOffsetY);
+        if (m_uScaleLoc >= 0) glUniform1f(m_uScaleLoc, m_camScale);
+        if (m_uAspectLoc >= 0) glUniform1f(m_uAspectLoc, static_cast<float>(m_viewportHeight) / static_cast<float>(m_viewportWidth));
+
+        glBindVertexArray(m_routeVAO);
+        glLineWidth(3.0f);
+        for (size_t i = 0; i < m_routeOffsets.size(); i++) {
+            const float* c = palette[i % colours];
+            if (m_uColorLoc >= 0) glUniform3f(m_uColorLoc, c[0], c[1], c[2]);
+            glDrawArrays(GL_LINE_STRIP, static_cast<GLint>(m_routeOffsets[i]), static_cast<GLsizei>(m_routeLengths[i]));
+        }
+        glLineWidth(1.5f);
+    }
+
     // Render points
     if (m_hasPoints && !m_pointVertices.empty() && m_pointVAO != 0) {
         if (m_uOffsetLoc >= 0) glUniform2f(m_uOffsetLoc, m_camOffsetX, m_camOffsetY);
@@ -243,6 +265,38 @@ void Renderer::clearPath() {
     m_pathIndices.clear();
 }
 
+void Renderer::setRoutes(const std::vector<std::vector<float>>& routes) {
+    m_routeVertices.clear();
+    m_routeOffsets.clear();
+    m_routeLengths.clear();
+    for (const auto& route : routes) {
+        if (route.size() < 6) continue; // a line strip needs two vertices
+        m_routeOffsets.push_back(m_routeVertices.size() / 3);
+        m_routeLengths.push_back(route.size() / 3);
+        m_routeVertices.insert(m_routeVertices.end(), route.begin(), route.end());
+    }
+
+    if (m_routeVAO == 0) {
+        glGenVertexArrays(1, &m_routeVAO);
+        glGenBuffers(1, &m_routeVBO);
+    }
+
+    glBindVertexArray(m_routeVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_routeVBO);
+    glBufferData(GL_ARRAY_BUFFER, m_routeVertices.size() * sizeof(float), m_routeVertices.data(), GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+}
+
+void Renderer::clearRoutes() {
+    m_routeVertices.clear();
+    m_routeOffsets.clear();
+    m_routeLengths.clear();
+}
+
 void Renderer::setPoints(const std::vector<float>& vertices) {
     m_pointVertices = vertices;
     m_hasPoints = !vertices.empty();
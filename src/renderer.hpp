@@ -25,6 +25,12 @@ private:
     GLuint m_pathVAO, m_pathVBO, m_pathEBO;
     bool m_hasPath = false;
 
+    // Several paths, each drawn in its own colour (one per vehicle)
+    std::vector<float> m_routeVertices;
+    std::vector<size_t> m_routeOffsets;
+    std::vector<size_t> m_routeLengths;
+    GLuint m_routeVAO = 0, m_routeVBO = 0;
+
     // Point rendering (for start/end nodes)
     std::vector<float> m_pointVertices;
     GLuint m_pointVAO = 0, m_pointVBO = 0;
@@ -73,6 +79,10 @@ public:
     void setPathIndices(const std::vector<unsigned int>& indices);
     void clearPath();
 
+    // Multi-route rendering methods
+    void setRoutes(const std::vector<std::vector<float>>& routes);
+    void clearRoutes();
+
     // Point rendering methods
     void setPoints(const std::vector<float>& vertices);
     void clearPoints();
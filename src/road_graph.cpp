@@ -0,0 +1,319 @@
+#include "road_graph.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <random>
+
+constexpr double PI_CONST = 3.14159265358979323846;
+inline double deg2rad(double deg) { return deg * PI_CONST / 180.0; }
+
+double haversine(double lat1, double lon1, double lat2, double lon2) {
+    // Returns distance in meters
+    const double R = 6371000.0; // mean Earth radius in meters
+    double dLat = deg2rad(lat2 - lat1);
+    double dLon = deg2rad(lon2 - lon1);
+    double a = std::sin(dLat / 2.0) * std::sin(dLat / 2.0) +
+               std::cos(deg2rad(lat1)) * std::cos(deg2rad(lat2)) *
+               std::sin(dLon / 2.0) * std::sin(dLon / 2.0);
+    double c = 2.0 * std::atan2(std::sqrt(a), std::sqrt(1.0 - a));
+    return R * c;
+}
+
+RoadClass roadClassFromTag(const char* highway) {
+    static const std::unordered_map<std::string, RoadClass> classes = {
+        {"motorway", RoadClass::Motorway}, {"trunk", RoadClass::Trunk},
+        {"primary", RoadClass::Primary}, {"secondary", RoadClass::Secondary},
+        {"tertiary", RoadClass::Tertiary}, {"unclassified", RoadClass::Unclassified},
+        {"residential", RoadClass::Residential}, {"service", RoadClass::Service},
+        {"living_street", RoadClass::LivingStreet}, {"motorway_link", RoadClass::MotorwayLink},
+        {"primary_link", RoadClass::PrimaryLink}, {"secondary_link", RoadClass::SecondaryLink},
+        {"tertiary_link", RoadClass::TertiaryLink}, {"track", RoadClass::Track},
+        {"path", RoadClass::Path}, {"footway", RoadClass::Footway}, {"cycleway", RoadClass::Cycleway},
+        {"pedestrian", RoadClass::Pedestrian}, {"steps", RoadClass::Steps}
+    };
+    if (!highway) return RoadClass::Other;
+    auto it = classes.find(highway);
+    return it != classes.end() ? it->second : RoadClass::Other;
+}
+
+const char* roadClassName(RoadClass rc) {
+    static const char* const names[] = {
+        "motorway", "trunk", "primary", "secondary", "tertiary", "unclassified",
+        "residential", "service", "living_street", "motorway_link", "primary_link",
+        "secondary_link", "tertiary_link", "track", "path", "footway", "cycleway",
+        "pedestrian", "steps", "other"
+    };
+    return names[static_cast<size_t>(rc)];
+}
+
+uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+    // Classic xy -> d conversion, see "Hacker's Delight" 16-2
+    const uint32_t n = 1u << 16;
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant so the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+RoadGraph buildRoadGraph(const std::unordered_map<int64_t, Node>& osmNodes,
+                         const std::vector<RawEdge>& edges) {
+    RoadGraph g;
+
+    // Collect every node that takes part in at least one edge
+    std::vector<int64_t> roadNodes;
+    roadNodes.reserve(edges.size());
+    for (const auto& e : edges) {
+        roadNodes.push_back(e.from);
+        roadNodes.push_back(e.to);
+    }
+    std::sort(roadNodes.begin(), roadNodes.end());
+    roadNodes.erase(std::unique(roadNodes.begin(), roadNodes.end()), roadNodes.end());
+
+    if (roadNodes.empty()) {
+        g.firstOut.assign(1, 0);
+        return g;
+    }
+
+    // Bounding box of the road network for the Hilbert grid
+    int32_t minLat = std::numeric_limits<int32_t>::max();
+    int32_t maxLat = std::numeric_limits<int32_t>::lowest();
+    int32_t minLon = std::numeric_limits<int32_t>::max();
+    int32_t maxLon = std::numeric_limits<int32_t>::lowest();
+    for (int64_t id : roadNodes) {
+        const Node& p = osmNodes.at(id);
+        minLat = std::min(minLat, p.lat);
+        maxLat = std::max(maxLat, p.lat);
+        minLon = std::min(minLon, p.lon);
+        maxLon = std::max(maxLon, p.lon);
+    }
+    // Admissible equirectangular scales for the A* heuristic; the small
+    // safety margin absorbs the flat-earth and rounding error
+    const double EARTH_RADIUS = 6371000.0;
+    const double unitRad = deg2rad(1.0 / COORDINATE_PRECISION);
+    double maxAbsLat = std::max(std::abs(minLat / COORDINATE_PRECISION), std::abs(maxLat / COORDINATE_PRECISION));
+    g.metersPerLatUnit = EARTH_RADIUS * unitRad * 0.999;
+    g.metersPerLonUnit = EARTH_RADIUS * unitRad * std::cos(deg2rad(maxAbsLat)) * 0.999;
+
+    int64_t latRange = std::max<int64_t>(int64_t(maxLat) - minLat, 1);
+    int64_t lonRange = std::max<int64_t>(int64_t(maxLon) - minLon, 1);
+
+    // Order nodes along the Hilbert curve (ties broken by OSM id for determinism)
+    std::vector<std::pair<uint64_t, int64_t>> order;
+    order.reserve(roadNodes.size());
+    for (int64_t id : roadNodes) {
+        const Node& p = osmNodes.at(id);
+        auto x = static_cast<uint32_t>((int64_t(p.lon) - minLon) * 65535 / lonRange);
+        auto y = static_cast<uint32_t>((int64_t(p.lat) - minLat) * 65535 / latRange);
+        order.push_back({hilbertIndex(x, y), id});
+    }
+    std::sort(order.begin(), order.end());
+
+    const size_t n = order.size();
+    g.coords.resize(n);
+    g.osmIds.resize(n);
+    g.denseIds.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        int64_t id = order[i].second;
+        g.osmIds[i] = id;
+        g.coords[i] = osmNodes.at(id);
+        g.denseIds[id] = static_cast<uint32_t>(i);
+    }
+
+    // Counting sort of the edges by their dense source id
+    g.firstOut.assign(n + 1, 0);
+    for (const auto& e : edges) {
+        g.firstOut[g.denseIds[e.from] + 1]++;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        g.firstOut[i + 1] += g.firstOut[i];
+    }
+
+    std::vector<uint32_t> fill(g.firstOut.begin(), g.firstOut.end() - 1);
+    struct OutEdge {
+        uint32_t head;
+        double weight;
+        float duration;
+        uint32_t way;
+        uint8_t access;
+        bool operator<(const OutEdge& o) const { return head < o.head; }
+    };
+    std::vector<OutEdge> out(edges.size());
+    for (const auto& e : edges) {
+        uint32_t u = g.denseIds[e.from];
+        out[fill[u]++] = {g.denseIds[e.to], e.weight, e.duration, e.way, e.access};
+    }
+
+    // Within each node, visit neighbours in memory order
+    for (size_t u = 0; u < n; ++u) {
+        std::sort(out.begin() + g.firstOut[u], out.begin() + g.firstOut[u + 1]);
+    }
+
+    g.head.resize(out.size());
+    g.weight.resize(out.size());
+    g.duration.resize(out.size());
+    g.edgeWay.resize(out.size());
+    g.edgeAccess.resize(out.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        g.head[i] = out[i].head;
+        g.weight[i] = out[i].weight;
+        g.duration[i] = out[i].duration;
+        g.edgeWay[i] = out[i].way;
+        g.edgeAccess[i] = out[i].access;
+        if (out[i].duration > 0.0f) {
+            g.maxSpeed = std::max(g.maxSpeed, out[i].weight / out[i].duration);
+        }
+    }
+
+    computeComponents(g);
+    return g;
+}
+
+ReverseAdjacency reverseAdjacency(const RoadGraph& g) {
+    const size_t n = g.nodeCount();
+    ReverseAdjacency r;
+    r.firstIn.assign(n + 1, 0);
+    for (uint32_t e = 0; e < g.edgeCount(); ++e) r.firstIn[g.head[e] + 1]++;
+    for (size_t v = 0; v < n; ++v) r.firstIn[v + 1] += r.firstIn[v];
+
+    std::vector<uint32_t> fill(r.firstIn.begin(), r.firstIn.end() - 1);
+    r.edge.resize(g.edgeCount());
+    r.tail.resize(g.edgeCount());
+    for (uint32_t u = 0; u < n; ++u) {
+        for (uint32_t e = g.firstOut[u]; e < g.firstOut[u + 1]; ++e) {
+            uint32_t slot = fill[g.head[e]]++;
+            r.edge[slot] = e;
+            r.tail[slot] = u;
+        }
+    }
+    return r;
+}
+
+RoadGraph syntheticGrid(uint32_t side, uint32_t seed) {
+    const double BLOCK = 80.0;       // meters between crossings
+    const double SPEED = 50.0 / 3.6; // m/s
+    const double dLat = BLOCK / 111195.0;
+    const double dLon = BLOCK / (111195.0 * std::cos(deg2rad(24.86)));
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> stretch(1.0, 1.5);
+
+    std::unordered_map<int64_t, Node> nodes;
+    std::vector<RawEdge> edges;
+    auto id = [&](uint32_t r, uint32_t c) { return int64_t(r) * side + c + 1; };
+    for (uint32_t r = 0; r < side; ++r) {
+        for (uint32_t c = 0; c < side; ++c) nodes[id(r, c)] = {toFixed(24.8 + r * dLat), toFixed(67.0 + c * dLon)};
+    }
+    auto street = [&](int64_t a, int64_t b) {
+        const Node& x = nodes[a];
+        const Node& y = nodes[b];
+        double length = haversine(x.latDeg(), x.lonDeg(), y.latDeg(), y.lonDeg()) * stretch(rng);
+        float seconds = static_cast<float>(length / SPEED);
+        edges.push_back({a, b, length, seconds, 0});
+        edges.push_back({b, a, length, seconds, 0});
+    };
+    for (uint32_t r = 0; r < side; ++r) {
+        for (uint32_t c = 0; c < side; ++c) {
+            if (c + 1 < side) street(id(r, c), id(r, c + 1));
+            if (r + 1 < side) street(id(r, c), id(r + 1, c));
+        }
+    }
+
+    RoadGraph g = buildRoadGraph(nodes, edges);
+    WayInfo way{0, 0, RoadClass::Residential, false};
+    for (float& speed : way.speed) speed = static_cast<float>(SPEED);
+    g.ways.push_back(way);
+    g.names.push_back("");
+    return g;
+}
+
+// Components of the edges open to one profile; nodes it cannot leave or
+// enter end up alone
+static void computeComponents(RoadGraph& g, Profile profile) {
+    const uint32_t n = static_cast<uint32_t>(g.nodeCount());
+    const size_t p = static_cast<size_t>(profile);
+    const uint8_t bit = profileBit(profile);
+    std::vector<uint32_t>& component = g.component[p];
+    component.assign(n, INVALID_NODE);
+    g.componentCount[p] = 0;
+    g.largestComponent[p] = 0;
+    if (n == 0) return;
+
+    std::vector<uint32_t> index(n, INVALID_NODE);
+    std::vector<uint32_t> lowlink(n, 0);
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> componentSize;
+
+    // Explicit DFS stack of (node, next edge to visit) so that long roads
+    // do not overflow the call stack
+    std::vector<std::pair<uint32_t, uint32_t>> dfs;
+    uint32_t nextIndex = 0;
+
+    for (uint32_t root = 0; root < n; ++root) {
+        if (index[root] != INVALID_NODE) continue;
+
+        dfs.push_back({root, g.firstOut[root]});
+        index[root] = lowlink[root] = nextIndex++;
+        stack.push_back(root);
+
+        while (!dfs.empty()) {
+            uint32_t v = dfs.back().first;
+            uint32_t& e = dfs.back().second;
+
+            if (e < g.firstOut[v + 1]) {
+                if (!(g.edgeAccess[e] & bit)) {
+                    ++e;
+                    continue;
+                }
+                uint32_t w = g.head[e++];
+                if (index[w] == INVALID_NODE) {
+                    index[w] = lowlink[w] = nextIndex++;
+                    stack.push_back(w);
+                    dfs.push_back({w, g.firstOut[w]});
+                } else if (component[w] == INVALID_NODE) {
+                    // w is still on the stack
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+
+            // All edges of v done: pop a component if v is its root
+            if (lowlink[v] == index[v]) {
+                uint32_t size = 0;
+                uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    component[w] = g.componentCount[p];
+                    ++size;
+                } while (w != v);
+                componentSize.push_back(size);
+                g.componentCount[p]++;
+            }
+
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                uint32_t parent = dfs.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[v]);
+            }
+        }
+    }
+
+    g.largestComponent[p] = static_cast<uint32_t>(
+        std::max_element(componentSize.begin(), componentSize.end()) - componentSize.begin());
+}
+
+void computeComponents(RoadGraph& g) {
+    for (size_t p = 0; p < PROFILE_COUNT; ++p) computeComponents(g, static_cast<Profile>(p));
+}
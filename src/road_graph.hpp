@@ -0,0 +1,157 @@
+#ifndef ROAD_GRAPH
+#define ROAD_GRAPH
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <string>
+#include <cmath>
+
+// OSM's native precision: coordinates in 1e-7 degree units fit an int32,
+// the same fixed-point layout osmium::Location uses
+constexpr double COORDINATE_PRECISION = 10000000.0;
+
+inline int32_t toFixed(double deg) {
+    return static_cast<int32_t>(std::lround(deg * COORDINATE_PRECISION));
+}
+
+// Road node coordinates, 8 bytes instead of two doubles.
+// Convert to degrees only where floating point math is needed.
+struct Node {
+    int32_t lat, lon;
+
+    double latDeg() const { return lat / COORDINATE_PRECISION; }
+    double lonDeg() const { return lon / COORDINATE_PRECISION; }
+};
+
+// Travel modes routed on the one graph; each edge records which may use it
+enum class Profile : uint8_t { Car, Motorbike, Bicycle, Foot };
+constexpr size_t PROFILE_COUNT = 4;
+constexpr uint8_t ALL_PROFILES = (1u << PROFILE_COUNT) - 1;
+
+inline uint8_t profileBit(Profile p) { return static_cast<uint8_t>(1u << static_cast<unsigned>(p)); }
+
+// Directed road edge between two OSM nodes, as collected by the map loader
+struct RawEdge {
+    int64_t from, to;
+    double weight;   // meters
+    float duration;  // seconds at the way's car speed, or its fastest profile's where cars may not go
+    uint32_t way;    // index into RoadGraph::ways
+    uint8_t access = ALL_PROFILES; // profileBit()s allowed in this direction
+};
+
+// OSM highway classes kept in the routing graph
+enum class RoadClass : uint8_t {
+    Motorway, Trunk, Primary, Secondary, Tertiary, Unclassified, Residential,
+    Service, LivingStreet, MotorwayLink, PrimaryLink, SecondaryLink, TertiaryLink,
+    Track, Path, Footway, Cycleway, Pedestrian, Steps,
+    Other
+};
+
+RoadClass roadClassFromTag(const char* highway);
+const char* roadClassName(RoadClass rc);
+
+// Per-way attributes shared by all edges of an OSM way
+struct WayInfo {
+    int64_t osmId;
+    uint32_t name;       // index into RoadGraph::names, 0 = unnamed
+    RoadClass roadClass;
+    bool roundabout;
+    uint32_t firstNode = 0; // geometry: RoadGraph::wayNodes[firstNode, firstNode + nodeCount)
+    uint32_t nodeCount = 0;
+    float speed[PROFILE_COUNT] = {}; // m/s per profile, 0 where unknown or not allowed
+    bool toll = false;
+};
+
+constexpr uint32_t INVALID_NODE = UINT32_MAX;
+constexpr uint32_t INVALID_EDGE = UINT32_MAX;
+
+// Routing graph in compressed sparse row form.
+// Road nodes get dense ids in Hilbert-curve order over their coordinates,
+// so intersections that are close on the map are also close in memory.
+struct RoadGraph {
+    std::vector<Node> coords;                         // dense id -> coordinates
+    std::vector<int64_t> osmIds;                      // dense id -> OSM node id
+    std::unordered_map<int64_t, uint32_t> denseIds;   // OSM node id -> dense id
+
+    std::vector<uint32_t> firstOut;                   // out edges of u are [firstOut[u], firstOut[u + 1])
+    std::vector<uint32_t> head;                       // edge -> target dense id
+    std::vector<double> weight;                       // edge -> length in meters
+    std::vector<float> duration;                      // edge -> travel time in seconds
+    std::vector<uint32_t> edgeWay;                    // edge -> index into ways
+    std::vector<uint8_t> edgeAccess;                  // edge -> profileBit()s allowed along it
+
+    std::vector<WayInfo> ways;
+    std::vector<std::string> names;                   // interned way names, names[0] == ""
+    std::vector<uint32_t> wayNodes;                   // dense node ids of every way, in way order
+    double maxSpeed = 0.0;                            // fastest edge in m/s, bounds travel-time heuristics
+
+    // Equirectangular projection scales (meters per fixed-point unit). The
+    // longitude scale uses the most poleward latitude of the network so that
+    // projected distances never exceed great-circle distances.
+    double metersPerLatUnit = 0.0;
+    double metersPerLonUnit = 0.0;
+
+    // Per profile, over the edges it may use: dense id -> strongly
+    // connected component, numbered in reverse topological order
+    std::vector<uint32_t> component[PROFILE_COUNT];
+    uint32_t componentCount[PROFILE_COUNT] = {};
+    uint32_t largestComponent[PROFILE_COUNT] = {};
+
+    size_t nodeCount() const { return coords.size(); }
+    size_t edgeCount() const { return head.size(); }
+
+    // O(1) necessary (not sufficient) condition for a path u -> v open to
+    // profile. Tarjan numbers components in reverse topological order, so
+    // an edge between two components always leads to a lower number.
+    bool mayReach(uint32_t u, uint32_t v, Profile profile) const {
+        const std::vector<uint32_t>& c = component[static_cast<size_t>(profile)];
+        return c[u] >= c[v];
+    }
+    bool inLargestComponent(uint32_t v, Profile profile) const {
+        const size_t p = static_cast<size_t>(profile);
+        return component[p][v] == largestComponent[p];
+    }
+
+    // Dense id for an OSM node id, INVALID_NODE if it is not a road node
+    uint32_t toDense(int64_t osmId) const {
+        auto it = denseIds.find(osmId);
+        return it != denseIds.end() ? it->second : INVALID_NODE;
+    }
+};
+
+// Edges into each node, for searches that run against edge direction
+struct ReverseAdjacency {
+    std::vector<uint32_t> firstIn; // node -> first slot, size nodeCount() + 1
+    std::vector<uint32_t> edge;    // slot -> graph edge
+    std::vector<uint32_t> tail;    // slot -> node the edge leaves
+};
+
+ReverseAdjacency reverseAdjacency(const RoadGraph& g);
+
+// Great-circle distance in meters
+double haversine(double lat1, double lon1, double lat2, double lon2);
+
+// Position of (x, y) along a Hilbert curve covering a 2^16 x 2^16 grid
+uint64_t hilbertIndex(uint32_t x, uint32_t y);
+
+// Build the CSR graph from loader output. Only nodes referenced by an edge
+// become road nodes; they are numbered along a Hilbert curve and the
+// adjacency is permuted to match. Components are labelled before returning.
+RoadGraph buildRoadGraph(const std::unordered_map<int64_t, Node>& osmNodes,
+                         const std::vector<RawEdge>& edges);
+
+// Synthetic side x side street grid near Karachi for benchmarks beyond the
+// extract: 80 m blocks, two-way streets, lengths stretched by up to half
+// (seeded), one residential way
+RoadGraph syntheticGrid(uint32_t side, uint32_t seed = 1);
+
+// Label strongly connected components of every profile's edges (iterative
+// Tarjan, so numbered in reverse topological order) and remember the largest
+void computeComponents(RoadGraph& g);
+
+// The graph loaded by initAStar
+const RoadGraph& getRoadGraph();
+
+#endif
@@ -0,0 +1,142 @@
+#include "search.hpp"
+
+#include <limits>
+#include <algorithm>
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+Search<Metric, Heuristic, Queue, Stop>::Search(const RoadGraph& g)
+    : m_graph(g)
+{
+    useCosts(nullptr);
+    const size_t n = g.nodeCount();
+    m_dist.resize(n);
+    m_parent.resize(n);
+    m_parentEdge.resize(n);
+    m_stamp.assign(n, 0);
+    m_settled.assign(n, 0);
+    m_queue.resize(n);
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+void Search<Metric, Heuristic, Queue, Stop>::useCosts(EdgeCostsPtr costs) {
+    m_costs = costs ? std::move(costs) : freeFlowSnapshot(m_graph);
+    m_metric.use(*m_costs);
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+typename Search<Metric, Heuristic, Queue, Stop>::Weight
+Search<Metric, Heuristic, Queue, Stop>::distance(uint32_t v) const {
+    return reached(v) ? m_dist[v] : std::numeric_limits<Weight>::infinity();
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+std::vector<uint32_t> Search<Metric, Heuristic, Queue, Stop>::path(uint32_t v) const {
+    std::vector<uint32_t> nodes;
+    if (v == INVALID_NODE || !reached(v)) return nodes;
+    for (uint32_t at = v; at != INVALID_NODE; at = m_parent[at]) {
+        nodes.push_back(at);
+    }
+    std::reverse(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+std::vector<uint32_t> Search<Metric, Heuristic, Queue, Stop>::edgePath(uint32_t v) const {
+    std::vector<uint32_t> edges;
+    if (v == INVALID_NODE || !reached(v)) return edges;
+    for (uint32_t at = v; m_parent[at] != INVALID_NODE; at = m_parent[at]) {
+        edges.push_back(m_parentEdge[at]);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return edges;
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+void Search<Metric, Heuristic, Queue, Stop>::beginRound(uint32_t target) {
+    // New round; on wrap-around really clear the stamps once
+    if (++m_round == 0) {
+        std::fill(m_stamp.begin(), m_stamp.end(), 0);
+        std::fill(m_settled.begin(), m_settled.end(), 0);
+        m_round = 1;
+    }
+    m_queue.clear();
+    m_settledCount = 0;
+
+    if (target != INVALID_NODE) m_heuristic.setTarget(m_graph, target);
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+void Search<Metric, Heuristic, Queue, Stop>::seed(uint32_t v, Weight d) {
+    if (m_stamp[v] == m_round && !(d < m_dist[v])) return;
+    m_stamp[v] = m_round;
+    m_dist[v] = d;
+    m_parent[v] = INVALID_NODE;
+    m_parentEdge[v] = INVALID_EDGE;
+    m_queue.push(v, static_cast<Weight>(d + m_heuristic(v)));
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+uint32_t Search<Metric, Heuristic, Queue, Stop>::run(uint32_t source, uint32_t target) {
+    beginRound(target);
+    seed(source, Weight(0));
+    return loop(target);
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+uint32_t Search<Metric, Heuristic, Queue, Stop>::run(const std::vector<std::pair<uint32_t, Weight>>& sources,
+                                                     uint32_t target) {
+    beginRound(target);
+    for (const auto& s : sources) seed(s.first, s.second);
+    return loop(target);
+}
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+uint32_t Search<Metric, Heuristic, Queue, Stop>::loop(uint32_t target) {
+    const auto& firstOut = m_graph.firstOut;
+    const auto& head = m_graph.head;
+
+    while (!m_queue.empty()) {
+        uint32_t u = m_queue.pop();
+        if (m_settled[u] == m_round) continue; // stale duplicate
+        m_settled[u] = m_round;
+        m_settledCount++;
+
+        const Weight du = m_dist[u];
+        if (m_stop(u, du, target)) return u;
+
+        for (uint32_t e = firstOut[u]; e < firstOut[u + 1]; e++) {
+            const Weight w = m_metric(e, du);
+            if (w == std::numeric_limits<Weight>::infinity()) continue; // closed
+            uint32_t v = head[e];
+            Weight dv = du + w;
+
+            if (m_stamp[v] != m_round || dv < m_dist[v]) {
+                m_stamp[v] = m_round;
+                m_dist[v] = dv;
+                m_parent[v] = u;
+                m_parentEdge[v] = e;
+                m_queue.push(v, static_cast<Weight>(dv + m_heuristic(v)));
+            }
+        }
+    }
+
+    return INVALID_NODE;
+}
+
+template class Search<DistanceMetric, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+template class Search<DistanceMetric, WeightedHeuristic<EquirectangularHeuristic>, QuaternaryHeap<double>, StopAtTarget>;
+template class Search<MaskedMetric<DistanceMetric>, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+template class Search<DistanceMetric, ZeroHeuristic, BinaryHeap<double>, SettleAll>;
+template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopBeyond>;
+template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtAllTargets>;
+template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtNearestTargets>;
+template class Search<TravelTimeMetric, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+template class Search<TravelTimeMetric, WeightedHeuristic<TravelTimeHeuristic>, QuaternaryHeap<float>, StopAtTarget>;
+template class Search<MaskedMetric<TravelTimeMetric>, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+template class Search<TravelTimeMetric, ZeroHeuristic, BinaryHeap<float>, SettleAll>;
+template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtAllTargets>;
+template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtNearestTargets>;
+template class Search<TimeDependentMetric, TravelTimeHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+template class Search<TimeDependentMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
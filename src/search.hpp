@@ -0,0 +1,403 @@
+#ifndef SEARCH
+#define SEARCH
+
+// Best-first search over the RoadGraph, specialised at compile time.
+// Metric, heuristic, priority queue and stopping rule are template policies,
+// so every supported combination gets its own inlined relaxation loop with
+// no runtime branching on the variant.
+
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "road_graph.hpp"
+#include "edge_costs.hpp"
+#include "speed_profiles.hpp"
+#include "edge_mask.hpp"
+
+// ---- Metric policies: edge cost and its type ----
+// use() points the metric at one set of edge costs.
+// The cost of edge e is asked for with the cost already spent reaching it.
+
+struct DistanceMetric {
+    using value_type = double;
+    const double* cost = nullptr;
+    void use(const EdgeCosts& costs) { cost = costs.weight.data(); }
+    value_type operator()(uint32_t e, value_type) const { return cost[e]; }
+};
+
+struct TravelTimeMetric {
+    using value_type = float;
+    const float* cost = nullptr;
+    void use(const EdgeCosts& costs) { cost = costs.duration.data(); }
+    value_type operator()(uint32_t e, value_type) const { return cost[e]; }
+};
+
+// Historical travel time at the moment the edge is entered. Distances are
+// clock times: seed the search with the departure time and the distance of
+// a node is the arrival there. Dijkstra stays exact because leaving later
+// never means arriving earlier; SpeedProfiles::travelTime enforces that.
+struct TimeDependentMetric {
+    using value_type = double;
+    const float* base = nullptr;
+    const SpeedProfiles* profiles = nullptr;
+    void use(const EdgeCosts& costs) {
+        base = costs.duration.data();
+        profiles = &getSpeedProfiles();
+    }
+    value_type operator()(uint32_t e, value_type at) const { return profiles->travelTime(e, base[e], at); }
+};
+
+// Any of the above with the edges of a mask closed (avoid areas, road
+// classes). A separate instantiation, so unrestricted searches never test
+// a bit; set mask before running.
+template <typename Base>
+struct MaskedMetric : Base {
+    using value_type = typename Base::value_type;
+    const EdgeMask* mask = nullptr;
+    value_type operator()(uint32_t e, value_type at) const {
+        return mask->blocked(e) ? std::numeric_limits<value_type>::infinity() : Base::operator()(e, at);
+    }
+};
+
+// ---- Heuristic policies: lower bound of the remaining cost to the target ----
+
+// Plain Dijkstra
+struct ZeroHeuristic {
+    void setTarget(const RoadGraph&, uint32_t) {}
+    double operator()(uint32_t) const { return 0.0; }
+};
+
+// Straight-line distance to the target on an equirectangular projection.
+// The goal is projected once per query; per node it costs two multiplies
+// and a sqrt on the int32 coordinates instead of haversine's trig calls.
+// The graph's projection scales never overestimate great-circle distance,
+// so the bound stays admissible (and consistent, being a planar metric).
+struct EquirectangularHeuristic {
+    int32_t goalLat = 0, goalLon = 0;
+    double latScale = 0.0, lonScale = 0.0; // meters per fixed-point unit, times the cost scale
+    const Node* coords = nullptr;
+
+    void setTarget(const RoadGraph& graph, uint32_t target) {
+        coords = graph.coords.data();
+        goalLat = graph.coords[target].lat;
+        goalLon = graph.coords[target].lon;
+        latScale = graph.metersPerLatUnit;
+        lonScale = graph.metersPerLonUnit;
+    }
+
+    double operator()(uint32_t v) const {
+        double dy = static_cast<double>(coords[v].lat - goalLat) * latScale;
+        double dx = static_cast<double>(coords[v].lon - goalLon) * lonScale;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+};
+
+// Same bound divided by the fastest speed in the graph, for travel time
+struct TravelTimeHeuristic : EquirectangularHeuristic {
+    void setTarget(const RoadGraph& graph, uint32_t target) {
+        EquirectangularHeuristic::setTarget(graph, target);
+        double inv = graph.maxSpeed > 0.0 ? 1.0 / graph.maxSpeed : 0.0;
+        latScale *= inv;
+        lonScale *= inv;
+    }
+};
+
+// Any of the above inflated by epsilon >= 1 (weighted A*). The bound is no
+// longer admissible, so the search settles far fewer nodes, but since every
+// node is still settled once the path found costs at most epsilon times the
+// optimum when the base bound is consistent.
+template <typename Base>
+struct WeightedHeuristic : Base {
+    double epsilon = 1.0;
+    double operator()(uint32_t v) const { return epsilon * Base::operator()(v); }
+};
+
+// ---- Queue policies ----
+
+// std::priority_queue with lazy deletion: duplicates are skipped when popped
+template <typename Key>
+class BinaryHeap {
+    using Entry = std::pair<Key, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_heap;
+
+public:
+    void resize(size_t) {}
+    void clear() { m_heap = {}; }
+    bool empty() const { return m_heap.empty(); }
+    void push(uint32_t v, Key key) { m_heap.push({key, v}); }
+    uint32_t pop() {
+        uint32_t v = m_heap.top().second;
+        m_heap.pop();
+        return v;
+    }
+};
+
+// Addressable 4-ary heap with decrease-key; each node is in the heap at most once
+template <typename Key>
+class QuaternaryHeap {
+    struct Entry {
+        Key key;
+        uint32_t node;
+    };
+    std::vector<Entry> m_heap;
+    std::vector<uint32_t> m_pos; // node -> heap slot, INVALID_NODE if absent
+
+    void moveUp(size_t i) {
+        Entry e = m_heap[i];
+        while (i > 0) {
+            size_t p = (i - 1) / 4;
+            if (!(e.key < m_heap[p].key)) break;
+            m_heap[i] = m_heap[p];
+            m_pos[m_heap[i].node] = static_cast<uint32_t>(i);
+            i = p;
+        }
+        m_heap[i] = e;
+        m_pos[e.node] = static_cast<uint32_t>(i);
+    }
+
+    void moveDown(size_t i) {
+        Entry e = m_heap[i];
+        const size_t n = m_heap.size();
+        for (;;) {
+            size_t c = 4 * i + 1;
+            if (c >= n) break;
+            size_t best = c;
+            size_t end = std::min(c + 4, n);
+            for (size_t k = c + 1; k < end; ++k) {
+                if (m_heap[k].key < m_heap[best].key) best = k;
+            }
+            if (!(m_heap[best].key < e.key)) break;
+            m_heap[i] = m_heap[best];
+            m_pos[m_heap[i].node] = static_cast<uint32_t>(i);
+            i = best;
+        }
+        m_heap[i] = e;
+        m_pos[e.node] = static_cast<uint32_t>(i);
+    }
+
+public:
+    void resize(size_t n) { m_pos.assign(n, INVALID_NODE); }
+    void clear() {
+        for (const auto& e : m_heap) m_pos[e.node] = INVALID_NODE;
+        m_heap.clear();
+    }
+    bool empty() const { return m_heap.empty(); }
+
+    // Insert v, or lower its key if it is already queued
+    void push(uint32_t v, Key key) {
+        uint32_t slot = m_pos[v];
+        if (slot == INVALID_NODE) {
+            m_heap.push_back({key, v});
+            moveUp(m_heap.size() - 1);
+        } else if (key < m_heap[slot].key) {
+            m_heap[slot].key = key;
+            moveUp(slot);
+        }
+    }
+
+    uint32_t pop() {
+        uint32_t v = m_heap.front().node;
+        m_pos[v] = INVALID_NODE;
+        m_heap.front() = m_heap.back();
+        m_heap.pop_back();
+        if (!m_heap.empty()) moveDown(0);
+        return v;
+    }
+};
+
+// ---- Stopping policies: called once per settled node, return true to stop ----
+
+struct StopAtTarget {
+    template <typename Weight>
+    bool operator()(uint32_t settled, Weight, uint32_t target) const { return settled == target; }
+};
+
+// Build the full shortest path tree
+struct SettleAll {
+    template <typename Weight>
+    bool operator()(uint32_t, Weight, uint32_t) const { return false; }
+};
+
+// Settle everything up to limit. Once it fires, every node whose distance
+// reads <= limit is final; anything else is farther than limit.
+struct StopBeyond {
+    double limit = 0.0;
+    template <typename Weight>
+    bool operator()(uint32_t, Weight d, uint32_t) const { return d > limit; }
+};
+
+// Stop once every target has been settled (one-to-many). setTargets arms the
+// policy and has to be called again before each run.
+struct StopAtAllTargets {
+    std::vector<uint32_t> mark; // node -> generation in which it is a target
+    uint32_t generation = 0;
+    size_t remaining = 0;
+
+    void setTargets(size_t nodeCount, const std::vector<uint32_t>& targets) {
+        if (mark.size() != nodeCount) {
+            mark.assign(nodeCount, 0);
+            generation = 0;
+        }
+        if (++generation == 0) {
+            std::fill(mark.begin(), mark.end(), 0);
+            generation = 1;
+        }
+        remaining = 0;
+        for (uint32_t t : targets) {
+            if (mark[t] != generation) {
+                mark[t] = generation;
+                remaining++;
+            }
+        }
+    }
+
+    template <typename Weight>
+    bool operator()(uint32_t settled, Weight, uint32_t) {
+        return mark[settled] == generation && --remaining == 0;
+    }
+};
+
+// Stop once the nearest `wanted` targets have been settled (K nearest).
+// A node may hold several targets and each counts; settledTargets lists the
+// target nodes in the order they were settled. setTargets arms the policy
+// and has to be called again before each run.
+struct StopAtNearestTargets {
+    std::vector<uint32_t> mark;  // node -> generation in which it holds targets
+    std::vector<uint32_t> count; // node -> targets it holds, valid where marked
+    uint32_t generation = 0;
+    size_t wanted = 0, found = 0;
+    std::vector<uint32_t> settledTargets;
+
+    void setTargets(size_t nodeCount, const std::vector<uint32_t>& targets, size_t k) {
+        if (mark.size() != nodeCount) {
+            mark.assign(nodeCount, 0);
+            count.assign(nodeCount, 0);
+            generation = 0;
+        }
+        if (++generation == 0) {
+            std::fill(mark.begin(), mark.end(), 0);
+            generation = 1;
+        }
+        for (uint32_t t : targets) {
+            if (mark[t] != generation) {
+                mark[t] = generation;
+                count[t] = 0;
+            }
+            count[t]++;
+        }
+        wanted = k;
+        found = 0;
+        settledTargets.clear();
+    }
+
+    template <typename Weight>
+    bool operator()(uint32_t settled, Weight, uint32_t) {
+        if (mark[settled] != generation) return false;
+        settledTargets.push_back(settled);
+        found += count[settled];
+        return found >= wanted;
+    }
+};
+
+// ---- The search ----
+
+template <typename Metric, typename Heuristic, typename Queue, typename Stop>
+class Search {
+public:
+    using Weight = typename Metric::value_type;
+
+    explicit Search(const RoadGraph& g);
+
+    // Search from source towards target (INVALID_NODE for none).
+    // Returns the node on which the stopping policy fired, INVALID_NODE if the queue ran dry.
+    uint32_t run(uint32_t source, uint32_t target);
+    // Same, starting from several nodes at the given initial costs
+    uint32_t run(const std::vector<std::pair<uint32_t, Weight>>& sources, uint32_t target);
+
+    bool reached(uint32_t v) const { return m_stamp[v] == m_round; }
+    Weight distance(uint32_t v) const;
+    uint32_t parent(uint32_t v) const { return reached(v) ? m_parent[v] : INVALID_NODE; }
+    // Edge the search used to reach v (INVALID_EDGE for the source)
+    uint32_t parentEdge(uint32_t v) const { return reached(v) ? m_parentEdge[v] : INVALID_EDGE; }
+
+    // Node sequence source .. v; empty if v was not reached
+    std::vector<uint32_t> path(uint32_t v) const;
+    // Edge sequence source .. v; empty if v was not reached or is the source
+    std::vector<uint32_t> edgePath(uint32_t v) const;
+
+    // Edge costs for the following runs: a live snapshot, held until replaced,
+    // or nullptr for the car's free-flow costs. Closed (infinite) edges are skipped.
+    void useCosts(EdgeCostsPtr costs);
+
+    size_t settledCount() const { return m_settledCount; }
+    Metric& metric() { return m_metric; }
+    Heuristic& heuristic() { return m_heuristic; }
+    Stop& stopPolicy() { return m_stop; }
+
+private:
+    const RoadGraph& m_graph;
+    Metric m_metric;
+    Heuristic m_heuristic;
+    Stop m_stop;
+    Queue m_queue;
+    EdgeCostsPtr m_costs;
+
+    // Per-node state is valid only where m_stamp == m_round, so starting a
+    // new search never has to clear the arrays
+    std::vector<Weight> m_dist;
+    std::vector<uint32_t> m_parent;
+    std::vector<uint32_t> m_parentEdge;
+    std::vector<uint32_t> m_stamp;
+    std::vector<uint32_t> m_settled;
+    uint32_t m_round = 0;
+    size_t m_settledCount = 0;
+
+    void beginRound(uint32_t target);
+    void seed(uint32_t v, Weight d);
+    uint32_t loop(uint32_t target);
+};
+
+// Supported combinations, instantiated in search.cpp
+using DistanceAStar = Search<DistanceMetric, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+using WeightedDistanceAStar = Search<DistanceMetric, WeightedHeuristic<EquirectangularHeuristic>, QuaternaryHeap<double>, StopAtTarget>;
+using MaskedDistanceAStar = Search<MaskedMetric<DistanceMetric>, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+using DistanceDijkstra = Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+using DistanceTree = Search<DistanceMetric, ZeroHeuristic, BinaryHeap<double>, SettleAll>;
+using DistanceBounded = Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopBeyond>;
+using DistanceOneToMany = Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtAllTargets>;
+using DistanceNearestTargets = Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtNearestTargets>;
+using TravelTimeAStar = Search<TravelTimeMetric, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+using MaskedTravelTimeAStar = Search<MaskedMetric<TravelTimeMetric>, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+using WeightedTravelTimeAStar = Search<TravelTimeMetric, WeightedHeuristic<TravelTimeHeuristic>, QuaternaryHeap<float>, StopAtTarget>;
+using TravelTimeDijkstra = Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+using TravelTimeTree = Search<TravelTimeMetric, ZeroHeuristic, BinaryHeap<float>, SettleAll>;
+using TravelTimeOneToMany = Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtAllTargets>;
+using TravelTimeNearestTargets = Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtNearestTargets>;
+using TimeDependentAStar = Search<TimeDependentMetric, TravelTimeHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+using TimeDependentDijkstra = Search<TimeDependentMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+
+extern template class Search<DistanceMetric, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+extern template class Search<DistanceMetric, WeightedHeuristic<EquirectangularHeuristic>, QuaternaryHeap<double>, StopAtTarget>;
+extern template class Search<MaskedMetric<DistanceMetric>, EquirectangularHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+extern template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+extern template class Search<DistanceMetric, ZeroHeuristic, BinaryHeap<double>, SettleAll>;
+extern template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopBeyond>;
+extern template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtAllTargets>;
+extern template class Search<DistanceMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtNearestTargets>;
+extern template class Search<TravelTimeMetric, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+extern template class Search<TravelTimeMetric, WeightedHeuristic<TravelTimeHeuristic>, QuaternaryHeap<float>, StopAtTarget>;
+extern template class Search<MaskedMetric<TravelTimeMetric>, TravelTimeHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+extern template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtTarget>;
+extern template class Search<TravelTimeMetric, ZeroHeuristic, BinaryHeap<float>, SettleAll>;
+extern template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtAllTargets>;
+extern template class Search<TravelTimeMetric, ZeroHeuristic, QuaternaryHeap<float>, StopAtNearestTargets>;
+extern template class Search<TimeDependentMetric, TravelTimeHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+extern template class Search<TimeDependentMetric, ZeroHeuristic, QuaternaryHeap<double>, StopAtTarget>;
+
+#endif
@@ -0,0 +1,216 @@
+#include "segment_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <memory>
+
+constexpr double PI_CONST = 3.14159265358979323846;
+constexpr double METERS_PER_DEGREE = 6371000.0 * PI_CONST / 180.0;
+
+SegmentIndex::SegmentIndex(const RoadGraph& g, double cellSizeMeters)
+    : m_graph(g)
+{
+    // Segments from way geometry, with the running offset along each way
+    for (uint32_t w = 0; w < g.ways.size(); ++w) {
+        const WayInfo& way = g.ways[w];
+        float offset = 0.0f;
+        for (uint32_t k = 0; k + 1 < way.nodeCount; ++k) {
+            uint32_t u = g.wayNodes[way.firstNode + k];
+            uint32_t v = g.wayNodes[way.firstNode + k + 1];
+            if (u == v) continue;
+            const Node& a = g.coords[u];
+            const Node& b = g.coords[v];
+            float len = static_cast<float>(haversine(a.latDeg(), a.lonDeg(), b.latDeg(), b.lonDeg()));
+            m_segments.push_back({u, v, w, offset, len});
+            offset += len;
+        }
+    }
+    if (g.nodeCount() == 0) {
+        m_cellStart.assign(1, 0);
+        return;
+    }
+
+    int32_t maxLat = std::numeric_limits<int32_t>::lowest();
+    int32_t maxLon = std::numeric_limits<int32_t>::lowest();
+    m_minLat = m_minLon = std::numeric_limits<int32_t>::max();
+    for (const Node& p : g.coords) {
+        m_minLat = std::min(m_minLat, p.lat);
+        m_minLon = std::min(m_minLon, p.lon);
+        maxLat = std::max(maxLat, p.lat);
+        maxLon = std::max(maxLon, p.lon);
+    }
+
+    // Cells are roughly square in meters; the reported cell size is the
+    // smallest side anywhere in the grid so ring distance bounds stay valid
+    double maxAbsLat = std::max(std::abs(m_minLat / COORDINATE_PRECISION), std::abs(maxLat / COORDINATE_PRECISION));
+    double midLat = (m_minLat / COORDINATE_PRECISION + maxLat / COORDINATE_PRECISION) / 2.0;
+    double cellDeg = cellSizeMeters / METERS_PER_DEGREE;
+    m_cellLat = std::max<int32_t>(1, static_cast<int32_t>(cellDeg * COORDINATE_PRECISION));
+    m_cellLon = std::max<int32_t>(1, static_cast<int32_t>(cellDeg / std::cos(midLat * PI_CONST / 180.0) * COORDINATE_PRECISION));
+    m_cellMeters = std::min(m_cellLat / COORDINATE_PRECISION * METERS_PER_DEGREE,
+                            m_cellLon / COORDINATE_PRECISION * METERS_PER_DEGREE * std::cos(maxAbsLat * PI_CONST / 180.0));
+    m_cols = static_cast<uint32_t>((int64_t(maxLon) - m_minLon) / m_cellLon + 1);
+    m_rows = static_cast<uint32_t>((int64_t(maxLat) - m_minLat) / m_cellLat + 1);
+
+    // Two passes: count the cells each segment touches, then fill
+    auto forCells = [&](const RoadSegment& s, auto&& fn) {
+        const Node& a = g.coords[s.u];
+        const Node& b = g.coords[s.v];
+        uint32_t c0 = static_cast<uint32_t>((int64_t(std::min(a.lon, b.lon)) - m_minLon) / m_cellLon);
+        uint32_t c1 = static_cast<uint32_t>((int64_t(std::max(a.lon, b.lon)) - m_minLon) / m_cellLon);
+        uint32_t r0 = static_cast<uint32_t>((int64_t(std::min(a.lat, b.lat)) - m_minLat) / m_cellLat);
+        uint32_t r1 = static_cast<uint32_t>((int64_t(std::max(a.lat, b.lat)) - m_minLat) / m_cellLat);
+        for (uint32_t r = r0; r <= r1; ++r)
+            for (uint32_t c = c0; c <= c1; ++c)
+                fn(r * m_cols + c);
+    };
+
+    m_cellStart.assign(size_t(m_cols) * m_rows + 1, 0);
+    for (const auto& s : m_segments) {
+        forCells(s, [&](size_t cell) { m_cellStart[cell + 1]++; });
+    }
+    for (size_t i = 1; i < m_cellStart.size(); ++i) m_cellStart[i] += m_cellStart[i - 1];
+
+    m_cellItems.resize(m_cellStart.back());
+    std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (uint32_t id = 0; id < m_segments.size(); ++id) {
+        forCells(m_segments[id], [&](size_t cell) { m_cellItems[fill[cell]++] = id; });
+    }
+}
+
+SegmentHit SegmentIndex::project(uint32_t id, double lat, double lon, double cosLat) const {
+    const RoadSegment& s = m_segments[id];
+    const Node& a = m_graph.coords[s.u];
+    const Node& b = m_graph.coords[s.v];
+
+    // Local planar frame in meters around the query point
+    double ax = (a.lonDeg() - lon) * cosLat * METERS_PER_DEGREE;
+    double ay = (a.latDeg() - lat) * METERS_PER_DEGREE;
+    double bx = (b.lonDeg() - lon) * cosLat * METERS_PER_DEGREE;
+    double by = (b.latDeg() - lat) * METERS_PER_DEGREE;
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx * dx + dy * dy;
+
+    double t = len2 > 0.0 ? -(ax * dx + ay * dy) / len2 : 0.0;
+    t = std::min(1.0, std::max(0.0, t));
+    double px = ax + t * dx, py = ay + t * dy;
+
+    SegmentHit hit;
+    hit.segment = id;
+    hit.distance = std::sqrt(px * px + py * py);
+    hit.fraction = t;
+    hit.lat = a.latDeg() + t * (b.latDeg() - a.latDeg());
+    hit.lon = a.lonDeg() + t * (b.lonDeg() - a.lonDeg());
+    return hit;
+}
+
+template <typename Fn>
+void SegmentIndex::forRing(int cx, int cy, int r, Fn&& fn) const {
+    const int cols = static_cast<int>(m_cols), rows = static_cast<int>(m_rows);
+    auto visit = [&](int c, int row) {
+        size_t cell = size_t(row) * m_cols + c;
+        for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) fn(m_cellItems[i]);
+    };
+    if (r == 0) {
+        if (cx >= 0 && cy >= 0 && cx < cols && cy < rows) visit(cx, cy);
+        return;
+    }
+
+    // Top and bottom rows of the ring, clipped to the grid
+    const int c0 = std::max(cx - r, 0), c1 = std::min(cx + r, cols - 1);
+    for (int row : {cy - r, cy + r}) {
+        if (row < 0 || row >= rows) continue;
+        for (int c = c0; c <= c1; ++c) visit(c, row);
+    }
+    // Left and right columns without the corners
+    const int r0 = std::max(cy - r + 1, 0), r1 = std::min(cy + r - 1, rows - 1);
+    for (int c : {cx - r, cx + r}) {
+        if (c < 0 || c >= cols) continue;
+        for (int row = r0; row <= r1; ++row) visit(c, row);
+    }
+}
+
+SegmentHit SegmentIndex::nearest(double lat, double lon, double maxDistance, bool namedOnly) const {
+    SegmentHit best;
+    best.distance = std::numeric_limits<double>::infinity();
+    if (m_segments.empty()) return SegmentHit{};
+
+    const double cosLat = std::cos(lat * PI_CONST / 180.0);
+    int cx = static_cast<int>(std::floor((lon * COORDINATE_PRECISION - m_minLon) / m_cellLon));
+    int cy = static_cast<int>(std::floor((lat * COORDINATE_PRECISION - m_minLat) / m_cellLat));
+    // Rings past the far side of the grid cannot hold anything
+    double ringLimit = std::ceil(maxDistance / m_cellMeters) + 1.0;
+    double gridLimit = double(m_cols) + m_rows + std::abs(cx) + std::abs(cy);
+    int maxRing = static_cast<int>(std::min(ringLimit, gridLimit));
+
+    for (int r = 0; r <= maxRing; ++r) {
+        forRing(cx, cy, r, [&](uint32_t id) {
+            if (namedOnly && m_graph.ways[m_segments[id].way].name == 0) return;
+            SegmentHit hit = project(id, lat, lon, cosLat);
+            if (hit.distance < best.distance) best = hit;
+        });
+        // Everything in ring r + 1 and beyond is at least r cells away
+        if (best.distance <= r * m_cellMeters) break;
+    }
+
+    if (best.distance > maxDistance) return SegmentHit{};
+    return best;
+}
+
+std::vector<SegmentHit> SegmentIndex::within(double lat, double lon, double radius) const {
+    std::vector<SegmentHit> hits;
+    if (m_segments.empty()) return hits;
+
+    const double cosLat = std::cos(lat * PI_CONST / 180.0);
+    int cx = static_cast<int>(std::floor((lon * COORDINATE_PRECISION - m_minLon) / m_cellLon));
+    int cy = static_cast<int>(std::floor((lat * COORDINATE_PRECISION - m_minLat) / m_cellLat));
+    int maxRing = static_cast<int>(std::ceil(radius / m_cellMeters)) + 1;
+
+    for (int r = 0; r <= maxRing; ++r) {
+        forRing(cx, cy, r, [&](uint32_t id) {
+            SegmentHit hit = project(id, lat, lon, cosLat);
+            if (hit.distance <= radius) hits.push_back(hit);
+        });
+    }
+
+    // A segment spanning several cells is found once per cell
+    std::sort(hits.begin(), hits.end(), [](const SegmentHit& a, const SegmentHit& b) {
+        return a.segment < b.segment;
+    });
+    hits.erase(std::unique(hits.begin(), hits.end(), [](const SegmentHit& a, const SegmentHit& b) {
+        return a.segment == b.segment;
+    }), hits.end());
+    std::sort(hits.begin(), hits.end(), [](const SegmentHit& a, const SegmentHit& b) {
+        return a.distance < b.distance;
+    });
+    return hits;
+}
+
+std::vector<uint32_t> SegmentIndex::inBox(double minLat, double minLon, double maxLat, double maxLon) const {
+    std::vector<uint32_t> ids;
+    if (m_segments.empty()) return ids;
+    auto clamp = [](double cell, uint32_t count) {
+        return std::min<int64_t>(count - 1, std::max<int64_t>(0, static_cast<int64_t>(std::floor(cell))));
+    };
+    auto column = [&](double lon) { return clamp((lon * COORDINATE_PRECISION - m_minLon) / m_cellLon, m_cols); };
+    auto row = [&](double lat) { return clamp((lat * COORDINATE_PRECISION - m_minLat) / m_cellLat, m_rows); };
+    for (int64_t r = row(minLat); r <= row(maxLat); ++r) {
+        for (int64_t c = column(minLon); c <= column(maxLon); ++c) {
+            size_t cell = size_t(r) * m_cols + size_t(c);
+            ids.insert(ids.end(), m_cellItems.begin() + m_cellStart[cell], m_cellItems.begin() + m_cellStart[cell + 1]);
+        }
+    }
+    // A segment spanning several cells is filed once per cell
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+const SegmentIndex& getSegmentIndex() {
+    static std::unique_ptr<SegmentIndex> index;
+    static std::once_flag built;
+    std::call_once(built, [] { index = std::make_unique<SegmentIndex>(getRoadGraph()); });
+    return *index;
+}
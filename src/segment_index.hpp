@@ -0,0 +1,66 @@
+#ifndef SEGMENT_INDEX
+#define SEGMENT_INDEX
+
+#include <vector>
+#include <cstdint>
+
+#include "road_graph.hpp"
+
+// One straight piece of way geometry
+struct RoadSegment {
+    uint32_t u, v;      // dense node ids, in way order
+    uint32_t way;       // index into RoadGraph::ways
+    float offset;       // meters from the start of the way to u
+    float length;       // meters
+};
+
+// Where a point projects onto a segment
+struct SegmentHit {
+    uint32_t segment = UINT32_MAX;
+    double distance = 0.0;  // meters from the query point
+    double fraction = 0.0;  // 0 at u, 1 at v
+    double lat = 0.0, lon = 0.0; // projected point
+};
+
+// Uniform grid over all way segments. Each segment is registered in every
+// cell its bounding box touches; nearest queries search rings of cells
+// outwards and stop once no farther ring can hold anything closer.
+class SegmentIndex {
+public:
+    explicit SegmentIndex(const RoadGraph& g, double cellSizeMeters = 100.0);
+
+    // Closest segment within maxDistance meters, optionally only on named ways.
+    // hit.segment stays UINT32_MAX if nothing qualifies.
+    SegmentHit nearest(double lat, double lon, double maxDistance, bool namedOnly = false) const;
+
+    // All segments within radius meters, closest first
+    std::vector<SegmentHit> within(double lat, double lon, double radius) const;
+
+    // Segments filed in the grid cells a lat/lon box overlaps, each once:
+    // every segment crossing the box and some close to it
+    std::vector<uint32_t> inBox(double minLat, double minLon, double maxLat, double maxLon) const;
+
+    const RoadSegment& segment(uint32_t id) const { return m_segments[id]; }
+    size_t size() const { return m_segments.size(); }
+
+private:
+    const RoadGraph& m_graph;
+    std::vector<RoadSegment> m_segments;
+
+    int32_t m_minLat = 0, m_minLon = 0;
+    int32_t m_cellLat = 1, m_cellLon = 1; // cell size in fixed-point units
+    uint32_t m_cols = 0, m_rows = 0;
+    double m_cellMeters = 0.0;            // smaller side of a cell
+    std::vector<uint32_t> m_cellStart;    // CSR over cells, size m_cols * m_rows + 1
+    std::vector<uint32_t> m_cellItems;
+
+    SegmentHit project(uint32_t id, double lat, double lon, double cosLat) const;
+
+    template <typename Fn>
+    void forRing(int cx, int cy, int r, Fn&& fn) const;
+};
+
+// Index over the loaded road graph, built on first use
+const SegmentIndex& getSegmentIndex();
+
+#endif
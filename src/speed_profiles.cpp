@@ -0,0 +1,110 @@
+#include "speed_profiles.hpp"
+
+#include <istream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <exception>
+#include <iterator>
+
+constexpr size_t MINUTES_PER_DAY = 1440;
+
+SpeedProfiles::SpeedProfiles(const RoadGraph& g)
+    : m_graph(g),
+      m_invMaxSpeed(g.maxSpeed > 0.0 ? 1.0 / g.maxSpeed : 0.0),
+      m_breakpoints{0},
+      m_values{static_cast<uint8_t>(SLOWDOWN_SCALE)},
+      m_wayProfile(g.ways.size(), 0),
+      m_segmentAt(MINUTES_PER_DAY, 0)
+{
+}
+
+// "HH:MM" to minutes after midnight, -1 if malformed
+static int parseClock(const std::string& text) {
+    int h = 0, m = 0;
+    char colon = 0;
+    std::istringstream ss(text);
+    if (!(ss >> h >> colon >> m) || colon != ':' || h < 0 || h > 24 || m < 0 || m > 59 || (h == 24 && m > 0)) return -1;
+    return (h * 60 + m) % static_cast<int>(MINUTES_PER_DAY);
+}
+
+size_t SpeedProfiles::load(std::istream& in) {
+    std::unordered_map<int64_t, uint32_t> wayIndex;
+    for (uint32_t w = 0; w < m_graph.ways.size(); ++w) wayIndex.emplace(m_graph.ways[w].osmId, w);
+
+    // Per way: minute -> slowdown, the last row for a minute wins
+    std::unordered_map<uint32_t, std::map<int, double>> points;
+    std::vector<bool> used(MINUTES_PER_DAY, false);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string id, clock, factor;
+        if (!std::getline(ss, id, ',') || !std::getline(ss, clock, ',') || !std::getline(ss, factor)) continue;
+        try {
+            auto it = wayIndex.find(std::stoll(id));
+            int minute = parseClock(clock);
+            double f = std::stod(factor);
+            if (it == wayIndex.end() || minute < 0 || !(f > 0.0)) continue;
+            points[it->second][minute] = 1.0 / f;
+            used[minute] = true;
+        } catch (const std::exception&) {
+            continue; // header or malformed
+        }
+    }
+
+    m_breakpoints.clear();
+    for (size_t m = 0; m < MINUTES_PER_DAY; ++m) {
+        if (used[m]) m_breakpoints.push_back(static_cast<uint32_t>(m * 60));
+    }
+    if (m_breakpoints.empty()) m_breakpoints.push_back(0);
+    const size_t count = m_breakpoints.size();
+
+    for (size_t m = 0, i = count - 1; m < MINUTES_PER_DAY; ++m) {
+        if (used[m]) i = std::lower_bound(m_breakpoints.begin(), m_breakpoints.end(), m * 60) - m_breakpoints.begin();
+        m_segmentAt[m] = static_cast<uint16_t>(i);
+    }
+
+    // Sample each way's points at the shared breakpoints and intern the result
+    std::map<std::vector<uint8_t>, uint32_t> interned;
+    std::vector<uint8_t> freeFlow(count, static_cast<uint8_t>(SLOWDOWN_SCALE));
+    interned.emplace(freeFlow, 0);
+    m_values = freeFlow;
+    std::fill(m_wayProfile.begin(), m_wayProfile.end(), 0);
+
+    std::vector<uint8_t> profile(count);
+    for (const auto& [way, own] : points) {
+        for (size_t b = 0; b < count; ++b) {
+            const int t = static_cast<int>(m_breakpoints[b] / 60);
+            auto next = own.lower_bound(t);
+            double s;
+            if (next != own.end() && next->first == t) {
+                s = next->second;
+            } else {
+                // Neighbouring points around t, wrapping over midnight
+                auto after = next != own.end() ? next : own.begin();
+                auto before = next != own.begin() ? std::prev(next) : std::prev(own.end());
+                int span = (after->first - before->first + int(MINUTES_PER_DAY)) % int(MINUTES_PER_DAY);
+                int into = (t - before->first + int(MINUTES_PER_DAY)) % int(MINUTES_PER_DAY);
+                s = span == 0 ? before->second
+                              : before->second + (after->second - before->second) * into / span;
+            }
+            long q = std::lround(s * SLOWDOWN_SCALE);
+            profile[b] = static_cast<uint8_t>(std::min(255L, std::max(1L, q)));
+        }
+        auto [it, added] = interned.emplace(profile, static_cast<uint32_t>(interned.size()));
+        if (added) m_values.insert(m_values.end(), profile.begin(), profile.end());
+        m_wayProfile[way] = it->second;
+    }
+    return points.size();
+}
+
+size_t SpeedProfiles::memoryBytes() const {
+    return m_breakpoints.size() * sizeof(uint32_t) + m_values.size() + m_wayProfile.size() * sizeof(uint32_t)
+         + m_segmentAt.size() * sizeof(uint16_t);
+}
+
+SpeedProfiles& getSpeedProfiles() {
+    static SpeedProfiles* profiles = new SpeedProfiles(getRoadGraph());
+    return *profiles;
+}
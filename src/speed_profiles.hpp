@@ -0,0 +1,86 @@
+#ifndef SPEED_PROFILES
+#define SPEED_PROFILES
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iosfwd>
+
+#include "road_graph.hpp"
+
+constexpr double SECONDS_PER_DAY = 86400.0;
+// Slowdowns are stored as value / SLOWDOWN_SCALE in one byte: 1/32 to ~8x
+constexpr double SLOWDOWN_SCALE = 32.0;
+
+// Historical travel times by time of day. A profile is a daily, cyclic,
+// piecewise-linear slowdown over free-flow travel time. All profiles share
+// one set of breakpoints and store one quantized byte per breakpoint;
+// identical profiles are stored once and ways refer to them by index.
+// Profile 0 is free flow everywhere and costs nothing per way.
+class SpeedProfiles {
+public:
+    explicit SpeedProfiles(const RoadGraph& g);
+
+    // Replace the profiles with "way_id,HH:MM,speed_factor" rows, the factor
+    // being the share of free-flow speed at that time of day (0.5 = half as
+    // fast). Times are rounded to the minute; a way's own points are
+    // interpolated cyclically onto the shared breakpoints. Returns the ways
+    // given a profile. Not safe while queries run; load before routing.
+    size_t load(std::istream& in);
+
+    // Travel time of edge e entered at clock time at (seconds; days repeat),
+    // given its time-independent base duration. Never faster than the
+    // network's top speed, so travel-time bounds stay admissible.
+    //
+    // FIFO is enforced: entering later never means leaving sooner. Where a
+    // slowdown eases faster than the clock runs, waiting at the edge's tail
+    // for a later breakpoint is allowed, so the arrival is the earliest over
+    // the breakpoints before it (usually none, edges taking seconds).
+    double travelTime(uint32_t e, double base, double at) const {
+        uint32_t p = m_wayProfile[m_graph.edgeWay[e]];
+        if (p == 0 || std::isinf(base)) return base;
+
+        double t = std::fmod(at, SECONDS_PER_DAY);
+        if (t < 0.0) t += SECONDS_PER_DAY;
+        const size_t count = m_breakpoints.size();
+        size_t i = m_segmentAt[static_cast<size_t>(t / 60.0)];
+        size_t j = i + 1 < count ? i + 1 : 0;
+        double t0 = m_breakpoints[i];
+        double t1 = j > i ? m_breakpoints[j] : m_breakpoints[j] + SECONDS_PER_DAY;
+        if (t < t0) t += SECONDS_PER_DAY; // before the first breakpoint: last segment, wrapped
+
+        const uint8_t* v = m_values.data() + size_t(p) * count;
+        double s = (v[i] + (double(v[j]) - v[i]) * (t - t0) / (t1 - t0)) / SLOWDOWN_SCALE;
+
+        // Arrival is linear between breakpoints, so its minimum over later
+        // starts is at one; starts past the arrival cannot beat it
+        double arrival = t + base * s;
+        for (size_t k = j; t1 < arrival;) {
+            arrival = std::min(arrival, t1 + base * v[k] / SLOWDOWN_SCALE);
+            size_t next = k + 1 < count ? k + 1 : 0;
+            t1 += next > k ? double(m_breakpoints[next]) - m_breakpoints[k]
+                           : double(m_breakpoints[next]) + SECONDS_PER_DAY - m_breakpoints[k];
+            k = next;
+        }
+        return std::max(arrival - t, m_graph.weight[e] * m_invMaxSpeed);
+    }
+
+    size_t profileCount() const { return m_breakpoints.empty() ? 1 : m_values.size() / m_breakpoints.size(); }
+    size_t breakpointCount() const { return m_breakpoints.size(); }
+    size_t memoryBytes() const;
+
+private:
+    const RoadGraph& m_graph;
+    double m_invMaxSpeed = 0.0;
+    std::vector<uint32_t> m_breakpoints; // seconds after midnight, ascending, shared by all profiles
+    std::vector<uint8_t> m_values;       // profile p: [p * breakpoints, (p + 1) * breakpoints)
+    std::vector<uint32_t> m_wayProfile;  // way index -> profile
+    std::vector<uint16_t> m_segmentAt;   // minute of day -> breakpoint starting its segment
+};
+
+// Profiles of the loaded road graph, free flow until loaded
+SpeedProfiles& getSpeedProfiles();
+
+#endif
@@ -0,0 +1,137 @@
+#include "travel_profiles.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+
+static const char* const PROFILE_NAMES[PROFILE_COUNT] = {"car", "motorbike", "bicycle", "foot"};
+
+const char* profileName(Profile profile) {
+    return PROFILE_NAMES[static_cast<size_t>(profile)];
+}
+
+bool parseProfile(const std::string& name, Profile& profile) {
+    for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+        if (name == PROFILE_NAMES[p]) {
+            profile = static_cast<Profile>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Free-flow speed (km/h) per highway class for car, motorbike, bicycle, foot;
+// 0 where the profile may not go unless the way's tags say otherwise
+struct ClassSpeeds {
+    double kmh[PROFILE_COUNT];
+};
+
+static const std::unordered_map<std::string, ClassSpeeds> CLASS_SPEEDS = {
+    {"motorway",       {{100, 100,  0, 0}}},
+    {"trunk",          {{ 80,  80, 18, 5}}},
+    {"primary",        {{ 60,  60, 18, 5}}},
+    {"secondary",      {{ 50,  50, 18, 5}}},
+    {"tertiary",       {{ 40,  40, 18, 5}}},
+    {"unclassified",   {{ 30,  30, 16, 5}}},
+    {"residential",    {{ 25,  25, 16, 5}}},
+    {"service",        {{ 15,  15, 14, 5}}},
+    {"living_street",  {{ 10,  10, 12, 5}}},
+    {"motorway_link",  {{ 60,  60,  0, 0}}},
+    {"primary_link",   {{ 45,  45, 18, 5}}},
+    {"secondary_link", {{ 40,  40, 18, 5}}},
+    {"tertiary_link",  {{ 30,  30, 18, 5}}},
+    {"track",          {{  0,  20, 12, 5}}},
+    {"path",           {{  0,   0, 12, 5}}},
+    {"cycleway",       {{  0,   0, 18, 5}}},
+    {"footway",        {{  0,   0,  0, 5}}},
+    {"pedestrian",     {{  0,   0,  0, 5}}},
+    {"corridor",       {{  0,   0,  0, 5}}},
+    {"bridleway",      {{  0,   0,  0, 5}}},
+    {"steps",          {{  0,   0,  0, 2}}}
+};
+
+// Speed (km/h) when a tag explicitly allows a profile on a class it does not
+// use by default; motor vehicles never leave their classes
+static const double GRANTED_KMH[PROFILE_COUNT] = {0, 0, 12, 5};
+
+// Access keys from most to least specific, per profile
+static const char* const ACCESS_KEYS[PROFILE_COUNT][5] = {
+    {"motorcar", "motor_vehicle", "vehicle", "access", nullptr},
+    {"motorcycle", "motor_vehicle", "vehicle", "access", nullptr},
+    {"bicycle", "vehicle", "access", nullptr, nullptr},
+    {"foot", "access", nullptr, nullptr, nullptr}
+};
+
+// maxspeed in km/h, accepting plain numbers and "<n> mph"; 0 if unusable
+static double parseMaxSpeed(const char* tag) {
+    if (!tag) return 0.0;
+    char* end = nullptr;
+    double v = std::strtod(tag, &end);
+    if (end == tag || v <= 0.0) return 0.0;
+    if (std::string(end).find("mph") != std::string::npos) v *= 1.609344;
+    return v;
+}
+
+static bool isYes(const char* v) {
+    if (!v) return false;
+    std::string s(v);
+    return s == "yes" || s == "true" || s == "1";
+}
+
+WayAccess evaluateWay(const std::function<const char*(const char*)>& tag) {
+    WayAccess result;
+    const char* highway = tag("highway");
+    if (!highway) return result; // not a highway/road-type way
+    auto cls = CLASS_SPEEDS.find(highway);
+    if (cls == CLASS_SPEEDS.end()) return result; // construction, proposed, platforms...
+
+    // determine one-way behavior for vehicles; walking ignores it
+    const char* junction = tag("junction");
+    const char* onewayTag = tag("oneway");
+    bool oneway = junction && std::string(junction) == "roundabout";
+    bool onewayReverse = false;
+    if (onewayTag) {
+        if (isYes(onewayTag)) oneway = true;
+        else if (std::string(onewayTag) == "-1") onewayReverse = true;
+    }
+    const char* bicycleOneway = tag("oneway:bicycle");
+    const bool bicycleTwoWay = bicycleOneway && std::string(bicycleOneway) == "no";
+
+    const double maxSpeed = parseMaxSpeed(tag("maxspeed"));
+
+    for (size_t p = 0; p < PROFILE_COUNT; ++p) {
+        double kmh = cls->second.kmh[p];
+
+        // The most specific access tag present decides
+        for (const char* const* key = ACCESS_KEYS[p]; *key; ++key) {
+            const char* v = tag(*key);
+            if (!v) continue;
+            std::string value(v);
+            if (value == "no") kmh = 0.0;
+            else if (kmh <= 0.0 && (value == "yes" || value == "designated" || value == "permissive"))
+                kmh = GRANTED_KMH[p];
+            break;
+        }
+        if (kmh <= 0.0) continue;
+
+        const Profile profile = static_cast<Profile>(p);
+        if (maxSpeed > 0.0) {
+            // Motor vehicles drive the limit; the limit only caps a bicycle
+            if (profile == Profile::Car || profile == Profile::Motorbike) kmh = maxSpeed;
+            else if (profile == Profile::Bicycle) kmh = std::min(kmh, maxSpeed);
+        }
+        result.speed[p] = static_cast<float>(kmh / 3.6);
+
+        const uint8_t bit = profileBit(profile);
+        const bool twoWay = profile == Profile::Foot || (profile == Profile::Bicycle && bicycleTwoWay);
+        if (twoWay || (!oneway && !onewayReverse)) {
+            result.forward |= bit;
+            result.backward |= bit;
+        } else if (onewayReverse) {
+            result.backward |= bit;
+        } else {
+            result.forward |= bit;
+        }
+    }
+    return result;
+}
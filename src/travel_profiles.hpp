@@ -0,0 +1,26 @@
+#ifndef TRAVEL_PROFILES
+#define TRAVEL_PROFILES
+
+#include <string>
+#include <functional>
+#include <cstdint>
+
+#include "road_graph.hpp"
+
+// "car", "motorbike", "bicycle", "foot"
+const char* profileName(Profile profile);
+
+// Inverse of profileName; false if name is not a profile
+bool parseProfile(const std::string& name, Profile& profile);
+
+// Who may use a way in which direction, and how fast
+struct WayAccess {
+    uint8_t forward = 0, backward = 0; // profileBit()s, forward = way node order
+    float speed[PROFILE_COUNT] = {};   // m/s, 0 for profiles without access
+};
+
+// Apply every profile's rules to one OSM way. tag returns the value of a key
+// or nullptr. A way no profile may use has both directions 0.
+WayAccess evaluateWay(const std::function<const char*(const char*)>& tag);
+
+#endif
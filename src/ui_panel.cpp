@@ -1,3 +1,5 @@
+#include <cstdio>
+
 #include "imgui.h"
 #include "ui_panel.hpp"
 
@@ -15,13 +17,27 @@ void UIPanel::ShowUIPanel()
     ImGui::RadioButton("Node IDs", &mode, 0);
     ImGui::SameLine();
     ImGui::RadioButton("Coordinates", &mode, 1);
+    ImGui::Text("Travel By:");
+    ImGui::RadioButton("Car", &m_profile, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Motorbike", &m_profile, 1);
+    ImGui::SameLine();
+    ImGui::RadioButton("Bicycle", &m_profile, 2);
+    ImGui::SameLine();
+    ImGui::RadioButton("Foot", &m_profile, 3);
     ImGui::Spacing();
 
     if (mode == 0) {
         ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.3f, 1.0f), "Node Search");
         ImGui::InputScalar("Start Node", ImGuiDataType_S64, &m_startNode, nullptr, nullptr, "%lld", ImGuiInputTextFlags_None);
         ImGui::InputScalar("End Node", ImGuiDataType_S64, &m_endNode, nullptr, nullptr, "%lld", ImGuiInputTextFlags_None);
+        ImGui::Checkbox("Anytime (refine in background)", &m_anytime);
         if (ImGui::Button("Run A* (Node IDs)")) m_runAStarWithNodes = true;
+        ImGui::SameLine();
+        if (ImGui::Button("Shortest vs Fastest")) m_runPareto = true;
+        for (size_t i = 0; i < m_paretoRoutes.size(); ++i) {
+            if (ImGui::RadioButton(m_paretoRoutes[i].c_str(), &m_paretoPick, static_cast<int>(i))) m_paretoPicked = true;
+        }
         ImGui::Spacing();
     }
 
@@ -42,14 +58,151 @@ void UIPanel::ShowUIPanel()
         ImGui::Spacing();
     }
 
+    ImGui::TextColored(ImVec4(0.8f, 0.5f, 0.9f, 1.0f), "Stops");
+    ImGui::TextWrapped("Right-click the map to add a stop between start and end.");
+    ImGui::TextWrapped("Drag the start or end marker to move it; the route follows.");
+    for (size_t i = 0; i < m_viaNodes.size(); ++i) {
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::SmallButton("Remove")) {
+            m_viaNodes.erase(m_viaNodes.begin() + i);
+            m_stopsChanged = true;
+            ImGui::PopID();
+            break;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu. Node %lld", i + 1, static_cast<long long>(m_viaNodes[i]));
+        ImGui::PopID();
+    }
+    ImGui::RadioButton("As given", &m_stopOrder, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Optimize", &m_stopOrder, 1);
+    ImGui::SameLine();
+    ImGui::RadioButton("Optimize, keep end", &m_stopOrder, 2);
+    if (ImGui::Button("Route Through Stops")) m_runMultiStop = true;
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Stops")) {
+        m_viaNodes.clear();
+        m_stopsChanged = true;
+    }
+    ImGui::InputInt("Vehicles", &m_vehicleCount);
+    if (m_vehicleCount < 1) m_vehicleCount = 1;
+    if (ImGui::Button("Split Across Vehicles")) m_runVehiclePlan = true;
+    ImGui::Spacing();
+
+    ImGui::TextColored(ImVec4(0.5f, 0.7f, 0.9f, 1.0f), "Avoid");
+    if (ImGui::Checkbox("Motorways", &m_avoidMotorways)) m_avoidChanged = true;
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Trunk roads", &m_avoidTrunks)) m_avoidChanged = true;
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Tolls", &m_avoidTolls)) m_avoidChanged = true;
+    if (!m_drawingArea) {
+        if (ImGui::Button("Draw Area")) {
+            m_drawingArea = true;
+            m_avoidAreas.emplace_back();
+        }
+    } else {
+        ImGui::TextWrapped("Click the map to add corners (%zu so far).", m_avoidAreas.back().size());
+        if (ImGui::Button("Finish Area")) {
+            m_drawingArea = false;
+            if (m_avoidAreas.back().size() < 3) m_avoidAreas.pop_back();
+            m_avoidChanged = true;
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Areas")) {
+        m_avoidAreas.clear();
+        m_drawingArea = false;
+        m_avoidChanged = true;
+    }
+    ImGui::Text("%zu areas avoided", m_avoidAreas.size() - (m_drawingArea ? 1 : 0));
+    ImGui::Spacing();
+
+    ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "Nearest Facility");
+    ImGui::RadioButton("Hospital", &m_facilityKind, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Fuel", &m_facilityKind, 1);
+    ImGui::SameLine();
+    ImGui::RadioButton("Police", &m_facilityKind, 2);
+    ImGui::RadioButton("Fire station", &m_facilityKind, 3);
+    ImGui::SameLine();
+    ImGui::RadioButton("Pharmacy", &m_facilityKind, 4);
+    if (ImGui::Button("Route To Nearest")) m_runNearestFacility = true;
+    ImGui::Spacing();
+
+    ImGui::TextColored(ImVec4(0.9f, 0.6f, 0.3f, 1.0f), "Street Search");
+    if (ImGui::InputText("Street", m_searchBuffer, sizeof(m_searchBuffer))) {
+        m_searchRequested = true;
+    }
+    if (m_searchRequested) {
+        m_searchRequested = false;
+        m_searchResults = m_nameIndex.search(m_searchBuffer, 10);
+    }
+    for (uint32_t id : m_searchResults) {
+        const PlaceEntry& place = m_nameIndex.entry(id);
+        ImGui::PushID(static_cast<int>(id));
+        if (ImGui::SmallButton("Start")) {
+            m_pickedPlace = static_cast<int>(id);
+            m_pickedAsStart = true;
+        }
+        ImGui::SameLine();
+        if (ImGui::SmallButton("End")) {
+            m_pickedPlace = static_cast<int>(id);
+            m_pickedAsStart = false;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%s (%s)", place.name.c_str(), place.type.c_str());
+        ImGui::PopID();
+    }
+
     ImGui::Spacing();
     ImGui::TextColored(ImVec4(0.0, 0.8, 0.05, 1.0), "Results: ");
     ImGui::Spacing();
 
     ImGui::Text("Distance: %.3f km", m_distance / 1000.0);
     ImGui::Text("Straight Line Distance: %.3f km", m_straightLineDistance / 1000.0);
+    if (m_routeBound > 1.0f) ImGui::Text("Within %.1f%% of the shortest", (m_routeBound - 1.0f) * 100.0f);
+
+    if (!m_instructions.empty()) {
+        ImGui::Spacing();
+        ImGui::TextColored(ImVec4(0.6f, 0.9f, 1.0f, 1.0f), "Directions");
+        ImGui::Separator();
+        ImGui::BeginChild("directions", ImVec2(0, 200), true);
+        for (size_t i = 0; i < m_instructions.size(); ++i) {
+            ImGui::TextWrapped("%zu. %s", i + 1, m_instructions[i].c_str());
+        }
+        ImGui::EndChild();
+    }
 
     
 
     ImGui::End();
-}
\ No newline at end of file
+}
+
+void UIPanel::setInstructions(const std::vector<Instruction>& instructions)
+{
+    m_instructions.clear();
+    for (const auto& ins : instructions) {
+        if (ins.distance <= 0.0f) {
+            m_instructions.push_back(ins.text);
+            continue;
+        }
+        char dist[32];
+        if (ins.distance >= 1000.0f) std::snprintf(dist, sizeof(dist), "%.1f km", ins.distance / 1000.0f);
+        else std::snprintf(dist, sizeof(dist), "%.0f m", ins.distance);
+        m_instructions.push_back(ins.text + " (" + dist + ")");
+    }
+}
+
+RouteRestrictions UIPanel::restrictions() const
+{
+    RouteRestrictions r;
+    if (m_avoidMotorways) r.roadClasses |= roadClassBit(RoadClass::Motorway) | roadClassBit(RoadClass::MotorwayLink);
+    if (m_avoidTrunks) r.roadClasses |= roadClassBit(RoadClass::Trunk);
+    r.tolls = m_avoidTolls;
+    for (size_t i = 0; i < m_avoidAreas.size(); ++i) {
+        // The area being drawn counts once it is finished
+        if (m_drawingArea && i + 1 == m_avoidAreas.size()) break;
+        r.areas.push_back(m_avoidAreas[i]);
+    }
+    return r;
+}
@@ -3,12 +3,20 @@
 
 #include <imgui.h>
 #include <cstdint>
+#include <vector>
+#include <string>
+
+#include "instructions.hpp"
+#include "name_index.hpp"
+#include "edge_mask.hpp"
 
 struct UIPanel {
 
     int64_t m_startNode = 0, m_endNode = 0;
     bool m_runAStarWithNodes = false;
     bool m_runAStarWithCoords = false;
+    int m_profile = 0; // Profile: 0 car, 1 motorbike, 2 bicycle, 3 foot
+    bool m_anytime = false; // node routes: quick first answer, refined in the background
 
     float m_startLat = 24.8600f, m_startLon = 67.0100f;
     float m_endLat = 24.8700f, m_endLon = 67.0200f;
@@ -16,7 +24,51 @@ struct UIPanel {
     char m_searchBuffer[128] = "";
     bool m_searchRequested = false;
 
+    // Street name search: results of the current query, and the entry the
+    // user picked as start or end (-1 until Windower consumes it)
+    NameIndex m_nameIndex;
+    std::vector<uint32_t> m_searchResults;
+    int m_pickedPlace = -1;
+    bool m_pickedAsStart = true;
+
+    // Via stops between start and end, added by right-clicking the map;
+    // m_stopsChanged tells Windower to redraw the markers
+    std::vector<int64_t> m_viaNodes;
+    bool m_stopsChanged = false;
+    int m_stopOrder = 0; // StopOrder: 0 as given, 1 optimize, 2 optimize keeping the end
+    bool m_runMultiStop = false;
+
+    // Split the stops across vehicles leaving from the start node
+    int m_vehicleCount = 3;
+    bool m_runVehiclePlan = false;
+
+    // Route from the start node to the closest facility of this FacilityKind
+    int m_facilityKind = 0;
+    bool m_runNearestFacility = false;
+
+    // Distance / time trade-off between start and end: one line per route
+    // of the frontier, shortest first; picking one shows it
+    bool m_runPareto = false;
+    std::vector<std::string> m_paretoRoutes;
+    int m_paretoPick = 0;
+    bool m_paretoPicked = false;
+
+    // What routes keep off. While drawing, left clicks add corners to the
+    // last area; m_avoidChanged tells Windower to rebuild its edge mask.
+    bool m_avoidMotorways = false, m_avoidTrunks = false, m_avoidTolls = false;
+    std::vector<AvoidArea> m_avoidAreas;
+    bool m_drawingArea = false;
+    bool m_avoidChanged = false;
+
+    RouteRestrictions restrictions() const;
+
     float m_distance = 0, m_straightLineDistance = 0;
+    float m_routeBound = 1.0f; // shown route costs at most this factor above the optimum
+
+    // Turn-by-turn directions of the last route, one line per step
+    std::vector<std::string> m_instructions;
+
+    void setInstructions(const std::vector<Instruction>& instructions);
 
 
     void ShowUIPanel();
@@ -0,0 +1,493 @@
+#include "vrp.hpp"
+#include "cost_matrix.hpp"
+#include "multi_stop.hpp"
+#include "road_graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+
+constexpr double UNREACHABLE = 1e9; // seconds; legs this long are never driven
+constexpr double MIN_GAIN = 1e-6;
+constexpr size_t NEIGHBOURS = 30;
+constexpr int MAX_ROUNDS = 50;
+constexpr uint32_t NO_GROUP = UINT32_MAX;
+
+// Matrix index 0 is the depot, stop i is index i + 1
+struct VrpInstance {
+    size_t size = 0;
+    std::vector<double> time;
+    std::vector<double> demand, ready, due, service;
+    double capacity = 0.0;
+    std::vector<std::vector<uint32_t>> neighbours; // closest other stops, by matrix index
+
+    double t(uint32_t a, uint32_t b) const { return time[a * size + b]; }
+};
+
+struct RouteState {
+    std::vector<uint32_t> seq;  // matrix indices, the depot is implied at both ends
+    std::vector<double> start;  // earliest service start per position
+    std::vector<double> latest; // latest service start that keeps the rest of the route on time
+    double load = 0.0;
+    double cost = 0.0;          // driving time
+};
+
+struct VrpState {
+    const VrpInstance& inst;
+    std::vector<RouteState> routes;
+    std::vector<uint32_t> routeOf, posOf; // by matrix index
+    std::vector<uint32_t> groupOfStop;    // fixed for the duration of a round
+};
+
+// Driving time of seq if it meets capacity and every time window
+static bool evaluate(const VrpInstance& inst, const std::vector<uint32_t>& seq, double& cost) {
+    double time = inst.ready[0], travel = 0.0, load = 0.0;
+    uint32_t prev = 0;
+    for (uint32_t u : seq) {
+        double leg = inst.t(prev, u);
+        if (leg >= UNREACHABLE) return false;
+        travel += leg;
+        time = std::max(time + inst.service[prev] + leg, inst.ready[u]);
+        if (time > inst.due[u]) return false;
+        load += inst.demand[u];
+        prev = u;
+    }
+    double leg = inst.t(prev, 0);
+    if (leg >= UNREACHABLE || time + inst.service[prev] + leg > inst.due[0]) return false;
+    if (load > inst.capacity) return false;
+    cost = travel + leg;
+    return true;
+}
+
+// Recompute schedule, slack and totals of route r and re-index its stops
+static void place(VrpState& s, uint32_t r) {
+    const VrpInstance& inst = s.inst;
+    RouteState& route = s.routes[r];
+    const size_t n = route.seq.size();
+    route.start.resize(n);
+    route.latest.resize(n);
+    route.load = route.cost = 0.0;
+
+    double time = inst.ready[0];
+    uint32_t prev = 0;
+    for (size_t k = 0; k < n; ++k) {
+        uint32_t u = route.seq[k];
+        double leg = inst.t(prev, u);
+        route.cost += leg;
+        time = std::max(time + inst.service[prev] + leg, inst.ready[u]);
+        route.start[k] = time;
+        route.load += inst.demand[u];
+        s.routeOf[u] = r;
+        s.posOf[u] = static_cast<uint32_t>(k);
+        prev = u;
+    }
+    route.cost += inst.t(prev, 0);
+
+    double next = inst.due[0];
+    uint32_t after = 0;
+    for (size_t k = n; k-- > 0;) {
+        uint32_t u = route.seq[k];
+        route.latest[k] = std::min(inst.due[u], next - inst.service[u] - inst.t(u, after));
+        next = route.latest[k];
+        after = u;
+    }
+}
+
+// Can u go in front of position pos of route without breaking a time window? O(1)
+static bool canInsert(const VrpInstance& inst, const RouteState& route, size_t pos, uint32_t u) {
+    const size_t n = route.seq.size();
+    uint32_t prev = pos == 0 ? 0 : route.seq[pos - 1];
+    uint32_t next = pos < n ? route.seq[pos] : 0;
+    double legIn = inst.t(prev, u), legOut = inst.t(u, next);
+    if (legIn >= UNREACHABLE || legOut >= UNREACHABLE) return false;
+
+    double depart = pos == 0 ? inst.ready[0] : route.start[pos - 1] + inst.service[prev];
+    double su = std::max(depart + legIn, inst.ready[u]);
+    if (su > inst.due[u]) return false;
+    double limit = pos < n ? route.latest[pos] : inst.due[0];
+    return su + inst.service[u] + legOut <= limit;
+}
+
+static double insertDelta(const VrpInstance& inst, const RouteState& route, size_t pos, uint32_t u) {
+    uint32_t prev = pos == 0 ? 0 : route.seq[pos - 1];
+    uint32_t next = pos < route.seq.size() ? route.seq[pos] : 0;
+    return inst.t(prev, u) + inst.t(u, next) - inst.t(prev, next);
+}
+
+// Cheapest feasible insertion of u over all routes; false if there is none
+static bool insertCheapest(VrpState& s, uint32_t u) {
+    const VrpInstance& inst = s.inst;
+    double best = std::numeric_limits<double>::infinity();
+    uint32_t bestRoute = 0;
+    size_t bestPos = 0;
+    for (uint32_t r = 0; r < s.routes.size(); ++r) {
+        const RouteState& route = s.routes[r];
+        if (route.load + inst.demand[u] > inst.capacity) continue;
+        for (size_t pos = 0; pos <= route.seq.size(); ++pos) {
+            double delta = insertDelta(inst, route, pos, u);
+            if (delta < best && canInsert(inst, route, pos, u)) {
+                best = delta;
+                bestRoute = r;
+                bestPos = pos;
+            }
+        }
+    }
+    if (best == std::numeric_limits<double>::infinity()) return false;
+    auto& seq = s.routes[bestRoute].seq;
+    seq.insert(seq.begin() + bestPos, u);
+    place(s, bestRoute);
+    return true;
+}
+
+// Reverse a stretch of the route; first improving move wins
+static bool twoOpt(VrpState& s, uint32_t r) {
+    const VrpInstance& inst = s.inst;
+    RouteState& route = s.routes[r];
+    std::vector<uint32_t> full(route.seq.size() + 2, 0);
+    std::copy(route.seq.begin(), route.seq.end(), full.begin() + 1);
+    const size_t n = route.seq.size();
+
+    for (size_t i = 1; i < n; ++i) {
+        double forward = 0.0, backward = 0.0;
+        for (size_t j = i + 1; j <= n; ++j) {
+            forward += inst.t(full[j - 1], full[j]);
+            backward += inst.t(full[j], full[j - 1]);
+            double delta = inst.t(full[i - 1], full[j]) + backward + inst.t(full[i], full[j + 1])
+                         - inst.t(full[i - 1], full[i]) - forward - inst.t(full[j], full[j + 1]);
+            if (delta >= -MIN_GAIN) continue;
+
+            std::vector<uint32_t> cand = route.seq;
+            std::reverse(cand.begin() + (i - 1), cand.begin() + j);
+            double cost;
+            if (evaluate(inst, cand, cost) && cost < route.cost - MIN_GAIN) {
+                route.seq = std::move(cand);
+                place(s, r);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Move u next to one of its neighbours, in its own or another route
+static bool relocate(VrpState& s, uint32_t u, uint32_t group) {
+    const VrpInstance& inst = s.inst;
+    const uint32_t r1 = s.routeOf[u];
+    const size_t p1 = s.posOf[u];
+    RouteState& from = s.routes[r1];
+    uint32_t prev1 = p1 == 0 ? 0 : from.seq[p1 - 1];
+    uint32_t next1 = p1 + 1 < from.seq.size() ? from.seq[p1 + 1] : 0;
+    double gain = inst.t(prev1, u) + inst.t(u, next1) - inst.t(prev1, next1);
+
+    std::vector<uint32_t> without = from.seq;
+    without.erase(without.begin() + p1);
+
+    for (uint32_t v : inst.neighbours[u]) {
+        if (s.groupOfStop[v] != group) continue;
+        const uint32_t r2 = s.routeOf[v];
+        const size_t p2 = s.posOf[v];
+
+        for (size_t pos : {p2, p2 + 1}) { // in front of v, after v
+            double cost1;
+            if (r2 == r1) {
+                if (pos == p1 || pos == p1 + 1) continue;
+                std::vector<uint32_t> cand = without;
+                cand.insert(cand.begin() + (pos > p1 ? pos - 1 : pos), u);
+                if (!evaluate(inst, cand, cost1) || cost1 >= from.cost - MIN_GAIN) continue;
+                from.seq = std::move(cand);
+                place(s, r1);
+                return true;
+            }
+
+            RouteState& to = s.routes[r2];
+            if (to.load + inst.demand[u] > inst.capacity) continue;
+            if (insertDelta(inst, to, pos, u) - gain >= -MIN_GAIN) continue;
+            if (!canInsert(inst, to, pos, u) || !evaluate(inst, without, cost1)) continue;
+            to.seq.insert(to.seq.begin() + pos, u);
+            from.seq = std::move(without);
+            place(s, r1);
+            place(s, r2);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Swap u with a neighbour in another route
+static bool exchange(VrpState& s, uint32_t u, uint32_t group) {
+    const VrpInstance& inst = s.inst;
+    const uint32_t r1 = s.routeOf[u];
+    const size_t p1 = s.posOf[u];
+    RouteState& a = s.routes[r1];
+    uint32_t pu = p1 == 0 ? 0 : a.seq[p1 - 1];
+    uint32_t nu = p1 + 1 < a.seq.size() ? a.seq[p1 + 1] : 0;
+
+    for (uint32_t v : inst.neighbours[u]) {
+        if (s.groupOfStop[v] != group) continue;
+        const uint32_t r2 = s.routeOf[v];
+        if (r2 == r1) continue;
+        const size_t p2 = s.posOf[v];
+        RouteState& b = s.routes[r2];
+        if (a.load - inst.demand[u] + inst.demand[v] > inst.capacity ||
+            b.load - inst.demand[v] + inst.demand[u] > inst.capacity) continue;
+
+        uint32_t pv = p2 == 0 ? 0 : b.seq[p2 - 1];
+        uint32_t nv = p2 + 1 < b.seq.size() ? b.seq[p2 + 1] : 0;
+        double delta = inst.t(pu, v) + inst.t(v, nu) - inst.t(pu, u) - inst.t(u, nu)
+                     + inst.t(pv, u) + inst.t(u, nv) - inst.t(pv, v) - inst.t(v, nv);
+        if (delta >= -MIN_GAIN) continue;
+
+        std::vector<uint32_t> candA = a.seq, candB = b.seq;
+        candA[p1] = v;
+        candB[p2] = u;
+        double costA, costB;
+        if (!evaluate(inst, candA, costA) || !evaluate(inst, candB, costB)) continue;
+        a.seq = std::move(candA);
+        b.seq = std::move(candB);
+        place(s, r1);
+        place(s, r2);
+        return true;
+    }
+    return false;
+}
+
+// Local search confined to one group of routes; true if anything improved
+static bool improveGroup(VrpState& s, const std::vector<uint32_t>& routes, uint32_t group) {
+    bool any = false;
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (uint32_t r : routes) {
+            while (twoOpt(s, r)) improved = true;
+        }
+        std::vector<uint32_t> stops;
+        for (uint32_t r : routes) stops.insert(stops.end(), s.routes[r].seq.begin(), s.routes[r].seq.end());
+        for (uint32_t u : stops) {
+            if (relocate(s, u, group) || exchange(s, u, group)) improved = true;
+        }
+        any |= improved;
+    }
+    return any;
+}
+
+static VrpInstance buildInstance(const VrpProblem& p, const CostMatrix& m) {
+    VrpInstance inst;
+    inst.size = m.size;
+    inst.time.resize(m.cost.size());
+    for (size_t k = 0; k < m.cost.size(); ++k) inst.time[k] = std::min(m.cost[k], UNREACHABLE);
+    inst.capacity = p.capacity;
+
+    inst.demand = {0.0};
+    inst.ready = {p.depotOpen};
+    inst.due = {p.depotClose};
+    inst.service = {0.0};
+    for (const VrpStop& stop : p.stops) {
+        inst.demand.push_back(stop.demand);
+        inst.ready.push_back(stop.readyTime);
+        inst.due.push_back(stop.dueTime);
+        inst.service.push_back(stop.serviceTime);
+    }
+
+    // Granular neighbourhoods: moves only consider each stop's closest stops
+    const uint32_t n = static_cast<uint32_t>(inst.size);
+    inst.neighbours.resize(n);
+    std::vector<uint32_t> others;
+    for (uint32_t u = 1; u < n; ++u) {
+        others.clear();
+        for (uint32_t v = 1; v < n; ++v) {
+            if (v != u) others.push_back(v);
+        }
+        size_t k = std::min(NEIGHBOURS, others.size());
+        auto closeness = [&](uint32_t v) { return std::min(inst.t(u, v), inst.t(v, u)); };
+        std::partial_sort(others.begin(), others.begin() + k, others.end(),
+                          [&](uint32_t a, uint32_t b) { return closeness(a) < closeness(b); });
+        inst.neighbours[u].assign(others.begin(), others.begin() + k);
+    }
+    return inst;
+}
+
+VrpSolution solveVrp(const VrpProblem& problem, unsigned threads, bool buildPaths, const EdgeMaskPtr& mask) {
+    VrpSolution solution;
+    const RoadGraph& g = getRoadGraph();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Depot first, then the stops; stops off the graph are left unassigned
+    std::vector<uint32_t> nodes;
+    std::vector<size_t> stopOfIndex; // matrix index -> problem stop
+    uint32_t depot = g.toDense(problem.depot);
+    if (depot == INVALID_NODE) {
+        solution.unassigned.resize(problem.stops.size());
+        std::iota(solution.unassigned.begin(), solution.unassigned.end(), 0);
+        return solution;
+    }
+    nodes.push_back(depot);
+    stopOfIndex.push_back(0);
+    VrpProblem usable = problem;
+    usable.stops.clear();
+    for (size_t i = 0; i < problem.stops.size(); ++i) {
+        uint32_t v = g.toDense(problem.stops[i].node);
+        if (v == INVALID_NODE) {
+            solution.unassigned.push_back(i);
+            continue;
+        }
+        nodes.push_back(v);
+        stopOfIndex.push_back(i);
+        usable.stops.push_back(problem.stops[i]);
+    }
+
+    EdgeCostsPtr costs = getLiveCosts().snapshot();
+    if (mask) costs = maskCosts(*costs, *mask);
+    CostMatrix matrix = computeCostMatrix(g, nodes, RouteMetric::TravelTime, threads, costs);
+    VrpInstance inst = buildInstance(usable, matrix);
+    const uint32_t n = static_cast<uint32_t>(inst.size);
+
+    VrpState state{inst, std::vector<RouteState>(problem.vehicleCount),
+                   std::vector<uint32_t>(n, 0), std::vector<uint32_t>(n, 0),
+                   std::vector<uint32_t>(n, NO_GROUP)};
+
+    // Construction: farthest stops first, each at its cheapest feasible position
+    std::vector<uint32_t> order(n > 0 ? n - 1 : 0);
+    std::iota(order.begin(), order.end(), 1);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return inst.t(0, a) + inst.t(a, 0) > inst.t(0, b) + inst.t(b, 0);
+    });
+    std::vector<uint32_t> unrouted;
+    for (uint32_t u : order) {
+        if (!insertCheapest(state, u)) unrouted.push_back(u);
+    }
+
+    // Local search rounds. Routes are sorted by bearing from the depot and cut
+    // into one group per thread; the cut points shift every round so stops on
+    // group borders get to move too. Once that stops paying off, a last round
+    // over all routes at once finds the moves the grouping ruled out.
+    std::vector<double> bearing(state.routes.size(), 0.0);
+    bool finalRound = threads == 1;
+    for (int round = 0, stale = 0; round < MAX_ROUNDS; ++round) {
+        std::vector<uint32_t> active;
+        for (uint32_t r = 0; r < state.routes.size(); ++r) {
+            const auto& seq = state.routes[r].seq;
+            if (seq.empty()) continue;
+            double dLat = 0.0, dLon = 0.0;
+            for (uint32_t u : seq) {
+                dLat += g.coords[nodes[u]].latDeg() - g.coords[depot].latDeg();
+                dLon += g.coords[nodes[u]].lonDeg() - g.coords[depot].lonDeg();
+            }
+            bearing[r] = std::atan2(dLat, dLon);
+            active.push_back(r);
+        }
+        if (active.empty()) break;
+        std::sort(active.begin(), active.end(), [&](uint32_t a, uint32_t b) { return bearing[a] < bearing[b]; });
+
+        const size_t groupCount = finalRound ? 1 : std::max<size_t>(1, std::min<size_t>(threads, active.size() / 2));
+        const size_t perGroup = (active.size() + groupCount - 1) / groupCount;
+        const size_t shift = groupCount > 1 ? (round * perGroup / 2) % active.size() : 0;
+
+        std::vector<std::vector<uint32_t>> groups(groupCount);
+        std::fill(state.groupOfStop.begin(), state.groupOfStop.end(), NO_GROUP);
+        for (size_t k = 0; k < active.size(); ++k) {
+            uint32_t group = static_cast<uint32_t>(((k + shift) % active.size()) / perGroup);
+            groups[group].push_back(active[k]);
+            for (uint32_t u : state.routes[active[k]].seq) state.groupOfStop[u] = group;
+        }
+
+        std::vector<char> improved(groupCount, 0);
+        std::vector<std::thread> workers;
+        for (uint32_t gi = 1; gi < groupCount; ++gi) {
+            workers.emplace_back([&, gi] { improved[gi] = improveGroup(state, groups[gi], gi); });
+        }
+        improved[0] = improveGroup(state, groups[0], 0);
+        for (auto& w : workers) w.join();
+
+        if (groupCount == 1) break; // improveGroup already ran to a local optimum
+        bool any = std::find(improved.begin(), improved.end(), 1) != improved.end();
+        stale = any ? 0 : stale + 1;
+        if (stale == 2 || round + 2 == MAX_ROUNDS) finalRound = true;
+    }
+
+    // Stops that did not fit may fit now
+    for (uint32_t u : unrouted) {
+        if (!insertCheapest(state, u)) solution.unassigned.push_back(stopOfIndex[u]);
+    }
+    std::sort(solution.unassigned.begin(), solution.unassigned.end());
+
+    for (const RouteState& route : state.routes) {
+        VrpRoute out{};
+        for (size_t k = 0; k < route.seq.size(); ++k) {
+            out.stops.push_back(stopOfIndex[route.seq[k]]);
+            out.arrival.push_back(route.start[k]);
+        }
+        out.load = route.load;
+        out.duration = route.seq.empty() ? 0.0 : route.cost;
+        solution.totalDuration += out.duration;
+
+        if (buildPaths && !route.seq.empty()) {
+            std::vector<int64_t> stops{problem.depot};
+            for (size_t i : out.stops) stops.push_back(problem.stops[i].node);
+            stops.push_back(problem.depot);
+            out.path = routeThroughStops(stops, RouteMetric::TravelTime, StopOrder::AsGiven, Profile::Car, mask).path;
+        }
+        solution.routes.push_back(std::move(out));
+    }
+    return solution;
+}
+
+size_t solveVrpStream(std::istream& in, std::ostream& out, size_t vehicles, double capacity, unsigned threads) {
+    VrpProblem problem;
+    problem.vehicleCount = vehicles;
+    problem.capacity = capacity;
+    std::vector<std::pair<double, double>> points;
+
+    bool haveDepot = false;
+    std::string line, field;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        double values[6];
+        int count = 0;
+        while (count < 6 && std::getline(ss, field, ',')) {
+            std::istringstream fs(field);
+            if (!(fs >> values[count])) break;
+            count++;
+        }
+        if (count < 2) continue; // header or malformed
+
+        VrpStop stop;
+        stop.node = findNearestNode(values[0], values[1]);
+        if (count > 2) stop.demand = values[2];
+        if (count > 3) stop.readyTime = values[3];
+        if (count > 4) stop.dueTime = values[4];
+        if (count > 5) stop.serviceTime = values[5];
+
+        if (!haveDepot) {
+            problem.depot = stop.node;
+            problem.depotOpen = stop.readyTime;
+            problem.depotClose = stop.dueTime;
+            haveDepot = true;
+            continue;
+        }
+        problem.stops.push_back(stop);
+        points.push_back({values[0], values[1]});
+    }
+
+    VrpSolution solution = solveVrp(problem, threads, false);
+
+    out << "vehicle,sequence,stop,lat,lon,arrival_s\n";
+    out << std::fixed;
+    for (size_t r = 0; r < solution.routes.size(); ++r) {
+        const VrpRoute& route = solution.routes[r];
+        for (size_t k = 0; k < route.stops.size(); ++k) {
+            size_t i = route.stops[k];
+            out << r + 1 << ',' << k + 1 << ',' << i + 1 << ',' << std::setprecision(7)
+                << points[i].first << ',' << points[i].second << ','
+                << std::setprecision(0) << route.arrival[k] << '\n';
+        }
+    }
+    for (size_t i : solution.unassigned) {
+        out << ",," << i + 1 << ',' << std::setprecision(7) << points[i].first << ','
+            << points[i].second << ",\n";
+    }
+    return problem.stops.size();
+}
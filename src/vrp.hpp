@@ -0,0 +1,64 @@
+#ifndef VRP
+#define VRP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <iosfwd>
+
+#include "a_star.hpp"
+
+// A customer to visit. Times are seconds from the start of the plan.
+struct VrpStop {
+    int64_t node = 0;        // OSM node id
+    double demand = 1.0;
+    double readyTime = 0.0;  // earliest service start
+    double dueTime = std::numeric_limits<double>::infinity(); // latest service start
+    double serviceTime = 0.0;
+};
+
+// Homogeneous fleet starting and ending at one depot
+struct VrpProblem {
+    int64_t depot = 0;       // OSM node id
+    double depotOpen = 0.0;
+    double depotClose = std::numeric_limits<double>::infinity(); // latest return
+    std::vector<VrpStop> stops;
+    size_t vehicleCount = 1;
+    double capacity = std::numeric_limits<double>::infinity();
+};
+
+struct VrpRoute {
+    std::vector<size_t> stops;    // indices into VrpProblem::stops, in visiting order
+    std::vector<double> arrival;  // service start at each stop
+    double load = 0.0;
+    double duration = 0.0;        // driving time depot to depot, seconds
+    PathResult path;              // depot -> stops -> depot, empty if not requested or no stops
+};
+
+struct VrpSolution {
+    std::vector<VrpRoute> routes; // one per vehicle, possibly without stops
+    std::vector<size_t> unassigned;
+    double totalDuration = 0.0;
+};
+
+// Capacitated VRP with time windows, minimising total driving time.
+// A travel time matrix over depot and stops comes from the road graph
+// (computeCostMatrix), cheapest feasible insertion builds the routes, and
+// local search (2-opt within a route, relocate and exchange between routes,
+// over each stop's nearest neighbours) improves them. Local search runs on
+// threads, each owning a disjoint group of neighbouring routes per round;
+// the grouping rotates between rounds. threads == 0 uses every core. Edges
+// in mask are avoided, in the matrix and in the paths.
+VrpSolution solveVrp(const VrpProblem& problem, unsigned threads = 0, bool buildPaths = true,
+                     const EdgeMaskPtr& mask = nullptr);
+
+// Batch mode: read "lat,lon[,demand,ready_s,due_s,service_s]" lines, the first
+// one being the depot (its window gives the opening hours), snap them to the
+// road network and plan for the given fleet. Writes one CSV row per visit
+// (vehicle,sequence,stop,lat,lon,arrival_s); unassigned stops get an empty
+// vehicle. stop is the 1-based data row after the depot. Returns stops read.
+size_t solveVrpStream(std::istream& in, std::ostream& out, size_t vehicles, double capacity,
+                      unsigned threads = 0);
+
+#endif
@@ -1,10 +1,19 @@
 #include <iostream>
 #include <cmath>
+#include <cstdio>
 #include <vector>
 
 #include "ui_panel.hpp"
 #include "windower.hpp"
 #include "a_star.hpp"
+#include "instructions.hpp"
+#include "geocoder.hpp"
+#include "multi_stop.hpp"
+#include "vrp.hpp"
+#include "facilities.hpp"
+#include "segment_index.hpp"
+#include "edge_costs.hpp"
+#include "edge_mask.hpp"
 
 
 void ApplyModernDarkTheme() {
@@ -106,63 +115,91 @@ void Windower::run() {
 
 
         panel.ShowUIPanel();
+        handlePlacePick();
+        if (panel.m_avoidChanged) updateAvoidMask();
+        if (panel.m_stopsChanged) {
+            panel.m_stopsChanged = false;
+            updateEndpointMarkers();
+        }
+        if (m_dragMoved) replanDrag();
+
+        if (panel.m_runAStarWithNodes && panel.m_anytime) {
+            panel.m_runAStarWithNodes = false;
+            startAnytimeRoute();
+        }
+        showAnytimeProgress();
 
         if (panel.m_runAStarWithNodes) {
             panel.m_runAStarWithNodes = false;
-            
-            
-            PathResult result = aStarWithNodes(panel.m_startNode, panel.m_endNode);
-            if (result.found && !result.nodeIds.empty()) {
-                std::cout << "Path found with " << result.nodeIds.size() << " nodes\n";
-               
-                std::vector<float> pathVertices;
-                std::vector<unsigned int> pathIndices;
-
-                panel.m_distance = result.distance;
-                panel.m_straightLineDistance = result.straightPathDist;
-                
-                convertPathToVertices(result.nodeIds, m_mapMidX, m_mapMidY, m_mapScale, pathVertices, pathIndices);
-                
-                std::cout << "Converted to " << pathVertices.size()/3 << " vertices and " << pathIndices.size() << " indices\n";
-                if (!pathVertices.empty() && !pathIndices.empty()) {
-                    m_renderer.setPathVertices(pathVertices);
-                    m_renderer.setPathIndices(pathIndices);
-                } else {
-                    std::cout << "ERROR: Path vertices/indices are empty after conversion!\n";
-                }
-            } else {
+
+            PathResult result = aStarAvoiding(panel.m_startNode, panel.m_endNode, m_avoidMask,
+                                              RouteMetric::Distance, static_cast<Profile>(panel.m_profile));
+            if (!showRoute(result)) {
                 std::cout << "No path found between nodes " << panel.m_startNode << " and " << panel.m_endNode << "\n";
-                m_renderer.clearPath();
             }
         }
 
+        if (panel.m_runPareto) {
+            panel.m_runPareto = false;
+            compareRoutes();
+        }
+        if (!m_paretoPaths.empty() &&
+            (panel.m_startNode != m_paretoStartNode || panel.m_endNode != m_paretoEndNode)) {
+            clearFrontier();
+        }
+        if (panel.m_paretoPicked) {
+            panel.m_paretoPicked = false;
+            showParetoRoute(static_cast<size_t>(panel.m_paretoPick));
+        }
+
         if (panel.m_runAStarWithCoords) {
             panel.m_runAStarWithCoords = false;
             
-            PathResult result = aStarWithCoords(panel.m_startLat, panel.m_startLon, 
-                                               panel.m_endLat, panel.m_endLon);
-            if (result.found && !result.nodeIds.empty()) {
-                std::cout << "Path found with " << result.nodeIds.size() << " nodes\n";
-                std::vector<float> pathVertices;
-                std::vector<unsigned int> pathIndices;
-                
-            
-                convertPathToVertices(result.nodeIds, m_mapMidX, m_mapMidY, m_mapScale, pathVertices, pathIndices);
-                
-                std::cout << "Converted to " << pathVertices.size()/3 << " vertices and " << pathIndices.size() << " indices\n";
-                if (!pathVertices.empty() && !pathIndices.empty()) {
-                    m_renderer.setPathVertices(pathVertices);
-                    m_renderer.setPathIndices(pathIndices);
-                } else {
-                    std::cout << "ERROR: Path vertices/indices are empty after conversion!\n";
-                }
+            const Profile profile = static_cast<Profile>(panel.m_profile);
+            PathResult result;
+            if (m_avoidMask) {
+                int64_t from = findNearestNode(panel.m_startLat, panel.m_startLon, true, profile);
+                int64_t to = findNearestNode(panel.m_endLat, panel.m_endLon, true, profile);
+                result = aStarAvoiding(from, to, m_avoidMask, RouteMetric::Distance, profile);
             } else {
+                result = aStarWithCoords(panel.m_startLat, panel.m_startLon, 
+                                         panel.m_endLat, panel.m_endLon, RouteMetric::Distance, profile);
+            }
+            if (!showRoute(result)) {
                 std::cout << "No path found between coordinates\n";
-              
-                m_renderer.clearPath();
             }
         }
 
+        if (panel.m_runMultiStop) {
+            panel.m_runMultiStop = false;
+
+            std::vector<int64_t> stops;
+            if (panel.m_startNode != 0) stops.push_back(panel.m_startNode);
+            stops.insert(stops.end(), panel.m_viaNodes.begin(), panel.m_viaNodes.end());
+            if (panel.m_endNode != 0) stops.push_back(panel.m_endNode);
+
+            MultiStopResult route = routeThroughStops(stops, RouteMetric::Distance,
+                                                      static_cast<StopOrder>(panel.m_stopOrder),
+                                                      static_cast<Profile>(panel.m_profile), m_avoidMask);
+            if (showRoute(route.path)) {
+                std::cout << "Stop order:";
+                for (size_t k : route.order) std::cout << " " << stops[k];
+                std::cout << "\n";
+            } else {
+                std::cout << "No route through " << stops.size() << " stops\n";
+            }
+        }
+
+        if (panel.m_runVehiclePlan) {
+            panel.m_runVehiclePlan = false;
+            planVehicles();
+        }
+
+        if (panel.m_runNearestFacility) {
+            panel.m_runNearestFacility = false;
+            routeToNearestFacility();
+        }
+
 
         m_renderer.render();
 
@@ -173,6 +210,196 @@ void Windower::run() {
     }
 }
 
+// Every route shown replaces the anytime one, so its worker stops first
+bool Windower::showRoute(const PathResult& result, bool keepFrontier) {
+    stopAnytimeRoute();
+    return drawRoute(result, keepFrontier);
+}
+
+bool Windower::drawRoute(const PathResult& result, bool keepFrontier) {
+    if (!keepFrontier) clearFrontier();
+    m_renderer.clearRoutes();
+    if (!result.found || result.nodeIds.empty()) {
+        m_renderer.clearPath();
+        return false;
+    }
+    std::cout << "Path found with " << result.nodeIds.size() << " nodes\n";
+
+    std::vector<float> pathVertices;
+    std::vector<unsigned int> pathIndices;
+
+    panel.m_distance = result.distance;
+    panel.m_straightLineDistance = result.straightPathDist;
+    panel.m_routeBound = static_cast<float>(result.bound);
+    panel.setInstructions(buildInstructions(result));
+
+    convertPathToVertices(result.nodeIds, m_mapMidX, m_mapMidY, m_mapScale, pathVertices, pathIndices);
+
+    std::cout << "Converted to " << pathVertices.size()/3 << " vertices and " << pathIndices.size() << " indices\n";
+    if (!pathVertices.empty() && !pathIndices.empty()) {
+        m_renderer.setPathVertices(pathVertices);
+        m_renderer.setPathIndices(pathIndices);
+    } else {
+        std::cout << "ERROR: Path vertices/indices are empty after conversion!\n";
+    }
+    return true;
+}
+
+// ARA* on a worker thread: the first route shows within milliseconds, then
+// better ones replace it until it is proven shortest or time runs out
+void Windower::startAnytimeRoute() {
+    stopAnytimeRoute();
+    const RoadGraph& g = getRoadGraph();
+    uint32_t start = g.toDense(panel.m_startNode);
+    uint32_t goal = g.toDense(panel.m_endNode);
+    if (start == INVALID_NODE || goal == INVALID_NODE ||
+        !g.mayReach(start, goal, static_cast<Profile>(panel.m_profile))) {
+        std::cout << "No path found between nodes " << panel.m_startNode << " and " << panel.m_endNode << "\n";
+        return;
+    }
+    if (!m_anytime) m_anytime = std::make_unique<AnytimeRouter>(g);
+    m_anytimeCosts = routeCosts();
+    m_anytimeStart = start;
+    m_anytimeShown = 0;
+    m_anytime->start(start, goal, RouteMetric::Distance, m_anytimeCosts, std::chrono::milliseconds(2000));
+}
+
+void Windower::showAnytimeProgress() {
+    if (!m_anytime) return;
+    size_t count = 0;
+    AnytimeSolution solution = m_anytime->latest(&count);
+    if (count == m_anytimeShown) return;
+    m_anytimeShown = count;
+
+    PathResult result = pathFromEdges(m_anytimeStart, solution.edges, *m_anytimeCosts);
+    result.bound = solution.bound;
+    drawRoute(result, false);
+    std::cout << "Anytime route " << count << ": " << solution.cost / 1000.0 << " km, within "
+              << (solution.bound - 1.0) * 100.0 << "% of the shortest\n";
+}
+
+// Solutions found before the worker stopped count as shown, so none of them
+// is drawn over whatever replaces the route
+void Windower::stopAnytimeRoute() {
+    if (!m_anytime) return;
+    m_anytime->cancel();
+    m_anytime->latest(&m_anytimeShown);
+}
+
+// Every route between start and end that no other route beats on both
+// distance and time; the shortest is shown, the others drawn alongside
+void Windower::compareRoutes() {
+    const RoadGraph& g = getRoadGraph();
+    uint32_t start = g.toDense(panel.m_startNode);
+    uint32_t goal = g.toDense(panel.m_endNode);
+    stopAnytimeRoute();
+    clearFrontier();
+    if (start == INVALID_NODE || goal == INVALID_NODE ||
+        !g.mayReach(start, goal, static_cast<Profile>(panel.m_profile))) {
+        std::cout << "No path found between nodes " << panel.m_startNode << " and " << panel.m_endNode << "\n";
+        return;
+    }
+    if (!m_pareto) m_pareto = std::make_unique<ParetoSearch>(g);
+
+    EdgeCostsPtr costs = routeCosts();
+    std::vector<ParetoRoute> routes = m_pareto->run(start, goal, costs);
+    std::cout << routes.size() << " routes on the frontier (" << m_pareto->labelCount() << " labels)\n";
+    for (const ParetoRoute& route : routes) {
+        m_paretoPaths.push_back(pathFromEdges(start, route.edges, *costs));
+        char line[64];
+        std::snprintf(line, sizeof(line), "%.2f km, %.0f min", route.distance / 1000.0, route.duration / 60.0);
+        panel.m_paretoRoutes.push_back(line);
+    }
+    m_paretoStartNode = panel.m_startNode;
+    m_paretoEndNode = panel.m_endNode;
+    panel.m_paretoPick = 0;
+    if (!m_paretoPaths.empty()) showParetoRoute(0);
+}
+
+void Windower::showParetoRoute(size_t pick) {
+    if (pick >= m_paretoPaths.size()) return;
+    showRoute(m_paretoPaths[pick], true);
+    std::vector<std::vector<float>> others;
+    for (size_t i = 0; i < m_paretoPaths.size(); ++i) {
+        if (i == pick) continue;
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        convertPathToVertices(m_paretoPaths[i].nodeIds, m_mapMidX, m_mapMidY, m_mapScale, vertices, indices);
+        others.push_back(std::move(vertices));
+    }
+    m_renderer.setRoutes(others);
+}
+
+// The frontier list only makes sense next to one of its routes
+void Windower::clearFrontier() {
+    panel.m_paretoRoutes.clear();
+    m_paretoPaths.clear();
+}
+
+// Start node is the depot, via stops (and the end node, if set) are the
+// customers, shared out evenly between the vehicles
+void Windower::routeToNearestFacility() {
+    const RoadGraph& g = getRoadGraph();
+    const FacilityKind kind = static_cast<FacilityKind>(panel.m_facilityKind);
+    uint32_t from = g.toDense(panel.m_startNode);
+    if (from == INVALID_NODE) {
+        std::cout << "Set a start node first\n";
+        return;
+    }
+
+    const FacilityIndex& index = getFacilityIndex();
+    auto hits = index.nearest(from, kind, 1, RouteMetric::Distance, routeCosts());
+    if (hits.empty()) {
+        std::cout << "No " << facilityKindName(kind) << " reachable from node " << panel.m_startNode << "\n";
+        return;
+    }
+    const Facility& f = index.facilities()[hits[0].facility];
+    std::cout << "Nearest " << facilityKindName(kind) << ": " << (f.name.empty() ? "unnamed" : f.name)
+              << ", " << hits[0].cost / 1000.0 << " km by road\n";
+    panel.m_endNode = g.osmIds[f.node];
+    updateEndpointMarkers();
+    showRoute(aStarAvoiding(panel.m_startNode, panel.m_endNode, m_avoidMask, RouteMetric::Distance,
+                            static_cast<Profile>(panel.m_profile)));
+}
+
+void Windower::planVehicles() {
+    VrpProblem problem;
+    problem.depot = panel.m_startNode;
+    for (int64_t id : panel.m_viaNodes) problem.stops.push_back({id});
+    if (panel.m_endNode != 0) problem.stops.push_back({panel.m_endNode});
+    if (problem.depot == 0 || problem.stops.empty()) {
+        std::cout << "Set a start node and some stops first\n";
+        return;
+    }
+    problem.vehicleCount = static_cast<size_t>(panel.m_vehicleCount);
+    problem.capacity = static_cast<double>((problem.stops.size() + problem.vehicleCount - 1) / problem.vehicleCount);
+
+    stopAnytimeRoute();
+    VrpSolution plan = solveVrp(problem, 0, true, m_avoidMask);
+    std::vector<std::vector<float>> routes;
+    float distance = 0.0f;
+    for (size_t r = 0; r < plan.routes.size(); ++r) {
+        const VrpRoute& route = plan.routes[r];
+        if (!route.path.found) continue;
+        std::cout << "Vehicle " << r + 1 << ": " << route.stops.size() << " stops, "
+                  << static_cast<int>(route.duration / 60.0) << " min\n";
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        convertPathToVertices(route.path.nodeIds, m_mapMidX, m_mapMidY, m_mapScale, vertices, indices);
+        routes.push_back(std::move(vertices));
+        distance += route.path.distance;
+    }
+    if (!plan.unassigned.empty()) std::cout << plan.unassigned.size() << " stops could not be assigned\n";
+
+    panel.m_distance = distance;
+    panel.m_straightLineDistance = 0.0f;
+    panel.m_instructions.clear();
+    clearFrontier();
+    m_renderer.clearPath();
+    m_renderer.setRoutes(routes);
+}
+
 void Windower::processInput() {
     if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(m_window, true);
@@ -202,47 +429,93 @@ void Windower::m_mouseButtonCallback(GLFWwindow* window, int button, int action,
     }
 }
 
+void Windower::screenToLatLon(double xpos, double ypos, double& lat, double& lon) const {
+    // Convert screen to NDC
+    double ndc_x = (2.0 * xpos) / static_cast<double>(m_windowWidth) - 1.0;
+    double ndc_y = -((2.0 * ypos) / static_cast<double>(m_windowHeight) - 1.0);
+
+    // Convert NDC to World (Normalized Map Coords)
+    // Shader: gl_Position = vec4((pos.x - offset.x) * scale * aspect, (pos.y - offset.y) * scale, 0.0, 1.0);
+    // ndc_x = (world_x - ox) * scale * aspect
+    // ndc_y = (world_y - oy) * scale
+    
+    double aspect = static_cast<double>(m_windowHeight) / static_cast<double>(m_windowWidth);
+    double world_x = (ndc_x / (m_camScale * aspect)) - m_camOX;
+    double world_y = (ndc_y / m_camScale) - m_camOY;
+
+    // Convert World (Normalized) to Mercator
+    // nx = (x_merc - midX) * (2.0f / scale);
+    // x_merc = nx * (scale / 2.0f) + midX;
+    double x_merc = world_x * (m_mapScale / 2.0) + m_mapMidX;
+    double y_merc = world_y * (m_mapScale / 2.0) + m_mapMidY;
+
+    // Convert Mercator to Lat/Lon
+    // x_merc = lon_rad
+    // y_merc = 0.5 * log((1 + sin(lat)) / (1 - sin(lat)))
+    const double rad2deg = 180.0 / M_PI;
+    lon = x_merc * rad2deg;
+    double lat_rad = 2.0 * std::atan(std::exp(y_merc)) - (M_PI / 2.0);
+    lat = lat_rad * rad2deg;
+}
+
+// Inverse of screenToLatLon for a node's position
+bool Windower::nodeToScreen(int64_t nodeId, double& xpos, double& ypos) const {
+    double nLat, nLon;
+    if (!getNodeCoords(nodeId, nLat, nLon)) return false;
+    double nLatRad = nLat * (M_PI / 180.0);
+    double xMerc = nLon * (M_PI / 180.0);
+    double yMerc = 0.5 * std::log((1.0 + std::sin(nLatRad)) / (1.0 - std::sin(nLatRad)));
+    double world_x = (xMerc - m_mapMidX) * (2.0 / m_mapScale);
+    double world_y = (yMerc - m_mapMidY) * (2.0 / m_mapScale);
+
+    double aspect = static_cast<double>(m_windowHeight) / static_cast<double>(m_windowWidth);
+    double ndc_x = (world_x + m_camOX) * m_camScale * aspect;
+    double ndc_y = (world_y + m_camOY) * m_camScale;
+    xpos = (ndc_x + 1.0) * 0.5 * static_cast<double>(m_windowWidth);
+    ypos = (1.0 - ndc_y) * 0.5 * static_cast<double>(m_windowHeight);
+    return true;
+}
+
 void Windower::handleMouseClick(int button, int action, double xpos, double ypos) {
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE && m_dragging != 0) {
+        endDrag();
+        return;
+    }
     if (ImGui::GetIO().WantCaptureMouse) return;
+    if (panel.m_drawingArea) {
+        if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+            double lat, lon;
+            screenToLatLon(xpos, ypos, lat, lon);
+            panel.m_avoidAreas.back().emplace_back(lat, lon);
+        }
+        return;
+    }
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && beginDrag(xpos, ypos)) return;
 
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        // Convert screen to NDC
-        double ndc_x = (2.0 * xpos) / static_cast<double>(m_windowWidth) - 1.0;
-        double ndc_y = -((2.0 * ypos) / static_cast<double>(m_windowHeight) - 1.0);
-
-        // Convert NDC to World (Normalized Map Coords)
-        // Shader: gl_Position = vec4((pos.x - offset.x) * scale * aspect, (pos.y - offset.y) * scale, 0.0, 1.0);
-        // ndc_x = (world_x - ox) * scale * aspect
-        // ndc_y = (world_y - oy) * scale
-        
-        double aspect = static_cast<double>(m_windowHeight) / static_cast<double>(m_windowWidth);
-        double world_x = (ndc_x / (m_camScale * aspect)) - m_camOX;
-        double world_y = (ndc_y / m_camScale) - m_camOY;
-
-        // Convert World (Normalized) to Mercator
-        // nx = (x_merc - midX) * (2.0f / scale);
-        // x_merc = nx * (scale / 2.0f) + midX;
-        double x_merc = world_x * (m_mapScale / 2.0) + m_mapMidX;
-        double y_merc = world_y * (m_mapScale / 2.0) + m_mapMidY;
-
-        // Convert Mercator to Lat/Lon
-        // x_merc = lon_rad
-        // y_merc = 0.5 * log((1 + sin(lat)) / (1 - sin(lat)))
-        const double rad2deg = 180.0 / M_PI;
-        double lon = x_merc * rad2deg;
-        double lat_rad = 2.0 * std::atan(std::exp(y_merc)) - (M_PI / 2.0);
-        double lat = lat_rad * rad2deg;
+    if ((button == GLFW_MOUSE_BUTTON_LEFT || button == GLFW_MOUSE_BUTTON_RIGHT) && action == GLFW_PRESS) {
+        double lat, lon;
+        screenToLatLon(xpos, ypos, lat, lon);
 
         // Find nearest node
-        int64_t nodeId = findNearestNode(lat, lon);
+        int64_t nodeId = findNearestNode(lat, lon, true, static_cast<Profile>(panel.m_profile));
         if (nodeId != 0) {
             std::cout << "Selected Node: " << nodeId << " at " << lat << ", " << lon << "\n";
+
+            ReverseGeocodeResult place = reverseGeocode(lat, lon);
+            if (place.found) {
+                std::cout << "  on " << place.roadName << " (" << place.highway << "), "
+                          << static_cast<int>(place.distance) << " m from the road, "
+                          << static_cast<int>(place.positionAlong) << " m along way " << place.wayId << "\n";
+            }
             
-            if (panel.m_startNode == 0 || (panel.m_startNode != 0 && panel.m_endNode != 0)) {
+            if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+                panel.m_viaNodes.push_back(nodeId);
+            } else if (panel.m_startNode == 0 || (panel.m_startNode != 0 && panel.m_endNode != 0)) {
                 panel.m_startNode = nodeId;
                 panel.m_endNode = 0;
                 panel.m_startLat = static_cast<float>(lat);
                 panel.m_startLon = static_cast<float>(lon);
+                stopAnytimeRoute();
                 m_renderer.clearPath();
             } else {
                 panel.m_endNode = nodeId;
@@ -250,37 +523,212 @@ void Windower::handleMouseClick(int button, int action, double xpos, double ypos
                 panel.m_endLon = static_cast<float>(lon);
             }
 
-            std::vector<float> points;
-            
-            auto addPoint = [&](int64_t id) {
-                double nLat, nLon;
-                if (getNodeCoords(id, nLat, nLon)) {
-                    // Convert back to Normalized Map Coords
-                    double nLonRad = nLon * (M_PI / 180.0);
-                    double nLatRad = nLat * (M_PI / 180.0);
-                    double nXMerc = nLonRad;
-                    double nYMerc = 0.5 * std::log((1.0 + std::sin(nLatRad)) / (1.0 - std::sin(nLatRad)));
+            updateEndpointMarkers();
+        }
+    }
+}
+
+// Markers can be picked up from this many pixels away
+constexpr double DRAG_RADIUS_PX = 12.0;
+
+// Road node under the cursor for a drag. The segment index answers in
+// microseconds where findNearestNode scans every node, which would cost a
+// frame; it is still the fallback off the road network.
+static uint32_t snapForDrag(double lat, double lon, Profile profile) {
+    const RoadGraph& g = getRoadGraph();
+    auto usable = [&](uint32_t v) {
+        if (!g.inLargestComponent(v, profile)) return false;
+        for (uint32_t e = g.firstOut[v]; e < g.firstOut[v + 1]; ++e) {
+            if (g.edgeAccess[e] & profileBit(profile)) return true;
+        }
+        return false;
+    };
+    SegmentHit hit = getSegmentIndex().nearest(lat, lon, 300.0);
+    if (hit.segment != UINT32_MAX) {
+        const RoadSegment& s = getSegmentIndex().segment(hit.segment);
+        uint32_t nearer = hit.fraction < 0.5 ? s.u : s.v;
+        uint32_t farther = hit.fraction < 0.5 ? s.v : s.u;
+        if (usable(nearer)) return nearer;
+        if (usable(farther)) return farther;
+    }
+    return g.toDense(findNearestNode(lat, lon, true, profile));
+}
+
+bool Windower::beginDrag(double xpos, double ypos) {
+    if (panel.m_startNode == 0 || panel.m_endNode == 0) return false;
+    const RoadGraph& g = getRoadGraph();
+    uint32_t start = g.toDense(panel.m_startNode);
+    uint32_t end = g.toDense(panel.m_endNode);
+    if (start == INVALID_NODE || end == INVALID_NODE) return false;
+
+    stopAnytimeRoute();
+
+    // The closer marker within reach, if any
+    double best = DRAG_RADIUS_PX;
+    int marker = 0;
+    double mx, my;
+    if (nodeToScreen(panel.m_startNode, mx, my) && std::hypot(mx - xpos, my - ypos) <= best) {
+        best = std::hypot(mx - xpos, my - ypos);
+        marker = 1;
+    }
+    if (nodeToScreen(panel.m_endNode, mx, my) && std::hypot(mx - xpos, my - ypos) <= best) marker = 2;
+    if (marker == 0) return false;
+
+    // The marker left in place is the root of the search tree
+    if (!m_replanner) m_replanner = std::make_unique<IncrementalSearch>(g);
+    if (marker == 2) m_replanner->reset(start, true, end, RouteMetric::Distance, routeCosts());
+    else m_replanner->reset(end, false, start, RouteMetric::Distance, routeCosts());
+
+    m_dragging = marker;
+    m_dragMoved = false;
+    m_dragReplanned = false;
+    m_dragX = xpos;
+    m_dragY = ypos;
+    return true;
+}
+
+// Called once per frame while the cursor moves with a marker in hand, so a
+// burst of cursor events costs one repair
+void Windower::replanDrag() {
+    m_dragMoved = false;
+    const RoadGraph& g = getRoadGraph();
+    const Profile profile = static_cast<Profile>(panel.m_profile);
+
+    double lat, lon;
+    screenToLatLon(m_dragX, m_dragY, lat, lon);
+    uint32_t v = snapForDrag(lat, lon, profile);
+    if (v == INVALID_NODE) return;
+    m_dragReplanned = true;
+
+    if (m_dragging == 1) {
+        panel.m_startNode = g.osmIds[v];
+        panel.m_startLat = static_cast<float>(lat);
+        panel.m_startLon = static_cast<float>(lon);
+    } else {
+        panel.m_endNode = g.osmIds[v];
+        panel.m_endLat = static_cast<float>(lat);
+        panel.m_endLon = static_cast<float>(lon);
+    }
+    updateEndpointMarkers();
+
+    // Live updates published mid-drag are repaired into the tree as well
+    m_replanner->useCosts(routeCosts());
+    double cost = m_replanner->moveTo(v);
+
+    m_renderer.clearRoutes();
+    panel.m_instructions.clear();
+    std::vector<uint32_t> edges = m_replanner->edgePath();
+    if (std::isinf(cost) || edges.empty()) {
+        m_renderer.clearPath();
+        panel.m_distance = 0.0f;
+        return;
+    }
+
+    std::vector<int64_t> nodeIds;
+    nodeIds.reserve(edges.size() + 1);
+    nodeIds.push_back(g.osmIds[m_replanner->rootIsStart() ? m_replanner->root() : m_replanner->endpoint()]);
+    for (uint32_t e : edges) nodeIds.push_back(g.osmIds[g.head[e]]);
+
+    std::vector<float> pathVertices;
+    std::vector<unsigned int> pathIndices;
+    convertPathToVertices(nodeIds, m_mapMidX, m_mapMidY, m_mapScale, pathVertices, pathIndices);
+    m_renderer.setPathVertices(pathVertices);
+    m_renderer.setPathIndices(pathIndices);
+    panel.m_distance = static_cast<float>(cost);
+    panel.m_routeBound = 1.0f;
+}
+
+// Dropping the marker routes once more in full, for the directions
+void Windower::endDrag() {
+    if (m_dragMoved) replanDrag();
+    m_dragging = 0;
+    if (!m_dragReplanned) return; // a click on the marker, nothing moved
+    showRoute(aStarAvoiding(panel.m_startNode, panel.m_endNode, m_avoidMask, RouteMetric::Distance,
+                            static_cast<Profile>(panel.m_profile)));
+}
+
+void Windower::updateAvoidMask() {
+    panel.m_avoidChanged = false;
+    stopAnytimeRoute(); // its costs still route through what is now avoided
+    m_avoidMask = buildEdgeMask(getRoadGraph(), getSegmentIndex(), panel.restrictions());
+    m_maskedFrom.reset();
+    m_maskedCosts.reset();
+    if (m_avoidMask) std::cout << "Avoiding " << m_avoidMask->blockedCount() << " edges\n";
+}
+
+// Live costs for the chosen profile with the avoided edges closed. The masked
+// copy is kept until a new snapshot is published, so replanning a drag every
+// frame does not see a fresh set of costs each time.
+EdgeCostsPtr Windower::routeCosts() {
+    EdgeCostsPtr costs = getLiveCosts().snapshot(static_cast<Profile>(panel.m_profile));
+    if (!m_avoidMask) return costs;
+    if (costs != m_maskedFrom) {
+        m_maskedFrom = costs;
+        m_maskedCosts = maskCosts(*costs, *m_avoidMask);
+    }
+    return m_maskedCosts;
+}
+
+void Windower::handlePlacePick() {
+    if (panel.m_pickedPlace < 0) return;
+    const PlaceEntry& place = panel.m_nameIndex.entry(static_cast<uint32_t>(panel.m_pickedPlace));
+    panel.m_pickedPlace = -1;
+
+    int64_t nodeId = findNearestNode(place.lat, place.lon, true, static_cast<Profile>(panel.m_profile));
+    if (nodeId == 0) return;
+    std::cout << "Selected " << place.name << ": node " << nodeId << "\n";
+
+    if (panel.m_pickedAsStart) {
+        panel.m_startNode = nodeId;
+        panel.m_startLat = static_cast<float>(place.lat);
+        panel.m_startLon = static_cast<float>(place.lon);
+    } else {
+        panel.m_endNode = nodeId;
+        panel.m_endLat = static_cast<float>(place.lat);
+        panel.m_endLon = static_cast<float>(place.lon);
+    }
+    stopAnytimeRoute();
+    m_renderer.clearPath();
+    updateEndpointMarkers();
+}
+
+void Windower::updateEndpointMarkers() {
+    std::vector<float> points;
+
+    auto addPoint = [&](int64_t id) {
+        double nLat, nLon;
+        if (getNodeCoords(id, nLat, nLon)) {
+            // Convert back to Normalized Map Coords
+            double nLonRad = nLon * (M_PI / 180.0);
+            double nLatRad = nLat * (M_PI / 180.0);
+            double nXMerc = nLonRad;
+            double nYMerc = 0.5 * std::log((1.0 + std::sin(nLatRad)) / (1.0 - std::sin(nLatRad)));
                     
-                    float nX = static_cast<float>((nXMerc - m_mapMidX) * (2.0 / m_mapScale));
-                    float nY = static_cast<float>((nYMerc - m_mapMidY) * (2.0 / m_mapScale));
+            float nX = static_cast<float>((nXMerc - m_mapMidX) * (2.0 / m_mapScale));
+            float nY = static_cast<float>((nYMerc - m_mapMidY) * (2.0 / m_mapScale));
                     
-                    points.push_back(nX);
-                    points.push_back(nY);
-                    points.push_back(0.0f);
-                }
-            };
+            points.push_back(nX);
+            points.push_back(nY);
+            points.push_back(0.0f);
+        }
+    };
 
-            if (panel.m_startNode != 0) addPoint(panel.m_startNode);
-            if (panel.m_endNode != 0) addPoint(panel.m_endNode);
+    if (panel.m_startNode != 0) addPoint(panel.m_startNode);
+    for (int64_t id : panel.m_viaNodes) addPoint(id);
+    if (panel.m_endNode != 0) addPoint(panel.m_endNode);
 
-            m_renderer.setPoints(points);
-        }
-    }
+    m_renderer.setPoints(points);
 }
 
 void Windower::m_cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
     Windower* win = reinterpret_cast<Windower*>(glfwGetWindowUserPointer(window));
     if (!win) return;
+    if (win->m_dragging != 0) {
+        win->m_dragX = xpos;
+        win->m_dragY = ypos;
+        win->m_dragMoved = true;
+        return;
+    }
     if (!win->m_middleDown) return;
 
     double dx = xpos - win->m_lastMouseX;
@@ -10,6 +10,12 @@
 
 #include "renderer.hpp"
 #include "ui_panel.hpp"
+#include "a_star.hpp"
+#include "incremental_search.hpp"
+#include "anytime_search.hpp"
+#include "pareto_search.hpp"
+
+#include <memory>
 
 class Windower {
 private:
@@ -37,6 +43,35 @@ public:
     float m_mapMidY = 0.0f;
     float m_mapScale = 1.0f;
 
+    // Dragging the start or end marker replans once per frame from the
+    // previous search tree instead of routing from scratch
+    std::unique_ptr<IncrementalSearch> m_replanner;
+    int m_dragging = 0;       // 0 none, 1 start marker, 2 end marker
+    bool m_dragMoved = false; // cursor moved since the last replan
+    double m_dragX = 0.0;
+    double m_dragY = 0.0;
+    bool m_dragReplanned = false; // the route shown is from the drag, without directions
+
+    // Anytime node routes: solutions stream in from the worker and are
+    // picked up once per frame
+    std::unique_ptr<AnytimeRouter> m_anytime;
+    EdgeCostsPtr m_anytimeCosts;
+    uint32_t m_anytimeStart = INVALID_NODE;
+    size_t m_anytimeShown = 0;
+
+    // Distance / time frontier of the last comparison, shortest first, for
+    // as long as it is between the current start and end and on screen
+    std::unique_ptr<ParetoSearch> m_pareto;
+    std::vector<PathResult> m_paretoPaths;
+    int64_t m_paretoStartNode = 0;
+    int64_t m_paretoEndNode = 0;
+
+    // Edges the panel's avoid settings close, rebuilt when they change (null
+    // when nothing is avoided), and the live costs with them closed
+    EdgeMaskPtr m_avoidMask;
+    EdgeCostsPtr m_maskedFrom;
+    EdgeCostsPtr m_maskedCosts;
+
     void setMapBounds(float midX, float midY, float scale) {
         m_mapMidX = midX;
         m_mapMidY = midY;
@@ -49,6 +84,25 @@ public:
     static void m_scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
     void processInput();
     void handleMouseClick(int button, int action, double xpos, double ypos);
+    void handlePlacePick();
+    void screenToLatLon(double xpos, double ypos, double& lat, double& lon) const;
+    bool nodeToScreen(int64_t nodeId, double& xpos, double& ypos) const;
+    bool beginDrag(double xpos, double ypos);
+    void replanDrag();
+    void endDrag();
+    void startAnytimeRoute();
+    void showAnytimeProgress();
+    void stopAnytimeRoute();
+    void compareRoutes();
+    void showParetoRoute(size_t pick);
+    void clearFrontier();
+    void updateEndpointMarkers();
+    void updateAvoidMask();
+    EdgeCostsPtr routeCosts();
+    bool showRoute(const PathResult& result, bool keepFrontier = false);
+    bool drawRoute(const PathResult& result, bool keepFrontier);
+    void planVehicles();
+    void routeToNearestFacility();
     void resizeViewport(GLFWwindow* window, int width, int height);
 
     Windower(Renderer& renderer, int windowWidth, int windowHeight);